@@ -99,6 +99,41 @@ inline void octree_pool2x2x2(const ot_data_t* data_in, ot_size_t feature_size, o
   }
 }
 
+/// Records for the max pooling of 8 sibling octree leaf cells the index of the
+/// maximum per feature, the first one in case of ties as in 
+/// octree_pool2x2x2_max_bwd.
+///
+/// @param data_in data of the 8 sibling leaf cells (length = 8 * feature_size).
+/// @param feature_size length of a single data vector for one leaf cell.
+/// @param data_in_idx offset of data_in in the data array of the input.
+/// @param argmax offset of the maximum in the data array of the input per 
+///               feature (length = feature_size).
+OCTREE_FUNCTION
+inline void octree_pool2x2x2_max_argmax(const ot_data_t* data_in, ot_size_t feature_size, int data_in_idx, int* argmax) {
+  for(int f = 0; f < feature_size; ++f) {
+    ot_data_t max_val = data_in[f];
+    int max_idx = 0;
+    for(int idx = 1; idx < 8; ++idx) {
+      ot_data_t val = data_in[idx * feature_size + f];
+      max_idx = val > max_val ? idx : max_idx;
+      max_val = FMAX(max_val, val);
+    }
+    argmax[f] = data_in_idx + max_idx * feature_size + f;
+  }
+}
+
+/// Records the argmax for values that are copied from the input to the 
+/// output, i.e., the offsets data_in_idx, ..., data_in_idx + n - 1.
+///
+/// @param data_in_idx offset of the copied values in the data array of the input.
+/// @param n number of copied values.
+/// @param argmax 
+OCTREE_FUNCTION
+inline void octree_cpy_leaf_argmax(int data_in_idx, ot_size_t n, int* argmax) {
+  for(int idx = 0; idx < n; ++idx) {
+    argmax[idx] = data_in_idx + idx;
+  }
+}
 
 
 /// Backward function of the pool (avg) operation.
@@ -67,6 +67,47 @@ extern "C" {
   /// \param grad_gamma gradients with respect to gamma, array of size grid_in->feature_size initialized with zero
   /// \param grad_beta gradient with respect to beta, array of size grid_in->feature_size initialized with zero
   void octree_bn_ss_wbwd_cpu(const octree* grid_in, const octree* grad_out, ot_data_t* grad_gamma, ot_data_t* grad_beta);
+  
+  /// Fused batch normalization, i.e. octree_bn_norm_cpu followed by 
+  /// octree_bn_ss_cpu, in two sweeps over the data: one for the statistics and
+  /// one that normalizes, scales and shifts.
+  /// \param grid_in input octree
+  /// \param avgs array to write the channel averages to, array of size grid_in->feature_size
+  /// \param vars array to write the channel variances to, array of size grid_in->feature_size
+  /// \param gamma array of size grid_in->feature_size to scale channels with
+  /// \param beta array of size grid_in->feature_size to shift channels with
+  /// \param grid_out output octree, has to differ from grid_in
+  void octree_bn_cpu(const octree* grid_in, ot_data_t* avgs, ot_data_t* vars, const ot_data_t* gamma, const ot_data_t* beta, octree* grid_out);
+  
+  /// Backward pass of octree_bn_cpu, i.e. the combination of octree_bn_ss_bwd_cpu,
+  /// octree_bn_ss_wbwd_cpu and octree_bn_norm_bwd_cpu, in two sweeps over the data.
+  /// \param grid_in input octree of original forward pass
+  /// \param grad_out output gradients as octree, i.e. gradients of top layer
+  /// \param avgs array with the averages computed by octree_bn_cpu
+  /// \param vars array with the variances computed by octree_bn_cpu
+  /// \param gamma array of gammas of size grid_in->feature_size the channels were scaled with
+  /// \param grad_in gradients of this layer as octree
+  /// \param grad_gamma gradients with respect to gamma are added to this array of size grid_in->feature_size
+  /// \param grad_beta gradients with respect to beta are added to this array of size grid_in->feature_size
+  void octree_bn_bwd_cpu(const octree* grid_in, const octree* grad_out, const ot_data_t* avgs, const ot_data_t* vars, const ot_data_t* gamma, octree* grad_in, ot_data_t* grad_gamma, ot_data_t* grad_beta);
+  
+  /// Folds a batch normalization with the given statistics, optionally 
+  /// followed by scale and shift, into the parameters of the preceding 3x3x3
+  /// convolution, such that the normalization can be skipped at inference time.
+  /// The folding is exact for octree_conv3x3x3_avg_cpu. octree_conv3x3x3_sum_cpu
+  /// scales the bias with the number of voxels of a leaf, hence, for this 
+  /// variant the folding is only exact for the leafs on the finest level.
+  /// \param weights channels_out x channels_in x 3 x 3 x 3 conv weights
+  /// \param bias array of size channels_out with the conv bias
+  /// \param channels_in number of input channels of the convolution
+  /// \param channels_out number of output channels of the convolution
+  /// \param avgs array of size channels_out with the averages of the batch normalization
+  /// \param vars array of size channels_out with the variances of the batch normalization
+  /// \param gamma array of size channels_out with the scales, may be 0 if there is no scale and shift
+  /// \param beta array of size channels_out with the shifts, may be 0 if there is no scale and shift
+  /// \param weights_folded output weights, same size as weights, may point to weights
+  /// \param bias_folded output bias, array of size channels_out, may point to bias
+  void octree_bn_fold_conv3x3x3_cpu(const ot_data_t* weights, const ot_data_t* bias, int channels_in, int channels_out, const ot_data_t* avgs, const ot_data_t* vars, const ot_data_t* gamma, const ot_data_t* beta, ot_data_t* weights_folded, ot_data_t* bias_folded);
 }
 
 #endif // OCTREE_BN_CPU_H
\ No newline at end of file
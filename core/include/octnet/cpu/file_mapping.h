@@ -0,0 +1,82 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef OCTREE_FILE_MAPPING_CPU_H
+#define OCTREE_FILE_MAPPING_CPU_H
+
+#include <cstddef>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/// A file that is memory mapped read only for a sequential pass, unmapped on
+/// destruction. Shared by the dense and the mesh readers.
+struct file_mapping {
+  void* addr;
+  size_t length;
+
+  file_mapping() : addr(MAP_FAILED), length(0) {}
+  ~file_mapping() {
+    if(addr != MAP_FAILED) {
+      munmap(addr, length);
+    }
+  }
+
+  /// Maps the file at path.
+  /// @return 0 on success, otherwise a description of the error.
+  const char* map(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+      return "could not open file";
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      return "empty file";
+    }
+    length = st.st_size;
+    addr = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(addr == MAP_FAILED) {
+      return "mmap failed";
+    }
+    // the advice values are not flags and cannot be combined
+    madvise(addr, length, MADV_SEQUENTIAL);
+    madvise(addr, length, MADV_WILLNEED);
+    return 0;
+  }
+
+  const char* begin() const { return (const char*) addr; }
+  const char* end() const { return (const char*) addr + length; }
+
+private:
+  // owns the mapping, a copy would unmap it twice
+  file_mapping(const file_mapping&) = delete;
+  file_mapping& operator=(const file_mapping&) = delete;
+};
+
+#endif
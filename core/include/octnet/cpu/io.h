@@ -28,6 +28,15 @@
 
 #include "octnet/core/core.h"
 
+/// data section stored as 32 bit floats (default)
+#define OT_STORAGE_FLOAT32 0
+/// data section stored as IEEE 754 half precision floats
+#define OT_STORAGE_FLOAT16 1
+/// data section stored as unsigned 8 bit integers with per-channel scale/offset
+#define OT_STORAGE_UINT8 2
+/// data section stored as signed 8 bit integers with per-channel scale/offset
+#define OT_STORAGE_INT8 3
+
 extern "C" {
 void octree_read_deprecated_cpu(const char* path, octree* grid_h);
 void dense_read_prealloc_deprecated_cpu(const char* path, int n_dim, const int* dims, ot_data_t* data);
@@ -35,14 +44,77 @@ int* dense_read_header_deprecated_cpu(const char* path, int* n_dim);
 
 void octree_read_cpu(const char* path, octree* grid_h);
 void octree_write_cpu(const char* path, const octree* grid_h);
+/// Serializes grid_h like octree_write_cpu, but stores the data array with 
+/// the given storage type (OT_STORAGE_*). For the 8 bit types a scale and 
+/// offset per feature channel is stored in the header. All octree readers 
+/// convert the data section back to ot_data_t.
+/// @param path
+/// @param grid_h
+/// @param storage_type
+void octree_write_typed_cpu(const char* path, const octree* grid_h, int storage_type);
 void octree_read_batch_cpu(int n_paths, char** paths, int n_threads, octree* grid_h);
+/// Reads n_leafs from the headers of n_paths octree files (interleaved, or
+/// columnar) in parallel, e.g., to form batches with a bounded number of 
+/// leafs before any data is loaded.
+/// @param n_paths
+/// @param paths
+/// @param n_threads
+/// @param n_leafs output array of length n_paths.
+void octree_read_n_leafs_batch_cpu(int n_paths, char** paths, int n_threads, ot_size_t* n_leafs);
+
+/// Serializes grid_h in a channel-major (columnar) layout: the header stores
+/// the byte offset of every channel section, followed by the trees, the 
+/// prefix_leafs and one contiguous section per feature channel. This allows 
+/// to read the structure only, or a subset of the channels.
+/// octree_read_cpu reads columnar files as well.
+/// @param path
+/// @param grid_h
+/// @param storage_type storage type of the channel sections (OT_STORAGE_*).
+void octree_write_columnar_cpu(const char* path, const octree* grid_h, int storage_type);
+
+/// Reads only trees and prefix_leafs of an octree file (interleaved, or 
+/// columnar) without touching the data section. The resulting grid_h has 
+/// feature_size = 0 and no data array.
+/// @param path
+/// @param grid_h
+void octree_read_structure_cpu(const char* path, octree* grid_h);
+
+/// Reads the structure and the given subset of feature channels of an octree
+/// file. For columnar files only the requested channel sections are read, 
+/// in parallel, and interleaved into grid_h->data in the order of channels.
+/// Interleaved files are read completely and the channels are extracted.
+/// @param path
+/// @param n_channels number of channels to read, -1 reads all channels.
+/// @param channels 0-based channel indices of length n_channels.
+/// @param n_threads
+/// @param grid_h
+void octree_read_channels_cpu(const char* path, int n_channels, const int* channels, int n_threads, octree* grid_h);
 
 void octree_dhwc_write_cpu(const char* path, const octree* grid_h);
 void octree_cdhw_write_cpu(const char* path, const octree* grid_h);
 
 void dense_write_cpu(const char* path, int n_dim, const int* dims, const ot_data_t* data);
+/// Serializes a dense tensor like dense_write_cpu, but stores the data with
+/// the given storage type (OT_STORAGE_*). The 8 bit types use a scale and 
+/// offset per channel, where the channels are given by the last dimension.
+/// @param path
+/// @param n_dim
+/// @param dims
+/// @param data
+/// @param storage_type
+void dense_write_typed_cpu(const char* path, int n_dim, const int* dims, const ot_data_t* data, int storage_type);
 ot_data_t* dense_read_cpu(const char* path);
 void dense_read_prealloc_cpu(const char* path, int n_dim, const int* dims, ot_data_t* data);
+/// Reads n_paths dense tensors of shape 1 x dims[1] x ... into the batch 
+/// tensor data of shape n_paths x dims[1] x ... . The files are memory mapped
+/// and all headers are validated in a first parallel pass, the payloads are 
+/// then copied (decoded) in parallel to their slots in data.
+/// @param n_paths
+/// @param paths
+/// @param n_threads
+/// @param n_dim
+/// @param dims
+/// @param data
 void dense_read_prealloc_batch_cpu(int n_paths, char** paths, int n_threads, int n_dim, const int* dims, ot_data_t* data); 
 
 } //extern "C"
@@ -34,6 +34,14 @@ void octree_mask_by_label_cpu(const octree* labels, int mask_label, bool check,
 
 void octree_determine_gt_split_cpu(const octree* struc, const ot_data_t* gt, octree* out);
 
+/// Merges homogeneous subtrees of in bottom-up: a split node whose 8 children
+/// are leaves is collapsed to a single leaf, if the feature vectors of the 
+/// children differ from the first child by at most eps in every channel. The
+/// merged leaf gets the average of its children. Hence, eps = 0 merges only
+/// identical leafs and preserves the dense representation of in.
+/// The blocks are processed in parallel, in and out may be the same octree.
+void octree_merge_homogeneous_cpu(const octree* in, ot_data_t eps, int n_threads, octree* out);
+
 
 }
 
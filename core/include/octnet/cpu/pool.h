@@ -27,6 +27,7 @@
 #define OCTREE_POOL_CPU_H
 
 #include "octnet/core/pool.h"
+#include "octnet/cpu/cpu.h"
 
 extern "C" {
 
@@ -64,6 +65,23 @@ void octree_gridpool2x2x2_max_cpu(const octree* in, octree* out);
 /// @param grad_in gradient with respect to the input.
 void octree_gridpool2x2x2_max_bwd_cpu(const octree* in, const octree* grad_out, octree* grad_in);
 
+/// Variant of @see octree_gridpool2x2x2_max_cpu that additionally records for
+/// every output value the offset of its maximum in in->data, such that the 
+/// backward pass is a single scatter.
+/// @param in input grid-octree structure. grid_depth % 2 == 0, 
+///           grid_height % 2 == 0, and grid_height % 2 == 0 must satisfied.
+/// @param out output of this operation.
+/// @param argmax buffer for out->n_leafs * feature_size offsets, 
+///               in->n_leafs * feature_size is a sufficient size.
+void octree_gridpool2x2x2_max_argmax_cpu(const octree* in, octree* out, int* argmax);
+
+/// Backward pass of @see octree_gridpool2x2x2_max_argmax_cpu.
+/// @param in input grid-octree structure. 
+/// @param grad_out gradient with respect to forward pass output.
+/// @param argmax offsets recorded by the forward pass.
+/// @param grad_in gradient with respect to the input.
+void octree_gridpool2x2x2_max_argmax_bwd_cpu(const octree* in, const octree* grad_out, const int* argmax, octree* grad_in);
+
 /// This method implements a sum pooling operation for grid-octree 
 /// structures. This is realized by pooling together 8 neighbouring shallow
 /// octrees (hence, the name gridpool). 
@@ -107,7 +125,47 @@ void octree_pool2x2x2_max_cpu(const octree* in, bool level_0, bool level_1, bool
 /// @param grad_in gradient with respect to the input.
 void octree_pool2x2x2_max_bwd_cpu(const octree* in, const octree* grad_out, octree* grad_in);
 
+/// Variant of @see octree_pool2x2x2_max_cpu that additionally records for 
+/// every output value the offset of its maximum in in->data.
+/// @param in input grid-octree structure.
+/// @param level_0 if true, cells on level 1 are pooled together
+/// @param level_1 if true, cells on level 2 are pooled together
+/// @param level_2 if true, cells on level 3 are pooled together
+/// @param out output 
+/// @param argmax buffer for out->n_leafs * feature_size offsets, 
+///               in->n_leafs * feature_size is a sufficient size.
+void octree_pool2x2x2_max_argmax_cpu(const octree* in, bool level_0, bool level_1, bool level_2, octree* out, int* argmax);
+
+/// Backward pass for @see octree_pool2x2x2_max_argmax_cpu, scatters grad_out
+/// to the recorded maxima.
+/// @param in input grid-octree structure.
+/// @param grad_out gradient with respect to forward pass output.
+/// @param argmax offsets recorded by the forward pass.
+/// @param grad_in gradient with respect to the input.
+void octree_pool2x2x2_max_argmax_bwd_cpu(const octree* in, const octree* grad_out, const int* argmax, octree* grad_in);
+
 
 }
 
+/// Scatters grad_out to the input offsets argmax recorded by a max pooling, 
+/// shared by the argmax backward passes of pool and gridpool. Every input 
+/// value is pooled into at most one output value, hence, the scatter is free 
+/// of conflicts.
+/// @param in input grid-octree structure.
+/// @param grad_out gradient with respect to forward pass output.
+/// @param argmax offsets recorded by the forward pass.
+/// @param grad_in gradient with respect to the input.
+inline void octree_pool_argmax_scatter_cpu(const octree* in, const octree* grad_out, const int* argmax, octree* grad_in) {
+  octree_resize_as_cpu(in, grad_in);
+  octree_cpy_trees_cpu_cpu(in, grad_in);
+  octree_cpy_prefix_leafs_cpu_cpu(in, grad_in);
+
+  octree_fill_data_cpu(grad_in, 0);
+  const int n_out = grad_out->n_leafs * grad_out->feature_size;
+  #pragma omp parallel for
+  for(int idx = 0; idx < n_out; ++idx) {
+    grad_in->data[argmax[idx]] = grad_out->data[idx];
+  }
+}
+
 #endif 
@@ -27,34 +27,86 @@
 #include "octnet/cpu/cpu.h"
 #include "octnet/cpu/bn.h"
 
+#include <vector>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
 #define FAST_POW(x, y) pow(x, y)
 #define FAST_SQRT(x) sqrt(x)
 #define EPS 1e-12
 
+/// Weighted Welford accumulator for the per channel statistics of 
+/// octree_bn_stat_cpu. Every thread accumulates its leafs into its own 
+/// instance, weighted by the number of voxels of the leaf, and the instances
+/// are merged afterwards in thread order.
+struct octree_bn_welford {
+  octree_bn_welford() : weight(0) {}
+  octree_bn_welford(int channels) : weight(0), mean(channels, 0), m2(channels, 0) {}
+
+  inline void add(const ot_data_t* val, ot_data_t factor) {
+    weight += factor;
+    double ratio = factor / weight;
+    for(size_t c = 0; c < mean.size(); ++c) {
+      double delta = val[c] - mean[c];
+      mean[c] += ratio * delta;
+      m2[c] += factor * delta * (val[c] - mean[c]);
+    }
+  }
+
+  inline void merge(const octree_bn_welford& other) {
+    if(other.weight <= 0) {
+      return;
+    }
+    double new_weight = weight + other.weight;
+    for(size_t c = 0; c < mean.size(); ++c) {
+      double delta = other.mean[c] - mean[c];
+      m2[c] += other.m2[c] + delta * delta * weight * other.weight / new_weight;
+      mean[c] += delta * other.weight / new_weight;
+    }
+    weight = new_weight;
+  }
+
+  double weight;
+  std::vector<double> mean;
+  std::vector<double> m2;
+};
+
+inline void octree_bn_thread_idx(int* n_threads, int* thread_idx) {
+#if defined(_OPENMP)
+  n_threads[0] = omp_get_num_threads();
+  thread_idx[0] = omp_get_thread_num();
+#else
+  n_threads[0] = 1;
+  thread_idx[0] = 0;
+#endif
+}
+
 extern "C"
 void octree_bn_stat_cpu(const octree* grid, ot_data_t* avgs, ot_data_t* vars) {
   const ot_size_t n_blocks = octree_num_blocks(grid);
   const ot_size_t channels = grid->feature_size;
   
-  // first we compute running average and variance
-  // need to remember using atomic to avoid race conditions!
-  // not sure whether OpenMP makes much sense here ...
-  #pragma omp parallel for
+  // every thread computes mean and variance of its blocks in a single pass,
+  // the partial statistics are merged afterwards
+  std::vector<octree_bn_welford> partials;
+  #pragma omp parallel
+  {
+  int n_threads, thread_idx;
+  octree_bn_thread_idx(&n_threads, &thread_idx);
+  #pragma omp single
+  partials.resize(n_threads);
+  octree_bn_welford partial(channels);
+
+  #pragma omp for schedule(static)
   for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
     ot_tree_t* tree = octree_get_tree(grid, grid_idx);
     ot_data_t* in_data = octree_get_data(grid, grid_idx);
     
     // check L0 split:
     if(!tree_isset_bit(tree, 0)) {
-      ot_data_t factor = 8*8*8;
-      for (int c = 0; c < channels; ++c) {
-        ot_data_t val = in_data[c];
-        ot_data_t fval = factor*val; // reduce number of multiplications
-        #pragma omp atomic
-        avgs[c] += fval;
-        #pragma omp atomic
-        vars[c] += fval*val;
-      }
+      partial.add(in_data, 8*8*8);
     }
     else {
 
@@ -66,15 +118,7 @@ void octree_bn_stat_cpu(const octree* grid, ot_data_t* avgs, ot_data_t* vars) {
             // check L1 split:
             if(!tree_isset_bit(tree, bit_idx_l1)) {
               int data_idx = tree_data_idx(tree, bit_idx_l1, channels);
-              ot_data_t factor = 4*4*4;
-              for (int c = 0; c < channels; ++c) {
-                ot_data_t val = (in_data + data_idx)[c];
-                ot_data_t fval = factor*val; // reduce number of multiplications
-                #pragma omp atomic
-                avgs[c] += fval;
-                #pragma omp atomic
-                vars[c] += fval*val;
-              }
+              partial.add(in_data + data_idx, 4*4*4);
             }
             else {
 
@@ -86,15 +130,7 @@ void octree_bn_stat_cpu(const octree* grid, ot_data_t* avgs, ot_data_t* vars) {
                     // check L2 split:
                     if(!tree_isset_bit(tree, bit_idx_l2)) {
                       int data_idx = tree_data_idx(tree, bit_idx_l2, channels);
-                      ot_data_t factor = 2*2*2;
-                      for (int c = 0; c < channels; ++c) {
-                        ot_data_t val = (in_data + data_idx)[c];
-                        ot_data_t fval = factor*val; // reduce number of multiplications
-                        #pragma omp atomic
-                        avgs[c] += fval;
-                        #pragma omp atomic
-                        vars[c] += fval*val;
-                      }
+                      partial.add(in_data + data_idx, 2*2*2);
                     }
                     else {
 
@@ -103,13 +139,7 @@ void octree_bn_stat_cpu(const octree* grid, ot_data_t* avgs, ot_data_t* vars) {
                         for(int bhl3 = 0; bhl3 < 2; ++bhl3) {
                           for(int bwl3 = 0; bwl3 < 2; ++bwl3) {
                             int data_idx = tree_data_idx(tree, bit_idx_l3, channels);
-                            for (int c = 0; c < channels; ++c) {
-                              ot_data_t val = (in_data + data_idx)[c];
-                              #pragma omp atomic
-                              avgs[c] += val;
-                              #pragma omp atomic
-                              vars[c] += val*val;
-                            }
+                            partial.add(in_data + data_idx, 1);
                             
                             bit_idx_l3++;
                           }
@@ -131,12 +161,19 @@ void octree_bn_stat_cpu(const octree* grid, ot_data_t* avgs, ot_data_t* vars) {
       } // for bdl1
     } // else L0
   } // for grid_idx
+
+  partials[thread_idx] = partial;
+  } // omp parallel
   
+  octree_bn_welford stat(channels);
+  for(size_t thread_idx = 0; thread_idx < partials.size(); ++thread_idx) {
+    stat.merge(partials[thread_idx]);
+  }
+
   const ot_size_t M = 8*grid->grid_depth*8*grid->grid_height*8*grid->grid_width*grid->n;
   for (int c = 0; c < channels; ++c) {
-    avgs[c] /= M;
-    vars[c] /= M;
-    vars[c] -= avgs[c]*avgs[c];
+    avgs[c] = stat.mean[c];
+    vars[c] = stat.m2[c] / M;
   }
 }
 
@@ -255,13 +292,21 @@ void octree_bn_stat_bwd_cpu(const octree* grid_in, const octree* grad_out, ot_da
   const ot_size_t n_blocks = octree_num_blocks(grid_in);
   const ot_size_t channels = grid_in->feature_size;
   
-  ot_data_t* grad_avgs_part = new ot_data_t[channels];
-  for (int c = 0; c < channels; ++c) {
-    grad_avgs_part[c] = 0;
-  }
-  
-  // remember race conditions
-  #pragma omp parallel for
+  // every thread sums the gradients, the centered inputs and their products
+  // for its blocks, the partial sums are added afterwards in thread order
+  std::vector<std::vector<double> > partials;
+  #pragma omp parallel
+  {
+  int n_threads, thread_idx;
+  octree_bn_thread_idx(&n_threads, &thread_idx);
+  #pragma omp single
+  partials.resize(n_threads);
+  std::vector<double> partial(3 * channels, 0);
+  double* sum_grad = &partial[0];
+  double* sum_centered = &partial[channels];
+  double* sum_grad_centered = &partial[2 * channels];
+
+  #pragma omp for schedule(static)
   for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
     ot_tree_t* tree = octree_get_tree(grid_in, grid_idx);
     ot_data_t* in_data = octree_get_data(grid_in, grid_idx);
@@ -274,12 +319,9 @@ void octree_bn_stat_bwd_cpu(const octree* grid_in, const octree* grad_out, ot_da
         ot_data_t grad = grad_out_data[c];
         ot_data_t val = in_data[c];
         ot_data_t centered = factor*(val - avgs[c]);
-        #pragma omp atomic
-        grad_avgs[c] += factor*grad;
-        #pragma omp atomic
-        grad_avgs_part[c] += centered;
-        #pragma omp atomic
-        grad_vars[c] += grad*centered;
+        sum_grad[c] += factor*grad;
+        sum_centered[c] += centered;
+        sum_grad_centered[c] += grad*centered;
       }
     }
     else {
@@ -297,12 +339,9 @@ void octree_bn_stat_bwd_cpu(const octree* grid_in, const octree* grad_out, ot_da
                 ot_data_t grad = grad_out_data[data_idx + c];
                 ot_data_t val = in_data[data_idx + c];
                 ot_data_t centered = factor*(val - avgs[c]);
-                #pragma omp atomic
-                grad_avgs[c] += factor*grad;
-                #pragma omp atomic
-                grad_avgs_part[c] += centered;
-                #pragma omp atomic
-                grad_vars[c] += grad*centered;
+                sum_grad[c] += factor*grad;
+                sum_centered[c] += centered;
+                sum_grad_centered[c] += grad*centered;
               }
             }
             else {
@@ -320,12 +359,9 @@ void octree_bn_stat_bwd_cpu(const octree* grid_in, const octree* grad_out, ot_da
                         ot_data_t grad = grad_out_data[data_idx + c];
                         ot_data_t val = in_data[data_idx + c];
                         ot_data_t centered = factor*(val - avgs[c]);
-                        #pragma omp atomic
-                        grad_avgs[c] += factor*grad;
-                        #pragma omp atomic
-                        grad_avgs_part[c] += centered;
-                        #pragma omp atomic
-                        grad_vars[c] += grad*centered;
+                        sum_grad[c] += factor*grad;
+                        sum_centered[c] += centered;
+                        sum_grad_centered[c] += grad*centered;
                       }
                     }
                     else {
@@ -339,12 +375,9 @@ void octree_bn_stat_bwd_cpu(const octree* grid_in, const octree* grad_out, ot_da
                               ot_data_t grad = grad_out_data[data_idx + c];
                               ot_data_t val = in_data[data_idx + c];
                               ot_data_t centered = (val - avgs[c]);
-                              #pragma omp atomic
-                              grad_avgs[c] += grad;
-                              #pragma omp atomic
-                              grad_avgs_part[c] += centered;
-                              #pragma omp atomic
-                              grad_vars[c] += grad*centered;
+                              sum_grad[c] += grad;
+                              sum_centered[c] += centered;
+                              sum_grad_centered[c] += grad*centered;
                             }
                             
                             bit_idx_l3++;
@@ -367,6 +400,19 @@ void octree_bn_stat_bwd_cpu(const octree* grid_in, const octree* grad_out, ot_da
       } // for bdl1
     } // else L0
   } // for grid_idx
+
+  partials[thread_idx].swap(partial);
+  } // omp parallel
+
+  std::vector<double> grad_avgs_part(channels, 0);
+  for(size_t thread_idx = 0; thread_idx < partials.size(); ++thread_idx) {
+    const std::vector<double>& partial = partials[thread_idx];
+    for (int c = 0; c < channels; ++c) {
+      grad_avgs[c] += partial[c];
+      grad_avgs_part[c] += partial[channels + c];
+      grad_vars[c] += partial[2 * channels + c];
+    }
+  }
   
   const ot_size_t M = 8*grid_in->grid_depth*8*grid_in->grid_height*8*grid_in->grid_width*grid_in->n;
   for (int c = 0; c < channels; ++c) {
@@ -375,8 +421,6 @@ void octree_bn_stat_bwd_cpu(const octree* grid_in, const octree* grad_out, ot_da
     grad_avgs[c] *= -1.f/FAST_SQRT(vars[c] + EPS);
     grad_avgs[c] += grad_vars[c]/M*(-2.f)*grad_avgs_part[c];
   }
-  
-  delete[] grad_avgs_part;
 }
 
 extern "C"
@@ -534,4 +578,177 @@ void octree_bn_ss_wbwd_cpu(const octree* grid_in, const octree* grad_out, ot_dat
       grad_beta[c] += grad;
     }
   }
-}
\ No newline at end of file
+}
+
+/// Calls op(data_idx, factor) for every leaf of the shallow octree tree, where
+/// factor is the number of voxels covered by the leaf.
+template <typename OP>
+inline void octree_bn_leafs(const ot_tree_t* tree, int channels, OP& op) {
+  if(!tree_isset_bit(tree, 0)) {
+    op(0, 8*8*8);
+    return;
+  }
+  for(int bit_idx_l1 = 1; bit_idx_l1 < 9; ++bit_idx_l1) {
+    if(!tree_isset_bit(tree, bit_idx_l1)) {
+      op(tree_data_idx(tree, bit_idx_l1, channels), 4*4*4);
+      continue;
+    }
+    int bit_idx_l2_0 = tree_child_bit_idx(bit_idx_l1);
+    for(int bit_idx_l2 = bit_idx_l2_0; bit_idx_l2 < bit_idx_l2_0 + 8; ++bit_idx_l2) {
+      if(!tree_isset_bit(tree, bit_idx_l2)) {
+        op(tree_data_idx(tree, bit_idx_l2, channels), 2*2*2);
+        continue;
+      }
+      int bit_idx_l3_0 = tree_child_bit_idx(bit_idx_l2);
+      for(int bit_idx_l3 = bit_idx_l3_0; bit_idx_l3 < bit_idx_l3_0 + 8; ++bit_idx_l3) {
+        op(tree_data_idx(tree, bit_idx_l3, channels), 1);
+      }
+    }
+  }
+}
+
+/// Per leaf sums of the fused backward pass, the first three are weighted by
+/// the leaf size as in octree_bn_stat_bwd_cpu, the last two are taken over 
+/// the leafs as in octree_bn_ss_wbwd_cpu.
+struct octree_bn_bwd_sums {
+  octree_bn_bwd_sums(int channels_, const ot_data_t* avgs_) : 
+    channels(channels_), avgs(avgs_), in_data(0), grad_out_data(0), 
+    sums(5 * channels_, 0) {}
+
+  inline void operator()(int data_idx, ot_data_t factor) {
+    double* sum_grad = &sums[0];
+    double* sum_centered = &sums[channels];
+    double* sum_grad_centered = &sums[2 * channels];
+    double* sum_leaf_grad_centered = &sums[3 * channels];
+    double* sum_leaf_grad = &sums[4 * channels];
+    for(int c = 0; c < channels; ++c) {
+      ot_data_t grad = grad_out_data[data_idx + c];
+      ot_data_t centered = in_data[data_idx + c] - avgs[c];
+      sum_grad[c] += factor * grad;
+      sum_centered[c] += factor * centered;
+      sum_grad_centered[c] += factor * grad * centered;
+      sum_leaf_grad_centered[c] += grad * centered;
+      sum_leaf_grad[c] += grad;
+    }
+  }
+
+  int channels;
+  const ot_data_t* avgs;
+  const ot_data_t* in_data;
+  const ot_data_t* grad_out_data;
+  std::vector<double> sums;
+};
+
+extern "C"
+void octree_bn_cpu(const octree* grid_in, ot_data_t* avgs, ot_data_t* vars, const ot_data_t* gamma, const ot_data_t* beta, octree* grid_out) {
+  octree_resize_as_cpu(grid_in, grid_out);
+  octree_cpy_scalars(grid_in, grid_out);
+  octree_cpy_trees_cpu_cpu(grid_in, grid_out);
+  octree_cpy_prefix_leafs_cpu_cpu(grid_in, grid_out);
+
+  const ot_size_t channels = grid_in->feature_size;
+
+  // first sweep computes the statistics
+  octree_bn_stat_cpu(grid_in, avgs, vars);
+
+  // second sweep normalizes, scales and shifts in one go
+  std::vector<ot_data_t> scale(channels);
+  std::vector<ot_data_t> shift(channels);
+  for(int c = 0; c < channels; ++c) {
+    scale[c] = gamma[c] / FAST_SQRT(vars[c] + EPS);
+    shift[c] = beta[c] - avgs[c] * scale[c];
+  }
+
+  #pragma omp parallel for
+  for(int leaf_idx = 0; leaf_idx < grid_in->n_leafs; ++leaf_idx) {
+    const ot_data_t* in_data = grid_in->data + leaf_idx * channels;
+    ot_data_t* out_data = grid_out->data + leaf_idx * channels;
+    for(int c = 0; c < channels; ++c) {
+      out_data[c] = in_data[c] * scale[c] + shift[c];
+    }
+  }
+}
+
+extern "C"
+void octree_bn_bwd_cpu(const octree* grid_in, const octree* grad_out, const ot_data_t* avgs, const ot_data_t* vars, const ot_data_t* gamma, octree* grad_in, ot_data_t* grad_gamma, ot_data_t* grad_beta) {
+  octree_resize_as_cpu(grad_out, grad_in);
+  octree_cpy_scalars(grad_out, grad_in);
+  octree_cpy_trees_cpu_cpu(grad_out, grad_in);
+  octree_cpy_prefix_leafs_cpu_cpu(grad_out, grad_in);
+
+  const ot_size_t n_blocks = octree_num_blocks(grid_in);
+  const ot_size_t channels = grid_in->feature_size;
+
+  // first sweep computes all sums needed for the statistic and parameter 
+  // gradients, in thread-local partials that are added in thread order
+  std::vector<std::vector<double> > partials;
+  #pragma omp parallel
+  {
+  int n_threads, thread_idx;
+  octree_bn_thread_idx(&n_threads, &thread_idx);
+  #pragma omp single
+  partials.resize(n_threads);
+  octree_bn_bwd_sums op(channels, avgs);
+
+  #pragma omp for schedule(static)
+  for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
+    op.in_data = octree_get_data(grid_in, grid_idx);
+    op.grad_out_data = octree_get_data(grad_out, grid_idx);
+    octree_bn_leafs(octree_get_tree(grid_in, grid_idx), channels, op);
+  }
+
+  partials[thread_idx].swap(op.sums);
+  } // omp parallel
+
+  std::vector<double> sums(5 * channels, 0);
+  for(size_t thread_idx = 0; thread_idx < partials.size(); ++thread_idx) {
+    for(int idx = 0; idx < 5 * channels; ++idx) {
+      sums[idx] += partials[thread_idx][idx];
+    }
+  }
+
+  // the gradients of the normalized values are gamma times grad_out, hence,
+  // gamma is factored out of the sums
+  const ot_size_t M = 8*grid_in->grid_depth*8*grid_in->grid_height*8*grid_in->grid_width*grid_in->n;
+  std::vector<ot_data_t> grad_out_scale(channels);
+  std::vector<ot_data_t> centered_scale(channels);
+  std::vector<ot_data_t> grad_in_shift(channels);
+  for(int c = 0; c < channels; ++c) {
+    ot_data_t over_vars_eps = 1.f/FAST_SQRT(vars[c] + EPS);
+    ot_data_t grad_vars = gamma[c] * sums[2 * channels + c] * -0.5f*FAST_POW(vars[c] + EPS, -1.5f);
+    ot_data_t grad_avgs = gamma[c] * sums[c] * -over_vars_eps + grad_vars/M*(-2.f)*sums[channels + c];
+
+    grad_out_scale[c] = gamma[c] * over_vars_eps;
+    centered_scale[c] = grad_vars*2.f/M;
+    grad_in_shift[c] = grad_avgs/M;
+
+    grad_gamma[c] += over_vars_eps * sums[3 * channels + c];
+    grad_beta[c] += sums[4 * channels + c];
+  }
+
+  // second sweep computes the input gradients
+  #pragma omp parallel for
+  for(int leaf_idx = 0; leaf_idx < grid_in->n_leafs; ++leaf_idx) {
+    const ot_data_t* in_data = grid_in->data + leaf_idx * channels;
+    const ot_data_t* grad_out_data = grad_out->data + leaf_idx * channels;
+    ot_data_t* grad_in_data = grad_in->data + leaf_idx * channels;
+    for(int c = 0; c < channels; ++c) {
+      grad_in_data[c] = grad_out_data[c] * grad_out_scale[c] 
+          + centered_scale[c] * (in_data[c] - avgs[c]) + grad_in_shift[c];
+    }
+  }
+}
+
+extern "C"
+void octree_bn_fold_conv3x3x3_cpu(const ot_data_t* weights, const ot_data_t* bias, int channels_in, int channels_out, const ot_data_t* avgs, const ot_data_t* vars, const ot_data_t* gamma, const ot_data_t* beta, ot_data_t* weights_folded, ot_data_t* bias_folded) {
+  const int weights_per_channel = channels_in * 3*3*3;
+  for(int co = 0; co < channels_out; ++co) {
+    ot_data_t g = gamma ? gamma[co] : 1;
+    ot_data_t b = beta ? beta[co] : 0;
+    ot_data_t scale = g / FAST_SQRT(vars[co] + EPS);
+    for(int idx = co * weights_per_channel; idx < (co + 1) * weights_per_channel; ++idx) {
+      weights_folded[idx] = scale * weights[idx];
+    }
+    bias_folded[co] = scale * (bias[co] - avgs[co]) + b;
+  }
+}
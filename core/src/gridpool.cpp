@@ -33,7 +33,7 @@
 #endif
 
 template <int pool_fcn>
-void octree_gridpool2x2x2_data_cpu(const octree* in, octree* out) {
+void octree_gridpool2x2x2_data_cpu(const octree* in, octree* out, int* argmax) {
   int n_blocks = octree_num_blocks(out);
   int feature_size = in->feature_size;
 
@@ -73,6 +73,9 @@ void octree_gridpool2x2x2_data_cpu(const octree* in, octree* out) {
                   if(tree_isset_bit(itree, ibit_idx_l2)) {
                     int in_data_idx = tree_data_idx(itree, tree_child_bit_idx(ibit_idx_l2), feature_size);
                     octree_pool2x2x2<pool_fcn>(idata + in_data_idx, feature_size, odata + out_data_idx);
+                    if(argmax) {
+                      octree_pool2x2x2_max_argmax(idata + in_data_idx, feature_size, idata + in_data_idx - in->data, argmax + (odata + out_data_idx - out->data));
+                    }
                   }
                   else {
                     int in_data_idx = tree_data_idx(itree, ibit_idx_l2, feature_size);
@@ -80,6 +83,9 @@ void octree_gridpool2x2x2_data_cpu(const octree* in, octree* out) {
                     //   odata[out_data_idx + f] = idata[in_data_idx + f];
                     // }
                     octree_cpy_leaf(idata + in_data_idx, feature_size, odata + out_data_idx);
+                    if(argmax) {
+                      octree_cpy_leaf_argmax(idata + in_data_idx - in->data, feature_size, argmax + (odata + out_data_idx - out->data));
+                    }
                   }
                   obit_idx_l3++;
 
@@ -93,6 +99,9 @@ void octree_gridpool2x2x2_data_cpu(const octree* in, octree* out) {
                 //   odata[out_data_idx + f] = idata[in_data_idx + f];
                 // }
                 octree_cpy_leaf(idata + in_data_idx, feature_size, odata + out_data_idx);
+                if(argmax) {
+                  octree_cpy_leaf_argmax(idata + in_data_idx - in->data, feature_size, argmax + (odata + out_data_idx - out->data));
+                }
               }
               obit_idx_l2++;
 
@@ -104,6 +113,9 @@ void octree_gridpool2x2x2_data_cpu(const octree* in, octree* out) {
             //   odata[out_data_idx + f] = idata[f];
             // }
             octree_cpy_leaf(idata, feature_size, odata + out_data_idx);
+            if(argmax) {
+              octree_cpy_leaf_argmax(idata - in->data, feature_size, argmax + (odata + out_data_idx - out->data));
+            }
           }
           obit_idx_l1++;
 
@@ -116,7 +128,7 @@ void octree_gridpool2x2x2_data_cpu(const octree* in, octree* out) {
 
 
 template <int pool_fcn>
-void octree_gridpool2x2x2_cpu(const octree* in, octree* out) {
+void octree_gridpool2x2x2_cpu(const octree* in, octree* out, int* argmax) {
   if(in->grid_depth % 2 != 0 || in->grid_height % 2 != 0 || in->grid_width % 2 != 0) {
     printf("[ERROR] octree_gridpool2x2x2_cpu grid dimension should be a multiply of 2\n");
     exit(-1);
@@ -184,7 +196,7 @@ void octree_gridpool2x2x2_cpu(const octree* in, octree* out) {
   octree_resize_as_cpu(out, out);
   octree_upd_prefix_leafs_cpu(out);
 
-  octree_gridpool2x2x2_data_cpu<pool_fcn>(in, out);
+  octree_gridpool2x2x2_data_cpu<pool_fcn>(in, out, argmax);
 }
 
 
@@ -277,15 +289,17 @@ void octree_gridpool2x2x2_bwd_cpu(const octree* in, const octree* grad_out, octr
 
 }
 
-
 void octree_gridpool2x2x2_avg_cpu(const octree* in, octree* out) {
-  octree_gridpool2x2x2_cpu<REDUCE_AVG>(in, out);
+  octree_gridpool2x2x2_cpu<REDUCE_AVG>(in, out, 0);
 }
 void octree_gridpool2x2x2_max_cpu(const octree* in, octree* out){
-  octree_gridpool2x2x2_cpu<REDUCE_MAX>(in, out);
+  octree_gridpool2x2x2_cpu<REDUCE_MAX>(in, out, 0);
+}
+void octree_gridpool2x2x2_max_argmax_cpu(const octree* in, octree* out, int* argmax) {
+  octree_gridpool2x2x2_cpu<REDUCE_MAX>(in, out, argmax);
 }
 void octree_gridpool2x2x2_sum_cpu(const octree* in, octree* out) {
-  octree_gridpool2x2x2_cpu<REDUCE_SUM>(in, out);
+  octree_gridpool2x2x2_cpu<REDUCE_SUM>(in, out, 0);
 }
 
 
@@ -293,5 +307,8 @@ void octree_gridpool2x2x2_avg_bwd_cpu(const octree* in, const octree* grad_out,
   octree_gridpool2x2x2_bwd_cpu<REDUCE_AVG>(in, grad_out, grad_in);
 }
 void octree_gridpool2x2x2_max_bwd_cpu(const octree* in, const octree* grad_out, octree* grad_in) {
-  octree_gridpool2x2x2_bwd_cpu<REDUCE_AVG>(in, grad_out, grad_in);
+  octree_gridpool2x2x2_bwd_cpu<REDUCE_MAX>(in, grad_out, grad_in);
+}
+void octree_gridpool2x2x2_max_argmax_bwd_cpu(const octree* in, const octree* grad_out, const int* argmax, octree* grad_in) {
+  octree_pool_argmax_scatter_cpu(in, grad_out, argmax, grad_in);
 }
@@ -192,88 +192,89 @@ void octree_gridunpool2x2x2_do_bwd_cpu(const octree* in, const octree* grad_out,
   octree_cpy_trees_cpu_cpu(in, grad_in);
   octree_cpy_prefix_leafs_cpu_cpu(in, grad_in);
 
-  const int out_n_blocks = octree_num_blocks(grad_out);
+  const int in_n_blocks = octree_num_blocks(in);
   const int feature_size = in->feature_size;
 
   octree_fill_data_cpu(grad_in, 0);
 
+  // every input block is unpooled to 2x2x2 output blocks, hence, the thread
+  // that owns an input block gathers the gradients of its output blocks 
+  // without atomics
   #pragma omp parallel for
-  for(int out_grid_idx = 0; out_grid_idx < out_n_blocks; ++out_grid_idx) {
-    int gn, ogd, ogh, ogw;
-    octree_split_grid_idx(grad_out, out_grid_idx, &gn, &ogd, &ogh, &ogw); 
+  for(int in_grid_idx = 0; in_grid_idx < in_n_blocks; ++in_grid_idx) {
+    int gn, igd, igh, igw;
+    octree_split_grid_idx(in, in_grid_idx, &gn, &igd, &igh, &igw); 
 
-    int igd = ogd / 2;
-    int igh = ogh / 2;
-    int igw = ogw / 2;
-    int in_grid_idx = octree_grid_idx(in, gn, igd, igh, igw);
+    for(int out_child = 0; out_child < 8; ++out_child) {
+      int ogd = 2 * igd + out_child / 4;
+      int ogh = 2 * igh + (out_child / 2) % 2;
+      int ogw = 2 * igw + out_child % 2;
+      int out_grid_idx = octree_grid_idx(grad_out, gn, ogd, ogh, ogw);
 
-    // printf("  o %d,%d,%d, i %d,%d,%d\n", ogd,ogh,ogw, igd,igh,igw);
+      // printf("  o %d,%d,%d, i %d,%d,%d\n", ogd,ogh,ogw, igd,igh,igw);
     
-    ot_tree_t* otree = octree_get_tree(grad_out, out_grid_idx);
-    // ot_data_t* odata = grad_out->data_ptrs[out_grid_idx];
-    ot_data_t* odata = octree_get_data(grad_out, out_grid_idx);
-    ot_tree_t* itree = octree_get_tree(grad_in, in_grid_idx);
-    // ot_data_t* idata = grad_in->data_ptrs[in_grid_idx];
-    ot_data_t* idata = octree_get_data(grad_in, in_grid_idx);
+      ot_tree_t* otree = octree_get_tree(grad_out, out_grid_idx);
+      // ot_data_t* odata = grad_out->data_ptrs[out_grid_idx];
+      ot_data_t* odata = octree_get_data(grad_out, out_grid_idx);
+      ot_tree_t* itree = octree_get_tree(grad_in, in_grid_idx);
+      // ot_data_t* idata = grad_in->data_ptrs[in_grid_idx];
+      ot_data_t* idata = octree_get_data(grad_in, in_grid_idx);
     
-    int in_bit_idx_l0 = 1 + (ogd % 2) * 4 + (ogh % 2) * 2 + (ogw % 2);
-    if(!tree_isset_bit(otree, 0)) {
-      int odata_idx = 0;
-      int in_bit_idx = tree_bit_idx_leaf(itree, in_bit_idx_l0);
-      int idata_idx = tree_data_idx(itree, in_bit_idx, feature_size);
-      for(int f = 0; f < feature_size; ++f) { 
-        #pragma omp atomic
-        idata[idata_idx + f] += odata[odata_idx + f]; 
+      int in_bit_idx_l0 = 1 + (ogd % 2) * 4 + (ogh % 2) * 2 + (ogw % 2);
+      if(!tree_isset_bit(otree, 0)) {
+        int odata_idx = 0;
+        int in_bit_idx = tree_bit_idx_leaf(itree, in_bit_idx_l0);
+        int idata_idx = tree_data_idx(itree, in_bit_idx, feature_size);
+        for(int f = 0; f < feature_size; ++f) { 
+          idata[idata_idx + f] += odata[odata_idx + f]; 
+        }
       }
-    }
-    else {
-      for(int dl1 = 0; dl1 < 2; ++dl1) {
-        for(int hl1 = 0; hl1 < 2; ++hl1) {
-          for(int wl1 = 0; wl1 < 2; ++wl1) {
-            int out_bit_idx_l1 = 1 + dl1 * 4 + hl1 * 2 + wl1;
-            int in_bit_idx_l1 = tree_child_bit_idx(in_bit_idx_l0) + dl1 * 4 + hl1 * 2 + wl1;
-            if(!tree_isset_bit(otree, out_bit_idx_l1)) {
-              int odata_idx = tree_data_idx(otree, out_bit_idx_l1, feature_size);
-              int in_bit_idx = tree_bit_idx_leaf(itree, in_bit_idx_l1);
-              int idata_idx = tree_data_idx(itree, in_bit_idx, feature_size);
-              for(int f = 0; f < feature_size; ++f) { 
-                // odata[odata_idx + f] = idata[idata_idx + f]; 
-                #pragma omp atomic
-                idata[idata_idx + f] += odata[odata_idx + f]; 
+      else {
+        for(int dl1 = 0; dl1 < 2; ++dl1) {
+          for(int hl1 = 0; hl1 < 2; ++hl1) {
+            for(int wl1 = 0; wl1 < 2; ++wl1) {
+              int out_bit_idx_l1 = 1 + dl1 * 4 + hl1 * 2 + wl1;
+              int in_bit_idx_l1 = tree_child_bit_idx(in_bit_idx_l0) + dl1 * 4 + hl1 * 2 + wl1;
+              if(!tree_isset_bit(otree, out_bit_idx_l1)) {
+                int odata_idx = tree_data_idx(otree, out_bit_idx_l1, feature_size);
+                int in_bit_idx = tree_bit_idx_leaf(itree, in_bit_idx_l1);
+                int idata_idx = tree_data_idx(itree, in_bit_idx, feature_size);
+                for(int f = 0; f < feature_size; ++f) { 
+                  // odata[odata_idx + f] = idata[idata_idx + f]; 
+                  idata[idata_idx + f] += odata[odata_idx + f]; 
+                }
               }
-            }
-            else {
-              for(int dl2 = 0; dl2 < 2; ++dl2) {
-                for(int hl2 = 0; hl2 < 2; ++hl2) {
-                  for(int wl2 = 0; wl2 < 2; ++wl2) {
-                    int out_bit_idx_l2 = tree_child_bit_idx(out_bit_idx_l1) + dl2 * 4 + hl2 * 2 + wl2;
-                    int in_bit_idx_l2 = tree_child_bit_idx(in_bit_idx_l1) + dl2 * 4 + hl2 * 2 + wl2;
-                    // printf("%d,%d\n", out_bit_idx_l2, in_bit_idx_l2);
-                    if(!tree_isset_bit(otree, out_bit_idx_l2)) {
-                      int odata_idx = tree_data_idx(otree, out_bit_idx_l2, feature_size);
-                      int in_bit_idx = tree_bit_idx_leaf(itree, in_bit_idx_l2);
-                      int idata_idx = tree_data_idx(itree, in_bit_idx, feature_size);
-                      for(int f = 0; f < feature_size; ++f) { 
-                        // odata[odata_idx + f] = idata[idata_idx + f]; 
-                        #pragma omp atomic
-                        idata[idata_idx + f] += odata[odata_idx + f]; 
-                      }
-                    }
-                    else {
-                      for(int bit_add = 0; bit_add < 8; ++bit_add) {
-                        int out_bit_idx_l3 = tree_child_bit_idx(out_bit_idx_l2) + bit_add;
-                        // int in_bit_idx_l3 = tree_child_bit_idx(in_bit_idx_l2);
-                        int in_bit_idx_l3 = in_bit_idx_l2 > 72 ? in_bit_idx_l2 : tree_child_bit_idx(in_bit_idx_l2);
-                        // printf("  %d,%d\n", out_bit_idx_l3, in_bit_idx_l3);
-                        int odata_idx = tree_data_idx(otree, out_bit_idx_l3, feature_size);
-                        int in_bit_idx = tree_bit_idx_leaf(itree, in_bit_idx_l3);
+              else {
+                for(int dl2 = 0; dl2 < 2; ++dl2) {
+                  for(int hl2 = 0; hl2 < 2; ++hl2) {
+                    for(int wl2 = 0; wl2 < 2; ++wl2) {
+                      int out_bit_idx_l2 = tree_child_bit_idx(out_bit_idx_l1) + dl2 * 4 + hl2 * 2 + wl2;
+                      int in_bit_idx_l2 = tree_child_bit_idx(in_bit_idx_l1) + dl2 * 4 + hl2 * 2 + wl2;
+                      // printf("%d,%d\n", out_bit_idx_l2, in_bit_idx_l2);
+                      if(!tree_isset_bit(otree, out_bit_idx_l2)) {
+                        int odata_idx = tree_data_idx(otree, out_bit_idx_l2, feature_size);
+                        int in_bit_idx = tree_bit_idx_leaf(itree, in_bit_idx_l2);
                         int idata_idx = tree_data_idx(itree, in_bit_idx, feature_size);
                         for(int f = 0; f < feature_size; ++f) { 
                           // odata[odata_idx + f] = idata[idata_idx + f]; 
-                          #pragma omp atomic
                           idata[idata_idx + f] += odata[odata_idx + f]; 
                         }
                       }
+                      else {
+                        for(int bit_add = 0; bit_add < 8; ++bit_add) {
+                          int out_bit_idx_l3 = tree_child_bit_idx(out_bit_idx_l2) + bit_add;
+                          // int in_bit_idx_l3 = tree_child_bit_idx(in_bit_idx_l2);
+                          int in_bit_idx_l3 = in_bit_idx_l2 > 72 ? in_bit_idx_l2 : tree_child_bit_idx(in_bit_idx_l2);
+                          // printf("  %d,%d\n", out_bit_idx_l3, in_bit_idx_l3);
+                          int odata_idx = tree_data_idx(otree, out_bit_idx_l3, feature_size);
+                          int in_bit_idx = tree_bit_idx_leaf(itree, in_bit_idx_l3);
+                          int idata_idx = tree_data_idx(itree, in_bit_idx, feature_size);
+                          for(int f = 0; f < feature_size; ++f) { 
+                            // odata[odata_idx + f] = idata[idata_idx + f]; 
+                            idata[idata_idx + f] += odata[odata_idx + f]; 
+                          }
+                        }
+                      }
                     }
                   }
                 }
@@ -282,9 +283,9 @@ void octree_gridunpool2x2x2_do_bwd_cpu(const octree* in, const octree* grad_out,
           }
         }
       }
-    }
 
-  } //for out_grid_idx
+    } // for out_child
+  } //for in_grid_idx
 }
 
 
@@ -26,6 +26,7 @@
 #include "octnet/cpu/io.h"
 #include "octnet/cpu/cpu.h"
 #include "octnet/cpu/dense.h"
+#include "octnet/cpu/file_mapping.h"
 
 #include <iostream>
 #include <sstream>
@@ -38,8 +39,20 @@
 #include <omp.h>
 #endif
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OT_F16C_DISPATCH
+#include <immintrin.h>
+#endif
+
 #define OC2_MAGIC_NUMBER 31193
+#define OC3_MAGIC_NUMBER 31195
+#define OCC_MAGIC_NUMBER 31197
 #define DENSE2_MAGIC_NUMBER 61027
+#define DENSE3_MAGIC_NUMBER 61029
+
+/// number of elements that are converted per chunk when reading/writing
+/// reduced precision data sections (multiplied by the number of channels).
+#define STORAGE_CHUNK_SIZE 16384
 
 
 void sfread(void* dst, int size, int count, FILE* fp) {
@@ -51,6 +64,436 @@ void sfread(void* dst, int size, int count, FILE* fp) {
 }
 
 
+int storage_type_size(int storage_type) {
+  switch(storage_type) {
+    case OT_STORAGE_FLOAT32: return sizeof(float);
+    case OT_STORAGE_FLOAT16: return sizeof(unsigned short);
+    case OT_STORAGE_UINT8:   return sizeof(unsigned char);
+    case OT_STORAGE_INT8:    return sizeof(signed char);
+  }
+  printf("[ERROR] unknown storage type %d\n", storage_type);
+  exit(-1);
+}
+
+/// Converts a float to IEEE 754 half precision, rounds to nearest even.
+inline unsigned short float_to_half(float f) {
+  unsigned int x;
+  memcpy(&x, &f, sizeof(x));
+  unsigned int sign = (x >> 16) & 0x8000;
+  unsigned int exp = (x >> 23) & 0xff;
+  unsigned int mant = x & 0x7fffff;
+
+  if(exp == 0xff) {
+    return sign | 0x7c00 | (mant ? 0x200 : 0);
+  }
+  int e = int(exp) - 127 + 15;
+  if(e >= 0x1f) {
+    return sign | 0x7c00;
+  }
+  if(e <= 0) {
+    if(e < -10) {
+      return sign;
+    }
+    mant |= 0x800000;
+    int shift = 14 - e;
+    unsigned int h = mant >> shift;
+    unsigned int rem = mant & ((1u << shift) - 1);
+    unsigned int half = 1u << (shift - 1);
+    if(rem > half || (rem == half && (h & 1))) {
+      h++;
+    }
+    return sign | h;
+  }
+  unsigned int h = (e << 10) | (mant >> 13);
+  unsigned int rem = mant & 0x1fff;
+  if(rem > 0x1000 || (rem == 0x1000 && (h & 1))) {
+    h++;
+  }
+  return sign | h;
+}
+
+/// Converts an IEEE 754 half precision value to float.
+inline float half_to_float(unsigned short h) {
+  unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+  unsigned int exp = (h >> 10) & 0x1f;
+  unsigned int mant = h & 0x3ff;
+  unsigned int x;
+  if(exp == 0) {
+    if(mant == 0) {
+      x = sign;
+    }
+    else {
+      exp = 127 - 15 + 1;
+      while(!(mant & 0x400)) {
+        mant <<= 1;
+        exp--;
+      }
+      x = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+  }
+  else if(exp == 0x1f) {
+    x = sign | 0x7f800000 | (mant << 13);
+  }
+  else {
+    x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+  }
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+/// Determines the per-channel scale and offset for the quantized storage types,
+/// such that value = scale * q + offset. Non-finite values are ignored and
+/// get clamped on encoding.
+void storage_quant_params(const ot_data_t* data, long n_elems, int n_channels, int storage_type, float* scale, float* offset) {
+  for(int c = 0; c < n_channels; ++c) {
+    scale[c] = 1;
+    offset[c] = 0;
+  }
+  if(storage_type != OT_STORAGE_UINT8 && storage_type != OT_STORAGE_INT8) {
+    return;
+  }
+
+  std::vector<float> min(n_channels, 1e38f);
+  std::vector<float> max(n_channels, -1e38f);
+  for(long idx = 0; idx < n_elems; ++idx) {
+    float val = data[idx];
+    int c = idx % n_channels;
+    if(std::isfinite(val)) {
+      min[c] = FMIN(min[c], val);
+      max[c] = FMAX(max[c], val);
+    }
+  }
+
+  for(int c = 0; c < n_channels; ++c) {
+    if(min[c] > max[c]) {
+      min[c] = max[c] = 0;
+    }
+    float range = max[c] - min[c];
+    if(storage_type == OT_STORAGE_UINT8) {
+      scale[c] = range > 0 ? range / 255.f : 1;
+      offset[c] = min[c];
+    }
+    else {
+      scale[c] = range > 0 ? range / 254.f : 1;
+      offset[c] = min[c] + 127.f * scale[c];
+    }
+  }
+}
+
+/// Encodes n_elems interleaved values (n_channels channels) of data to the
+/// given storage type.
+void storage_encode(const ot_data_t* src, long n_elems, int n_channels, int storage_type, const float* scale, const float* offset, void* dst) {
+  if(storage_type == OT_STORAGE_FLOAT32) {
+    memcpy(dst, src, n_elems * sizeof(float));
+  }
+  else if(storage_type == OT_STORAGE_FLOAT16) {
+    unsigned short* dst_h = (unsigned short*) dst;
+    for(long idx = 0; idx < n_elems; ++idx) {
+      dst_h[idx] = float_to_half(src[idx]);
+    }
+  }
+  else {
+    float q_min = storage_type == OT_STORAGE_UINT8 ? 0 : -127;
+    float q_max = storage_type == OT_STORAGE_UINT8 ? 255 : 127;
+    for(long idx = 0; idx < n_elems; ++idx) {
+      int c = idx % n_channels;
+      float val = src[idx];
+      float q = val != val ? (q_min + q_max) / 2 : roundf((val - offset[c]) / scale[c]);
+      q = FMIN(q_max, FMAX(q_min, q));
+      if(storage_type == OT_STORAGE_UINT8) {
+        ((unsigned char*) dst)[idx] = (unsigned char) q;
+      }
+      else {
+        ((signed char*) dst)[idx] = (signed char) q;
+      }
+    }
+  }
+}
+
+#if defined(OT_F16C_DISPATCH)
+/// Converts float16 to float with F16C four values at a time. The function is
+/// compiled for F16C independent of the compiler flags, hence, it must only be
+/// called if the CPU supports F16C.
+/// @return the number of converted values, a multiple of 4.
+__attribute__((target("f16c")))
+static long half_to_float_f16c(const unsigned short* src_h, long n_elems, float* dst) {
+  long idx = 0;
+  for(; idx + 4 <= n_elems; idx += 4) {
+    __m128i h = _mm_loadl_epi64((const __m128i*) (src_h + idx));
+    _mm_storeu_ps(dst + idx, _mm_cvtph_ps(h));
+  }
+  return idx;
+}
+#endif
+
+/// Decodes n_elems interleaved values (n_channels channels) of the given 
+/// storage type to float. The quantized types are converted with SSE four 
+/// values at a time, float16 with F16C if the CPU supports it (checked at run
+/// time), otherwise with the scalar half_to_float.
+void storage_decode(const void* src, long n_elems, int n_channels, int storage_type, const float* scale, const float* offset, ot_data_t* dst) {
+  if(storage_type == OT_STORAGE_FLOAT32) {
+    memcpy(dst, src, n_elems * sizeof(float));
+    return;
+  }
+
+  long idx = 0;
+  if(storage_type == OT_STORAGE_FLOAT16) {
+    const unsigned short* src_h = (const unsigned short*) src;
+#if defined(OT_F16C_DISPATCH)
+    static const bool has_f16c = __builtin_cpu_supports("f16c");
+    if(has_f16c) {
+      idx = half_to_float_f16c(src_h, n_elems, dst);
+    }
+#endif
+    for(; idx < n_elems; ++idx) {
+      dst[idx] = half_to_float(src_h[idx]);
+    }
+    return;
+  }
+
+  // repeat the channel pattern of scale and offset 4 times, then each 4-lane
+  // vector at a multiple of 4 within a 4*n_channels block sees the right channels
+  int n_pattern = 4 * n_channels;
+  std::vector<float> scale4(n_pattern);
+  std::vector<float> offset4(n_pattern);
+  for(int pidx = 0; pidx < n_pattern; ++pidx) {
+    scale4[pidx] = scale[pidx % n_channels];
+    offset4[pidx] = offset[pidx % n_channels];
+  }
+
+  const unsigned char* src_b = (const unsigned char*) src;
+  long n_vec = n_elems - n_elems % n_pattern;
+  for(; idx < n_vec; idx += n_pattern) {
+    for(int pidx = 0; pidx < n_pattern; pidx += 4) {
+      int q4;
+      memcpy(&q4, src_b + idx + pidx, sizeof(q4));
+      __m128i qi = _mm_cvtsi32_si128(q4);
+      qi = storage_type == OT_STORAGE_UINT8 ? _mm_cvtepu8_epi32(qi) : _mm_cvtepi8_epi32(qi);
+      __m128 v = _mm_cvtepi32_ps(qi);
+      v = _mm_add_ps(_mm_mul_ps(v, _mm_loadu_ps(&scale4[pidx])), _mm_loadu_ps(&offset4[pidx]));
+      _mm_storeu_ps(dst + idx + pidx, v);
+    }
+  }
+  for(; idx < n_elems; ++idx) {
+    int c = idx % n_channels;
+    float q = storage_type == OT_STORAGE_UINT8 ? float(src_b[idx]) : float(((const signed char*) src)[idx]);
+    dst[idx] = q * scale[c] + offset[c];
+  }
+}
+
+/// Reads n_elems values of the given storage type from fp and converts them 
+/// chunk-wise to float. FLOAT32 data is read directly into dst.
+void sfread_storage(ot_data_t* dst, long n_elems, int n_channels, int storage_type, const float* scale, const float* offset, FILE* fp) {
+  if(storage_type == OT_STORAGE_FLOAT32) {
+    sfread(dst, sizeof(ot_data_t), n_elems, fp);
+    return;
+  }
+
+  int elem_size = storage_type_size(storage_type);
+  long chunk_size = long(STORAGE_CHUNK_SIZE) * n_channels;
+  std::vector<char> buffer(chunk_size * elem_size);
+  for(long idx = 0; idx < n_elems; idx += chunk_size) {
+    long n_chunk = n_elems - idx < chunk_size ? n_elems - idx : chunk_size;
+    sfread(&buffer[0], elem_size, n_chunk, fp);
+    storage_decode(&buffer[0], n_chunk, n_channels, storage_type, scale, offset, dst + idx);
+  }
+}
+
+/// Converts n_elems float values chunk-wise to the given storage type and 
+/// writes them to fp.
+void fwrite_storage(const ot_data_t* src, long n_elems, int n_channels, int storage_type, const float* scale, const float* offset, FILE* fp) {
+  if(storage_type == OT_STORAGE_FLOAT32) {
+    fwrite(src, sizeof(ot_data_t), n_elems, fp);
+    return;
+  }
+
+  int elem_size = storage_type_size(storage_type);
+  long chunk_size = long(STORAGE_CHUNK_SIZE) * n_channels;
+  std::vector<char> buffer(chunk_size * elem_size);
+  for(long idx = 0; idx < n_elems; idx += chunk_size) {
+    long n_chunk = n_elems - idx < chunk_size ? n_elems - idx : chunk_size;
+    storage_encode(src + idx, n_chunk, n_channels, storage_type, scale, offset, &buffer[0]);
+    fwrite(&buffer[0], elem_size, n_chunk, fp);
+  }
+}
+
+/// Reads the header of an OC2, OC3, or OCC file. The scalar values are written
+/// to grid_h, the storage type and the per-channel scale/offset of the data
+/// section are returned by the remaining parameters. For OCC files the 
+/// channel offsets that follow are not read.
+void octree_read_header(FILE* fp, octree* grid_h, int* storage_type, std::vector<float>& scale, std::vector<float>& offset) {
+  int magic_number = -1;
+  sfread(&(magic_number), sizeof(ot_size_t), 1, fp);
+  if(magic_number != OC2_MAGIC_NUMBER && magic_number != OC3_MAGIC_NUMBER && magic_number != OCC_MAGIC_NUMBER) {
+    printf("[ERROR] invalid magic number %d\n", magic_number);
+    exit(-1);
+  }
+  sfread(&(grid_h->n), sizeof(ot_size_t), 1, fp);
+  sfread(&(grid_h->grid_depth), sizeof(ot_size_t), 1, fp);
+  sfread(&(grid_h->grid_height), sizeof(ot_size_t), 1, fp);
+  sfread(&(grid_h->grid_width), sizeof(ot_size_t), 1, fp);
+  sfread(&(grid_h->feature_size), sizeof(ot_size_t), 1, fp);
+  sfread(&(grid_h->n_leafs), sizeof(ot_size_t), 1, fp);
+
+  scale.assign(grid_h->feature_size, 1);
+  offset.assign(grid_h->feature_size, 0);
+  storage_type[0] = OT_STORAGE_FLOAT32;
+  if(magic_number == OC3_MAGIC_NUMBER || magic_number == OCC_MAGIC_NUMBER) {
+    sfread(storage_type, sizeof(int), 1, fp);
+    storage_type_size(storage_type[0]);
+    sfread(scale.data(), sizeof(float), grid_h->feature_size, fp);
+    sfread(offset.data(), sizeof(float), grid_h->feature_size, fp);
+  }
+}
+
+/// Reads the header of a columnar OCC file, including the trees and 
+/// prefix_leafs arrays. ch_offsets contains the byte offset of every 
+/// channel section in the file. grid_h is resized with feature_size = 0, so
+/// no memory is allocated for the data array.
+void octree_read_columnar_header(FILE* fp, octree* grid_h, int* storage_type, std::vector<float>& scale, std::vector<float>& offset, std::vector<long>& ch_offsets) {
+  int magic_number = -1;
+  sfread(&(magic_number), sizeof(ot_size_t), 1, fp);
+  if(magic_number != OCC_MAGIC_NUMBER) {
+    printf("[ERROR] invalid magic number %d for columnar octree\n", magic_number);
+    exit(-1);
+  }
+  sfread(&(grid_h->n), sizeof(ot_size_t), 1, fp);
+  sfread(&(grid_h->grid_depth), sizeof(ot_size_t), 1, fp);
+  sfread(&(grid_h->grid_height), sizeof(ot_size_t), 1, fp);
+  sfread(&(grid_h->grid_width), sizeof(ot_size_t), 1, fp);
+  sfread(&(grid_h->feature_size), sizeof(ot_size_t), 1, fp);
+  sfread(&(grid_h->n_leafs), sizeof(ot_size_t), 1, fp);
+  sfread(storage_type, sizeof(int), 1, fp);
+  storage_type_size(storage_type[0]);
+
+  int feature_size = grid_h->feature_size;
+  scale.resize(feature_size);
+  offset.resize(feature_size);
+  std::vector<long long> ch_offsets_ll(feature_size);
+  sfread(scale.data(), sizeof(float), feature_size, fp);
+  sfread(offset.data(), sizeof(float), feature_size, fp);
+  sfread(ch_offsets_ll.data(), sizeof(long long), feature_size, fp);
+  ch_offsets.assign(ch_offsets_ll.begin(), ch_offsets_ll.end());
+
+  grid_h->feature_size = 0;
+  octree_resize_as_cpu(grid_h, grid_h);
+  grid_h->feature_size = feature_size;
+
+  int n_blocks = octree_num_blocks(grid_h);
+  sfread(grid_h->trees, sizeof(ot_tree_t), N_TREE_INTS * n_blocks, fp);
+  sfread(grid_h->prefix_leafs, sizeof(ot_size_t), n_blocks, fp);
+}
+
+/// Reads the magic number of the file at path.
+int read_magic_number(const char* path) {
+  FILE* fp = fopen(path, "rb");
+  if(fp == 0) {
+    printf("[ERROR] could not open file %s\n", path);
+    exit(-1);
+  }
+  int magic_number = -1;
+  sfread(&(magic_number), sizeof(ot_size_t), 1, fp);
+  fclose(fp);
+  return magic_number;
+}
+
+/// A dense file that is memory mapped, with its parsed header.
+struct dense_mapping {
+  file_mapping file;
+  std::vector<int> dims;
+  int storage_type;
+  std::vector<float> scale;
+  std::vector<float> offset;
+  long size;
+  const char* payload;
+
+  dense_mapping() : storage_type(OT_STORAGE_FLOAT32), size(0), payload(0) {}
+};
+
+/// Memory maps the DENSE2, or DENSE3 file at path and parses its header. 
+/// The channels of the per-channel scale/offset are given by the last dim.
+/// @return 0 on success, otherwise a description of the error.
+const char* dense_map(const char* path, dense_mapping& m) {
+  const char* err = m.file.map(path);
+  if(err) {
+    return err;
+  }
+  if(m.file.length < 2 * sizeof(int)) {
+    return "file too small";
+  }
+
+  const char* end = m.file.end();
+  const char* ptr = m.file.begin();
+  int magic_number, n_dim;
+  memcpy(&magic_number, ptr, sizeof(int)); ptr += sizeof(int);
+  memcpy(&n_dim, ptr, sizeof(int)); ptr += sizeof(int);
+  if(magic_number != DENSE2_MAGIC_NUMBER && magic_number != DENSE3_MAGIC_NUMBER) {
+    return "invalid magic number";
+  }
+  if(n_dim < 0 || end - ptr < long(n_dim * sizeof(int))) {
+    return "invalid n_dim";
+  }
+  m.dims.resize(n_dim);
+  memcpy(m.dims.data(), ptr, n_dim * sizeof(int)); ptr += n_dim * sizeof(int);
+
+  m.size = 1;
+  for(int dim_idx = 0; dim_idx < n_dim; ++dim_idx) {
+    if(m.dims[dim_idx] < 0) {
+      return "negative dim";
+    }
+    m.size *= m.dims[dim_idx];
+  }
+  int n_channels = n_dim > 0 ? m.dims[n_dim - 1] : 1;
+  m.scale.assign(n_channels, 1);
+  m.offset.assign(n_channels, 0);
+  m.storage_type = OT_STORAGE_FLOAT32;
+  if(magic_number == DENSE3_MAGIC_NUMBER) {
+    if(end - ptr < long(sizeof(int) + 2 * n_channels * sizeof(float))) {
+      return "truncated header";
+    }
+    memcpy(&m.storage_type, ptr, sizeof(int)); ptr += sizeof(int);
+    if(m.storage_type < OT_STORAGE_FLOAT32 || m.storage_type > OT_STORAGE_INT8) {
+      return "invalid storage type";
+    }
+    memcpy(m.scale.data(), ptr, n_channels * sizeof(float)); ptr += n_channels * sizeof(float);
+    memcpy(m.offset.data(), ptr, n_channels * sizeof(float)); ptr += n_channels * sizeof(float);
+  }
+
+  if(end - ptr < m.size * storage_type_size(m.storage_type)) {
+    return "truncated data";
+  }
+  m.payload = ptr;
+  return 0;
+}
+
+/// Validates that the mapped tensor has the shape n_dim, dims.
+/// @return 0 on success, otherwise a description of the error.
+const char* dense_mapping_check_dims(const dense_mapping& m, int n_dim, const int* dims) {
+  if(int(m.dims.size()) != n_dim) {
+    return "invalid n_dim";
+  }
+  for(int dim_idx = 0; dim_idx < n_dim; ++dim_idx) {
+    if(dims[dim_idx] < 0) {
+      return "negative dim";
+    }
+    if(m.dims[dim_idx] != dims[dim_idx]) {
+      return "invalid size";
+    }
+  }
+  return 0;
+}
+
+/// Copies (FLOAT32), or decodes the payload of the mapped tensor to dst.
+void dense_mapping_copy(const dense_mapping& m, ot_data_t* dst) {
+  if(m.size == 0) {
+    return;
+  }
+  int n_channels = m.scale.size();
+  storage_decode(m.payload, m.size, n_channels, m.storage_type, m.scale.data(), m.offset.data(), dst);
+}
+
+
 
 extern "C"
 void octree_read_deprecated_cpu(const char* path, octree* grid_h) {
@@ -119,26 +562,22 @@ int* dense_read_header_deprecated_cpu(const char* path, int* n_dim) {
 
 extern "C"
 void octree_read_cpu(const char* path, octree* grid_h) {
+  if(read_magic_number(path) == OCC_MAGIC_NUMBER) {
+    octree_read_channels_cpu(path, -1, 0, 1, grid_h);
+    return;
+  }
+
   FILE* fp = fopen(path, "rb");
   
-  int magic_number = -1;
-  sfread(&(magic_number), sizeof(ot_size_t), 1, fp);
-  if(magic_number != OC2_MAGIC_NUMBER) {
-    printf("[ERROR] invalid magic number %d\n", magic_number);
-    exit(-1);
-  }
-  sfread(&(grid_h->n), sizeof(ot_size_t), 1, fp);
-  sfread(&(grid_h->grid_depth), sizeof(ot_size_t), 1, fp);
-  sfread(&(grid_h->grid_height), sizeof(ot_size_t), 1, fp);
-  sfread(&(grid_h->grid_width), sizeof(ot_size_t), 1, fp);
-  sfread(&(grid_h->feature_size), sizeof(ot_size_t), 1, fp);
-  sfread(&(grid_h->n_leafs), sizeof(ot_size_t), 1, fp);
+  int storage_type;
+  std::vector<float> scale, offset;
+  octree_read_header(fp, grid_h, &storage_type, scale, offset);
   
   octree_resize_as_cpu(grid_h, grid_h);
 
   int n_blocks = octree_num_blocks(grid_h);
   sfread(grid_h->trees, sizeof(ot_tree_t), N_TREE_INTS * n_blocks, fp);
-  sfread(grid_h->data, sizeof(ot_data_t), grid_h->n_leafs * grid_h->feature_size, fp);
+  sfread_storage(grid_h->data, long(grid_h->n_leafs) * grid_h->feature_size, grid_h->feature_size, storage_type, scale.data(), offset.data(), fp);
   sfread(grid_h->prefix_leafs, sizeof(ot_size_t), n_blocks, fp);
   fclose(fp);
 }
@@ -164,6 +603,204 @@ void octree_write_cpu(const char* path, const octree* grid_h) {
   fclose(fp);
 }
 
+extern "C"
+void octree_write_typed_cpu(const char* path, const octree* grid_h, int storage_type) {
+  storage_type_size(storage_type);
+  long n_elems = long(grid_h->n_leafs) * grid_h->feature_size;
+  std::vector<float> scale(grid_h->feature_size);
+  std::vector<float> offset(grid_h->feature_size);
+  storage_quant_params(grid_h->data, n_elems, grid_h->feature_size, storage_type, scale.data(), offset.data());
+
+  FILE* fp = fopen(path, "wb");
+
+  const ot_size_t magic_number = OC3_MAGIC_NUMBER;
+  fwrite(&(magic_number), sizeof(ot_size_t), 1, fp);
+  fwrite(&(grid_h->n), sizeof(ot_size_t), 1, fp);
+  fwrite(&(grid_h->grid_depth), sizeof(ot_size_t), 1, fp);
+  fwrite(&(grid_h->grid_height), sizeof(ot_size_t), 1, fp);
+  fwrite(&(grid_h->grid_width), sizeof(ot_size_t), 1, fp);
+  fwrite(&(grid_h->feature_size), sizeof(ot_size_t), 1, fp);
+  fwrite(&(grid_h->n_leafs), sizeof(ot_size_t), 1, fp);
+  fwrite(&(storage_type), sizeof(int), 1, fp);
+  fwrite(scale.data(), sizeof(float), grid_h->feature_size, fp);
+  fwrite(offset.data(), sizeof(float), grid_h->feature_size, fp);
+
+  int n_blocks = octree_num_blocks(grid_h);
+  fwrite(grid_h->trees, sizeof(ot_tree_t), N_TREE_INTS * n_blocks, fp);  
+  fwrite_storage(grid_h->data, n_elems, grid_h->feature_size, storage_type, scale.data(), offset.data(), fp);
+  fwrite(grid_h->prefix_leafs, sizeof(ot_size_t), n_blocks, fp);  
+
+  fclose(fp);
+}
+
+
+extern "C"
+void octree_write_columnar_cpu(const char* path, const octree* grid_h, int storage_type) {
+  storage_type_size(storage_type);
+  int feature_size = grid_h->feature_size;
+  long n_elems = long(grid_h->n_leafs) * feature_size;
+  std::vector<float> scale(feature_size);
+  std::vector<float> offset(feature_size);
+  storage_quant_params(grid_h->data, n_elems, feature_size, storage_type, scale.data(), offset.data());
+
+  int n_blocks = octree_num_blocks(grid_h);
+  long header_size = 8 * sizeof(ot_size_t) + 2 * feature_size * sizeof(float) + feature_size * sizeof(long long);
+  long section_size = long(grid_h->n_leafs) * storage_type_size(storage_type);
+  std::vector<long long> ch_offsets(feature_size);
+  for(int f = 0; f < feature_size; ++f) {
+    ch_offsets[f] = header_size + n_blocks * (N_TREE_INTS * sizeof(ot_tree_t) + sizeof(ot_size_t)) + f * section_size;
+  }
+
+  FILE* fp = fopen(path, "wb");
+
+  const ot_size_t magic_number = OCC_MAGIC_NUMBER;
+  fwrite(&(magic_number), sizeof(ot_size_t), 1, fp);
+  fwrite(&(grid_h->n), sizeof(ot_size_t), 1, fp);
+  fwrite(&(grid_h->grid_depth), sizeof(ot_size_t), 1, fp);
+  fwrite(&(grid_h->grid_height), sizeof(ot_size_t), 1, fp);
+  fwrite(&(grid_h->grid_width), sizeof(ot_size_t), 1, fp);
+  fwrite(&(grid_h->feature_size), sizeof(ot_size_t), 1, fp);
+  fwrite(&(grid_h->n_leafs), sizeof(ot_size_t), 1, fp);
+  fwrite(&(storage_type), sizeof(int), 1, fp);
+  fwrite(scale.data(), sizeof(float), feature_size, fp);
+  fwrite(offset.data(), sizeof(float), feature_size, fp);
+  fwrite(ch_offsets.data(), sizeof(long long), feature_size, fp);
+
+  fwrite(grid_h->trees, sizeof(ot_tree_t), N_TREE_INTS * n_blocks, fp);  
+  fwrite(grid_h->prefix_leafs, sizeof(ot_size_t), n_blocks, fp);  
+
+  // gather each channel in chunks and write it as contiguous section
+  long chunk_size = STORAGE_CHUNK_SIZE;
+  std::vector<ot_data_t> channel(chunk_size);
+  for(int f = 0; f < feature_size; ++f) {
+    for(long leaf_idx = 0; leaf_idx < grid_h->n_leafs; leaf_idx += chunk_size) {
+      long n_chunk = grid_h->n_leafs - leaf_idx < chunk_size ? grid_h->n_leafs - leaf_idx : chunk_size;
+      for(long idx = 0; idx < n_chunk; ++idx) {
+        channel[idx] = grid_h->data[(leaf_idx + idx) * feature_size + f];
+      }
+      fwrite_storage(&channel[0], n_chunk, 1, storage_type, &scale[f], &offset[f], fp);
+    }
+  }
+
+  fclose(fp);
+}
+
+extern "C"
+void octree_read_structure_cpu(const char* path, octree* grid_h) {
+  int magic_number = read_magic_number(path);
+  FILE* fp = fopen(path, "rb");
+
+  if(magic_number == OCC_MAGIC_NUMBER) {
+    int storage_type;
+    std::vector<float> scale, offset;
+    std::vector<long> ch_offsets;
+    octree_read_columnar_header(fp, grid_h, &storage_type, scale, offset, ch_offsets);
+  }
+  else {
+    int storage_type;
+    std::vector<float> scale, offset;
+    octree_read_header(fp, grid_h, &storage_type, scale, offset);
+    int feature_size = grid_h->feature_size;
+    grid_h->feature_size = 0;
+    octree_resize_as_cpu(grid_h, grid_h);
+
+    // skip the interleaved data section
+    int n_blocks = octree_num_blocks(grid_h);
+    sfread(grid_h->trees, sizeof(ot_tree_t), N_TREE_INTS * n_blocks, fp);
+    fseek(fp, long(grid_h->n_leafs) * feature_size * storage_type_size(storage_type), SEEK_CUR);
+    sfread(grid_h->prefix_leafs, sizeof(ot_size_t), n_blocks, fp);
+  }
+  grid_h->feature_size = 0;
+
+  fclose(fp);
+}
+
+extern "C"
+void octree_read_channels_cpu(const char* path, int n_channels, const int* channels, int n_threads, octree* grid_h) {
+  if(read_magic_number(path) != OCC_MAGIC_NUMBER) {
+    // interleaved file, read everything and extract the channels
+    octree* tmp = octree_new_cpu();
+    octree_read_cpu(path, tmp);
+    if(n_channels < 0) {
+      octree_copy_cpu(tmp, grid_h);
+    }
+    else {
+      for(int cidx = 0; cidx < n_channels; ++cidx) {
+        if(channels[cidx] < 0 || channels[cidx] >= tmp->feature_size) {
+          printf("[ERROR] invalid channel %d in octree_read_channels_cpu (feature_size %d)\n", channels[cidx], tmp->feature_size);
+          exit(-1);
+        }
+      }
+      octree_resize_cpu(tmp->n, tmp->grid_depth, tmp->grid_height, tmp->grid_width, n_channels, tmp->n_leafs, grid_h);
+      octree_cpy_trees_cpu_cpu(tmp, grid_h);
+      octree_cpy_prefix_leafs_cpu_cpu(tmp, grid_h);
+      for(int leaf_idx = 0; leaf_idx < tmp->n_leafs; ++leaf_idx) {
+        for(int cidx = 0; cidx < n_channels; ++cidx) {
+          grid_h->data[leaf_idx * n_channels + cidx] = tmp->data[leaf_idx * tmp->feature_size + channels[cidx]];
+        }
+      }
+    }
+    octree_free_cpu(tmp);
+    return;
+  }
+
+  FILE* fp = fopen(path, "rb");
+  int storage_type;
+  std::vector<float> scale, offset;
+  std::vector<long> ch_offsets;
+  octree_read_columnar_header(fp, grid_h, &storage_type, scale, offset, ch_offsets);
+  fclose(fp);
+
+  int file_feature_size = grid_h->feature_size;
+  std::vector<int> channels_all;
+  if(n_channels < 0) {
+    n_channels = file_feature_size;
+    for(int f = 0; f < file_feature_size; ++f) {
+      channels_all.push_back(f);
+    }
+    channels = channels_all.data();
+  }
+  for(int cidx = 0; cidx < n_channels; ++cidx) {
+    if(channels[cidx] < 0 || channels[cidx] >= file_feature_size) {
+      printf("[ERROR] invalid channel %d in octree_read_channels_cpu (feature_size %d)\n", channels[cidx], file_feature_size);
+      exit(-1);
+    }
+  }
+
+  grid_h->feature_size = n_channels;
+  octree_resize_as_cpu(grid_h, grid_h);
+  ot_data_t* data = grid_h->data;
+  long n_leafs = grid_h->n_leafs;
+  int elem_size = storage_type_size(storage_type);
+
+  // every thread reads whole channel sections and interleaves them into data,
+  // a serial read (e.g. by octree_read_cpu) leaves the thread count untouched
+  #if defined(_OPENMP)
+  if(n_threads > 1) {
+    omp_set_num_threads(n_threads);
+  }
+  #endif
+  #pragma omp parallel for if(n_threads > 1)
+  for(int cidx = 0; cidx < n_channels; ++cidx) {
+    int f = channels[cidx];
+    FILE* fp = fopen(path, "rb");
+    fseek(fp, ch_offsets[f], SEEK_SET);
+
+    long chunk_size = STORAGE_CHUNK_SIZE;
+    std::vector<char> buffer(chunk_size * elem_size);
+    std::vector<ot_data_t> channel(chunk_size);
+    for(long leaf_idx = 0; leaf_idx < n_leafs; leaf_idx += chunk_size) {
+      long n_chunk = n_leafs - leaf_idx < chunk_size ? n_leafs - leaf_idx : chunk_size;
+      sfread(&buffer[0], elem_size, n_chunk, fp);
+      storage_decode(&buffer[0], n_chunk, 1, storage_type, &scale[f], &offset[f], &channel[0]);
+      for(long idx = 0; idx < n_chunk; ++idx) {
+        data[(leaf_idx + idx) * n_channels + cidx] = channel[idx];
+      }
+    }
+    fclose(fp);
+  }
+}
+
 
 extern "C"
 void octree_dhwc_write_cpu(const char* path, const octree* grid_h) {
@@ -223,64 +860,60 @@ void dense_write_cpu(const char* path, int n_dim, const int* dims, const ot_data
 }
 
 extern "C"
-ot_data_t* dense_read_cpu(const char* path) {
-  FILE* fp = fopen(path, "rb");
-  
-  int magic_number = -1;
-  sfread(&(magic_number), sizeof(ot_size_t), 1, fp);
-  if(magic_number != DENSE2_MAGIC_NUMBER) {
-    printf("[ERROR] invalid magic number in dense_read_cpu\n");
-    exit(-1);
+void dense_write_typed_cpu(const char* path, int n_dim, const int* dims, const ot_data_t* data, int storage_type) {
+  storage_type_size(storage_type);
+  long size = 1;
+  for(int dim_idx = 0; dim_idx < n_dim; ++dim_idx) {
+    size *= dims[dim_idx];
   }
+  int n_channels = n_dim > 0 ? dims[n_dim - 1] : 1;
+  std::vector<float> scale(n_channels);
+  std::vector<float> offset(n_channels);
+  storage_quant_params(data, size, n_channels, storage_type, scale.data(), offset.data());
 
-  int n_dim = -1;
-  sfread(&(n_dim), sizeof(ot_size_t), 1, fp);
+  FILE* fp = fopen(path, "wb");
 
-  int size = 1;
-  for(int dim_idx = 0; dim_idx < n_dim; ++dim_idx) {
-    int dim_tmp;
-    sfread(&(dim_tmp), sizeof(int), 1, fp);
-    size *= dim_tmp;
-  }
+  const ot_size_t magic_number = DENSE3_MAGIC_NUMBER;
+  fwrite(&(magic_number), sizeof(ot_size_t), 1, fp);
+
+  fwrite(&(n_dim), sizeof(ot_size_t), 1, fp);
+  fwrite(dims, sizeof(int), n_dim, fp);
+  fwrite(&(storage_type), sizeof(int), 1, fp);
+  fwrite(scale.data(), sizeof(float), n_channels, fp);
+  fwrite(offset.data(), sizeof(float), n_channels, fp);
+
+  fwrite_storage(data, size, n_channels, storage_type, scale.data(), offset.data(), fp);
 
-  ot_data_t* data = new ot_data_t[size];
-  sfread(data, sizeof(ot_data_t), size, fp);
   fclose(fp);
+}
 
+extern "C"
+ot_data_t* dense_read_cpu(const char* path) {
+  dense_mapping m;
+  const char* err = dense_map(path, m);
+  if(err != 0) {
+    printf("[ERROR] %s (%s) in dense_read_cpu\n", err, path);
+    exit(-1);
+  }
+
+  ot_data_t* data = new ot_data_t[m.size];
+  dense_mapping_copy(m, data);
   return data;
 }
 
 extern "C"
 void dense_read_prealloc_cpu(const char* path, int n_dim, const int* dims, ot_data_t* data) {
-  FILE* fp = fopen(path, "rb");
-
-  int magic_number = -1;
-  sfread(&(magic_number), sizeof(ot_size_t), 1, fp);
-  if(magic_number != DENSE2_MAGIC_NUMBER) {
-    printf("[ERROR] invalid magic number in dense_read_cpu\n");
-    exit(-1);
+  dense_mapping m;
+  const char* err = dense_map(path, m);
+  if(err == 0) {
+    err = dense_mapping_check_dims(m, n_dim, dims);
   }
-  
-  int tmp_n_dim = -1;
-  sfread(&(tmp_n_dim), sizeof(ot_size_t), 1, fp);
-  if(n_dim != tmp_n_dim) {
-    printf("[ERROR] invalid n_dim read in dense_read_prealloc_cpu\n");
+  if(err != 0) {
+    printf("[ERROR] %s (%s) in dense_read_prealloc_cpu\n", err, path);
     exit(-1);
   }
 
-  int size = 1;
-  for(int dim_idx = 0; dim_idx < n_dim; ++dim_idx) {
-    int dim_tmp;
-    sfread(&(dim_tmp), sizeof(int), 1, fp);
-    if(dim_tmp != dims[dim_idx]) {
-      printf("invalid size in read_prealloc at dim_idx %d, parameter %d, read %d\n", dim_idx, dims[dim_idx], dim_tmp);
-      exit(-1);
-    }
-    size *= dim_tmp;
-  }
-
-  sfread(data, sizeof(ot_data_t), size, fp);
-  fclose(fp);
+  dense_mapping_copy(m, data);
 }
 
 
@@ -302,19 +935,12 @@ void octree_read_batch_cpu(int n_paths, char** paths, int n_threads, octree* gri
   ot_size_t n_leafs[n_paths];
   ot_size_t n_blocks[n_paths];
 
+  int storage_type;
+  std::vector<float> scale, offset;
   FILE* fp = fopen(paths[0], "rb");
-  int magic_number = -1;
-  sfread(&(magic_number), sizeof(ot_size_t), 1, fp);
-  if(magic_number != OC2_MAGIC_NUMBER) {
-    printf("[ERROR] invalid magic number %d\n", magic_number);
-    exit(-1);
-  }
-  sfread(&n, sizeof(ot_size_t), 1, fp);
-  sfread(&(grid_h->grid_depth), sizeof(ot_size_t), 1, fp);
-  sfread(&(grid_h->grid_height), sizeof(ot_size_t), 1, fp);
-  sfread(&(grid_h->grid_width), sizeof(ot_size_t), 1, fp);
-  sfread(&(grid_h->feature_size), sizeof(ot_size_t), 1, fp);
-  sfread(n_leafs, sizeof(ot_size_t), 1, fp);
+  octree_read_header(fp, grid_h, &storage_type, scale, offset);
+  n = grid_h->n;
+  n_leafs[0] = grid_h->n_leafs;
   n_blocks[0] = n * grid_h->grid_depth * grid_h->grid_height * grid_h->grid_width;
   fclose(fp);
 
@@ -325,21 +951,18 @@ void octree_read_batch_cpu(int n_paths, char** paths, int n_threads, octree* gri
   #endif
   #pragma omp parallel for reduction(+:n)
   for(int path_idx = 1; path_idx < n_paths; ++path_idx) {
-    int tmp_magic_number, tmp_n, tmp_grid_depth, tmp_grid_width, tmp_grid_height, tmp_feature_size;
-
+    octree tmp;
+    int tmp_storage_type;
+    std::vector<float> tmp_scale, tmp_offset;
     FILE* fp = fopen(paths[path_idx], "rb");
-    sfread(&(tmp_magic_number), sizeof(ot_size_t), 1, fp);
-    if(tmp_magic_number != OC2_MAGIC_NUMBER) {
-      printf("[ERROR] invalid magic number %d\n", tmp_magic_number);
-      exit(-1);
-    }
-    sfread(&tmp_n, sizeof(ot_size_t), 1, fp);
-    sfread(&(tmp_grid_depth), sizeof(ot_size_t), 1, fp);
-    sfread(&(tmp_grid_height), sizeof(ot_size_t), 1, fp);
-    sfread(&(tmp_grid_width), sizeof(ot_size_t), 1, fp);
-    sfread(&(tmp_feature_size), sizeof(ot_size_t), 1, fp);
-    sfread(n_leafs + path_idx, sizeof(ot_size_t), 1, fp);
+    octree_read_header(fp, &tmp, &tmp_storage_type, tmp_scale, tmp_offset);
     fclose(fp);
+    int tmp_n = tmp.n;
+    int tmp_grid_depth = tmp.grid_depth;
+    int tmp_grid_height = tmp.grid_height;
+    int tmp_grid_width = tmp.grid_width;
+    int tmp_feature_size = tmp.feature_size;
+    n_leafs[path_idx] = tmp.n_leafs;
     
     n += tmp_n;
     n_blocks[path_idx] = tmp_n * tmp_grid_depth * tmp_grid_height * tmp_grid_width;
@@ -381,20 +1004,32 @@ void octree_read_batch_cpu(int n_paths, char** paths, int n_threads, octree* gri
   #endif
   #pragma omp parallel for
   for(int path_idx = 0; path_idx < n_paths; ++path_idx) {
-    FILE* fp = fopen(paths[path_idx], "rb");
-    int tmp_magic_number = -1;
-    sfread(&(tmp_magic_number), sizeof(ot_size_t), 1, fp);
-    fseek(fp, sizeof(ot_size_t) * 7, SEEK_SET);
-
     ot_size_t n_leafs_offset  = path_idx == 0 ? 0 : n_leafs[path_idx - 1];
     ot_size_t n_leafs_num     = path_idx == 0 ? n_leafs[0] : n_leafs[path_idx] - n_leafs[path_idx-1];
     ot_size_t n_blocks_offset = path_idx == 0 ? 0 : n_blocks[path_idx - 1];
     ot_size_t n_blocks_num    = path_idx == 0 ? n_blocks[0] : n_blocks[path_idx] - n_blocks[path_idx-1];
 
-    sfread(grid_h->trees + n_blocks_offset * N_TREE_INTS, sizeof(ot_tree_t), N_TREE_INTS * n_blocks_num, fp);
-    sfread(grid_h->data + n_leafs_offset * grid_h->feature_size, sizeof(ot_data_t), n_leafs_num * grid_h->feature_size, fp);    
-    sfread(grid_h->prefix_leafs + n_blocks_offset, sizeof(ot_size_t), n_blocks_num, fp);
-    fclose(fp);
+    if(read_magic_number(paths[path_idx]) == OCC_MAGIC_NUMBER) {
+      // columnar file, read serially and copy to the batch
+      octree* tmp = octree_new_cpu();
+      octree_read_channels_cpu(paths[path_idx], -1, 0, 1, tmp);
+      memcpy(grid_h->trees + n_blocks_offset * N_TREE_INTS, tmp->trees, sizeof(ot_tree_t) * N_TREE_INTS * n_blocks_num);
+      memcpy(grid_h->data + long(n_leafs_offset) * grid_h->feature_size, tmp->data, sizeof(ot_data_t) * long(n_leafs_num) * grid_h->feature_size);
+      memcpy(grid_h->prefix_leafs + n_blocks_offset, tmp->prefix_leafs, sizeof(ot_size_t) * n_blocks_num);
+      octree_free_cpu(tmp);
+    }
+    else {
+      octree tmp;
+      int tmp_storage_type;
+      std::vector<float> tmp_scale, tmp_offset;
+      FILE* fp = fopen(paths[path_idx], "rb");
+      octree_read_header(fp, &tmp, &tmp_storage_type, tmp_scale, tmp_offset);
+
+      sfread(grid_h->trees + n_blocks_offset * N_TREE_INTS, sizeof(ot_tree_t), N_TREE_INTS * n_blocks_num, fp);
+      sfread_storage(grid_h->data + long(n_leafs_offset) * grid_h->feature_size, long(n_leafs_num) * grid_h->feature_size, grid_h->feature_size, tmp_storage_type, tmp_scale.data(), tmp_offset.data(), fp);
+      sfread(grid_h->prefix_leafs + n_blocks_offset, sizeof(ot_size_t), n_blocks_num, fp);
+      fclose(fp);
+    }
     
     for(int grid_idx = n_blocks_offset; grid_idx < n_blocks_offset + n_blocks_num; ++grid_idx) {
       grid_h->prefix_leafs[grid_idx] += n_leafs_offset;
@@ -403,9 +1038,43 @@ void octree_read_batch_cpu(int n_paths, char** paths, int n_threads, octree* gri
 }
 
 
+extern "C"
+void octree_read_n_leafs_batch_cpu(int n_paths, char** paths, int n_threads, ot_size_t* n_leafs) {
+  std::vector<char> invalid(n_paths, 0);
+
+  #if defined(_OPENMP)
+  omp_set_num_threads(n_threads);
+  #endif
+  #pragma omp parallel for
+  for(int path_idx = 0; path_idx < n_paths; ++path_idx) {
+    // magic number, n, grid_depth, grid_height, grid_width, feature_size, 
+    // n_leafs are the first values of all octree formats
+    int header[7];
+    FILE* fp = fopen(paths[path_idx], "rb");
+    if(fp == 0 || fread(header, sizeof(int), 7, fp) != 7 || 
+        (header[0] != OC2_MAGIC_NUMBER && header[0] != OC3_MAGIC_NUMBER && header[0] != OCC_MAGIC_NUMBER)) {
+      invalid[path_idx] = 1;
+    }
+    else {
+      n_leafs[path_idx] = header[6];
+    }
+    if(fp != 0) {
+      fclose(fp);
+    }
+  }
+
+  for(int path_idx = 0; path_idx < n_paths; ++path_idx) {
+    if(invalid[path_idx]) {
+      printf("[ERROR] could not read octree header of %s in octree_read_n_leafs_batch_cpu\n", paths[path_idx]);
+      exit(-1);
+    }
+  }
+}
+
+
 extern "C"
 void dense_read_prealloc_batch_cpu(int n_paths, char** paths, int n_threads, int n_dim, const int* dims, ot_data_t* data) {
-  int offset = 1;
+  long offset = 1;
   for(int dim_idx = 1; dim_idx < n_dim; ++dim_idx) {
     offset *= dims[dim_idx];
   }
@@ -415,13 +1084,31 @@ void dense_read_prealloc_batch_cpu(int n_paths, char** paths, int n_threads, int
   for(int dim_idx = 1; dim_idx < n_dim; ++dim_idx) {
     dims_single[dim_idx] = dims[dim_idx];
   }
+
+  // map all files and validate their headers in one pass, before any data is
+  // copied to the batch tensor
+  std::vector<dense_mapping> mappings(n_paths);
+  std::vector<const char*> errs(n_paths);
   
   #if defined(_OPENMP)
   omp_set_num_threads(n_threads);
   #endif
   #pragma omp parallel for
   for(int path_idx = 0; path_idx < n_paths; ++path_idx) {
-    dense_read_prealloc_cpu(paths[path_idx], n_dim, dims_single, data + path_idx * offset);
+    errs[path_idx] = dense_map(paths[path_idx], mappings[path_idx]);
+    if(errs[path_idx] == 0) {
+      errs[path_idx] = dense_mapping_check_dims(mappings[path_idx], n_dim, dims_single);
+    }
+  }
+  for(int path_idx = 0; path_idx < n_paths; ++path_idx) {
+    if(errs[path_idx] != 0) {
+      printf("[ERROR] %s (%s) in dense_read_prealloc_batch_cpu\n", errs[path_idx], paths[path_idx]);
+      exit(-1);
+    }
   }
-}
 
+  #pragma omp parallel for
+  for(int path_idx = 0; path_idx < n_paths; ++path_idx) {
+    dense_mapping_copy(mappings[path_idx], data + path_idx * offset);
+  }
+}
@@ -28,11 +28,23 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <vector>
 
 #if defined(_OPENMP)
 #include <omp.h>
 #endif
 
+/// The losses store the partial sums of every block, or leaf, and add them in
+/// index order afterwards. Hence, the result is independent of the number of
+/// threads and of the scheduling.
+inline ot_data_t octree_loss_sum(const std::vector<ot_data_t>& partials) {
+  double sum = 0;
+  for(size_t idx = 0; idx < partials.size(); ++idx) {
+    sum += partials[idx];
+  }
+  return sum;
+}
+
 
 extern "C"
 ot_data_t octree_mse_loss_cpu(const octree* input, const octree* target, bool size_average, bool check) {
@@ -44,7 +56,7 @@ ot_data_t octree_mse_loss_cpu(const octree* input, const octree* target, bool si
   const int n_blocks = octree_num_blocks(input);
   const int feature_size = input->feature_size;
 
-  ot_data_t output = 0;
+  std::vector<ot_data_t> block_out(n_blocks);
 
   #pragma omp parallel for
   for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
@@ -101,9 +113,9 @@ ot_data_t octree_mse_loss_cpu(const octree* input, const octree* target, bool si
       }
     }
 
-    #pragma omp atomic
-    output += grid_out;
+    block_out[grid_idx] = grid_out;
   }
+  ot_data_t output = octree_loss_sum(block_out);
 
   if(size_average) {
     output = output / (n_blocks * feature_size * 8 * 8 * 8);
@@ -201,7 +213,7 @@ ot_data_t octree_smooth_mae_loss_cpu(const octree* input, const octree* target,
   const int n_blocks = octree_num_blocks(input);
   const int feature_size = input->feature_size;
 
-  ot_data_t output = 0;
+  std::vector<ot_data_t> block_out(n_blocks);
 
   #pragma omp parallel for
   for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
@@ -249,9 +261,9 @@ ot_data_t octree_smooth_mae_loss_cpu(const octree* input, const octree* target,
       }
     }
 
-    #pragma omp atomic
-    output += grid_out;
+    block_out[grid_idx] = grid_out;
   }
+  ot_data_t output = octree_loss_sum(block_out);
 
   return output / (n_blocks * feature_size * 8 * 8 * 8);
 }
@@ -344,8 +356,8 @@ void octree_nll_loss_cpu(const octree* input, const octree* target, const ot_dat
   const int n_blocks = octree_num_blocks(input);
   const int feature_size = input->feature_size;
 
-  output[0] = 0;
-  total_weight[0] = 0;
+  std::vector<ot_data_t> block_out(n_blocks);
+  std::vector<ot_data_t> block_weight(n_blocks);
 
   #pragma omp parallel for
   for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
@@ -389,11 +401,11 @@ void octree_nll_loss_cpu(const octree* input, const octree* target, const ot_dat
       }
     }
 
-    #pragma omp atomic
-    output[0] += grid_out;
-    #pragma omp atomic
-    total_weight[0] += grid_weight;
+    block_out[grid_idx] = grid_out;
+    block_weight[grid_idx] = grid_weight;
   }
+  output[0] = octree_loss_sum(block_out);
+  total_weight[0] = octree_loss_sum(block_weight);
 
   if(size_average && total_weight[0] != 0) {
     output[0] /= total_weight[0];
@@ -496,7 +508,7 @@ void octree_bce_loss_cpu(const octree* input, const octree* target, bool size_av
   const int n_blocks = octree_num_blocks(input);
   const int feature_size = input->feature_size;
   
-  *output = 0;
+  std::vector<ot_data_t> leaf_out(input->n_leafs);
 
   #pragma omp parallel for
   for(int leaf_idx = 0; leaf_idx < input->n_leafs; ++leaf_idx) {
@@ -518,9 +530,9 @@ void octree_bce_loss_cpu(const octree* input, const octree* target, bool size_av
       grid_out += width*width*width * (log(x + EPS) * y + log(1. - x + EPS) * (1. - y));
     }
 
-    #pragma omp atomic
-    *output -= grid_out;
+    leaf_out[leaf_idx] = grid_out;
   }
+  *output = -octree_loss_sum(leaf_out);
 
   if(size_average) {
     *total_weight = octree_num_blocks(input) * input->feature_size * 8 * 8 * 8;
@@ -585,7 +597,7 @@ void octree_bce_dense_loss_cpu(const octree* input, const ot_data_t* target, boo
   const int dense_width = 8 * input->grid_width;
   const int feature_size = input->feature_size;
   
-  *output = 0;
+  std::vector<ot_data_t> leaf_out(input->n_leafs);
 
   #pragma omp parallel for
   for(int leaf_idx = 0; leaf_idx < input->n_leafs; ++leaf_idx) {
@@ -613,9 +625,9 @@ void octree_bce_dense_loss_cpu(const octree* input, const ot_data_t* target, boo
       }
     }
     
-    #pragma omp atomic
-    *output -= grid_out;
+    leaf_out[leaf_idx] = grid_out;
   }
+  *output = -octree_loss_sum(leaf_out);
 
   if(size_average) {
     *total_weight = octree_num_blocks(input) * input->feature_size * 8 * 8 * 8;
@@ -688,8 +700,8 @@ void octree_bce_ds_loss_cpu(const octree* input, const octree* target, const oct
   const int n_blocks = octree_num_blocks(input);
   const int feature_size = input->feature_size;
   
-  *output = 0;
-  *total_weight = 0;
+  std::vector<ot_data_t> leaf_out(input->n_leafs);
+  std::vector<ot_data_t> leaf_weight(input->n_leafs);
 
   #pragma omp parallel for
   for(int leaf_idx = 0; leaf_idx < input->n_leafs; ++leaf_idx) {
@@ -731,11 +743,11 @@ void octree_bce_ds_loss_cpu(const octree* input, const octree* target, const oct
       }
     }
 
-    #pragma omp atomic
-    *output -= grid_out;
-    #pragma omp atomic
-    *total_weight += grid_weight;
+    leaf_out[leaf_idx] = grid_out;
+    leaf_weight[leaf_idx] = grid_weight;
   }
+  *output = -octree_loss_sum(leaf_out);
+  *total_weight = octree_loss_sum(leaf_weight);
 
   if(size_average) {
     *output = (*output) / (*total_weight) ;
@@ -29,6 +29,9 @@
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstring>
 
 #if defined(_OPENMP)
 #include <omp.h>
@@ -97,3 +100,111 @@ void octree_determine_gt_split_cpu(const octree* struc, const ot_data_t* gt, oct
   }
 }
 
+
+
+/// Collapses the split node bit_idx of tree, if its children are leaves with
+/// homogeneous features in node_data (indexed by bit_idx).
+static void merge_homogeneous_node(ot_tree_t* tree, int bit_idx, ot_data_t eps, int feature_size, ot_data_t* node_data) {
+  int child_idx = tree_child_bit_idx(bit_idx);
+  if(child_idx < 73) {
+    for(int c = 0; c < 8; ++c) {
+      if(tree_isset_bit(tree, child_idx + c)) {
+        return;
+      }
+    }
+  }
+
+  const ot_data_t* first = node_data + child_idx * feature_size;
+  for(int c = 1; c < 8; ++c) {
+    const ot_data_t* child = node_data + (child_idx + c) * feature_size;
+    for(int f = 0; f < feature_size; ++f) {
+      if(fabs(child[f] - first[f]) > eps) {
+        return;
+      }
+    }
+  }
+
+  // average relative to the first child, such that identical children are
+  // merged without rounding
+  ot_data_t* dst = node_data + bit_idx * feature_size;
+  for(int f = 0; f < feature_size; ++f) {
+    ot_data_t diff = 0;
+    for(int c = 1; c < 8; ++c) {
+      diff += node_data[(child_idx + c) * feature_size + f] - first[f];
+    }
+    dst[f] = first[f] + diff / 8;
+  }
+  tree_unset_bit(tree, bit_idx);
+}
+
+/// @return true, if bit_idx is a leaf of tree.
+static bool tree_is_leaf(const ot_tree_t* tree, int bit_idx) {
+  if(bit_idx < 73 && tree_isset_bit(tree, bit_idx)) {
+    return false;
+  }
+  while(bit_idx > 0) {
+    bit_idx = tree_parent_bit_idx(bit_idx);
+    if(!tree_isset_bit(tree, bit_idx)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+extern "C"
+void octree_merge_homogeneous_cpu(const octree* in, ot_data_t eps, int n_threads, octree* out) {
+  const int n_blocks = octree_num_blocks(in);
+  const int feature_size = in->feature_size;
+  std::vector<ot_tree_t> trees(n_blocks * N_TREE_INTS);
+  std::vector<std::vector<ot_data_t> > block_data(n_blocks);
+
+#if defined(_OPENMP)
+  omp_set_num_threads(n_threads);
+#endif
+  #pragma omp parallel
+  {
+    // features of every node of a shallow octree, indexed by bit_idx
+    std::vector<ot_data_t> node_data(585 * feature_size);
+
+    #pragma omp for
+    for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
+      const ot_tree_t* in_tree = octree_get_tree(in, grid_idx);
+      const ot_data_t* in_data = octree_get_data(in, grid_idx);
+      ot_tree_t* tree = trees.data() + grid_idx * N_TREE_INTS;
+      memcpy(tree, in_tree, N_TREE_INTS * sizeof(ot_tree_t));
+
+      for(int bit_idx = 0; bit_idx < 585; ++bit_idx) {
+        if(tree_is_leaf(in_tree, bit_idx)) {
+          memcpy(node_data.data() + bit_idx * feature_size, in_data + tree_data_idx(in_tree, bit_idx, feature_size), feature_size * sizeof(ot_data_t));
+        }
+      }
+
+      // bottom-up, level 2, level 1, and root
+      for(int bit_idx = 72; bit_idx >= 0; --bit_idx) {
+        if(tree_isset_bit(tree, bit_idx)) {
+          merge_homogeneous_node(tree, bit_idx, eps, feature_size, node_data.data());
+        }
+      }
+
+      std::vector<ot_data_t>& data = block_data[grid_idx];
+      data.resize(tree_n_leafs(tree) * feature_size);
+      for(int bit_idx = 0; bit_idx < 585; ++bit_idx) {
+        if(tree_is_leaf(tree, bit_idx)) {
+          memcpy(data.data() + tree_data_idx(tree, bit_idx, feature_size), node_data.data() + bit_idx * feature_size, feature_size * sizeof(ot_data_t));
+        }
+      }
+    }
+  }
+
+  octree_resize_cpu(in->n, in->grid_depth, in->grid_height, in->grid_width, feature_size, 0, out);
+  memcpy(out->trees, trees.data(), n_blocks * N_TREE_INTS * sizeof(ot_tree_t));
+  octree_upd_n_leafs_cpu(out);
+  octree_resize_as_cpu(out, out);
+  octree_upd_prefix_leafs_cpu(out);
+
+  #pragma omp parallel for
+  for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
+    const std::vector<ot_data_t>& data = block_data[grid_idx];
+    memcpy(octree_get_data(out, grid_idx), data.data(), data.size() * sizeof(ot_data_t));
+  }
+}
@@ -74,7 +74,7 @@ void octree_pool2x2x2_struct_cpu(const octree* in, octree* out) {
 
 
 template <int pool_fcn>
-void octree_pool2x2x2_data_cpu(const octree* in, octree* out) {
+void octree_pool2x2x2_data_cpu(const octree* in, octree* out, int* argmax) {
   const int n_blocks = octree_num_blocks(in);
   const ot_size_t feature_size = in->feature_size;
 
@@ -91,6 +91,9 @@ void octree_pool2x2x2_data_cpu(const octree* in, octree* out) {
     if(tree_isset_bit(in_tree, 0)) {
       if(!tree_isset_bit(out_tree, 0)) {
         octree_pool2x2x2<pool_fcn>(in_data, feature_size, out_data);
+        if(argmax) {
+          octree_pool2x2x2_max_argmax(in_data, feature_size, in_data - in->data, argmax + (out_data - out->data));
+        }
       }
       else {
 
@@ -100,6 +103,9 @@ void octree_pool2x2x2_data_cpu(const octree* in, octree* out) {
             if(!tree_isset_bit(out_tree, bit_idx_l1)) {
               int in_data_idx = tree_data_idx(in_tree, tree_child_bit_idx(bit_idx_l1), feature_size);
               octree_pool2x2x2<pool_fcn>(in_data + in_data_idx, feature_size, out_data + out_data_idx_l1);
+              if(argmax) {
+                octree_pool2x2x2_max_argmax(in_data + in_data_idx, feature_size, in_data + in_data_idx - in->data, argmax + (out_data + out_data_idx_l1 - out->data));
+              }
             }
             else {
 
@@ -110,6 +116,9 @@ void octree_pool2x2x2_data_cpu(const octree* in, octree* out) {
                   if(!tree_isset_bit(out_tree, bit_idx_l2)) {
                     int in_data_idx = tree_data_idx(in_tree, tree_child_bit_idx(bit_idx_l2), feature_size);
                     octree_pool2x2x2<pool_fcn>(in_data + in_data_idx, feature_size, out_data + out_data_idx_l2);
+                    if(argmax) {
+                      octree_pool2x2x2_max_argmax(in_data + in_data_idx, feature_size, in_data + in_data_idx - in->data, argmax + (out_data + out_data_idx_l2 - out->data));
+                    }
                   }
                   else {
                     
@@ -117,12 +126,18 @@ void octree_pool2x2x2_data_cpu(const octree* in, octree* out) {
                     int out_data_idx_l3 = tree_data_idx(out_tree, bit_idx_l3, feature_size);
                     int in_data_idx_l3 = tree_data_idx(in_tree, bit_idx_l3, feature_size);
                     octree_cpy_leaf(in_data + in_data_idx_l3, 8*feature_size, out_data + out_data_idx_l3);
+                    if(argmax) {
+                      octree_cpy_leaf_argmax(in_data + in_data_idx_l3 - in->data, 8*feature_size, argmax + (out_data + out_data_idx_l3 - out->data));
+                    }
 
                   }
                 }
                 else {
                   int in_data_idx = tree_data_idx(in_tree, bit_idx_l2, feature_size);
                   octree_cpy_leaf(in_data + in_data_idx, feature_size, out_data + out_data_idx_l2);
+                  if(argmax) {
+                    octree_cpy_leaf_argmax(in_data + in_data_idx - in->data, feature_size, argmax + (out_data + out_data_idx_l2 - out->data));
+                  }
                 }
 
               }
@@ -132,6 +147,9 @@ void octree_pool2x2x2_data_cpu(const octree* in, octree* out) {
           else {
             int in_data_idx = tree_data_idx(in_tree, bit_idx_l1, feature_size);
             octree_cpy_leaf(in_data + in_data_idx, feature_size, out_data + out_data_idx_l1);
+            if(argmax) {
+              octree_cpy_leaf_argmax(in_data + in_data_idx - in->data, feature_size, argmax + (out_data + out_data_idx_l1 - out->data));
+            }
           }
         }
 
@@ -139,6 +157,9 @@ void octree_pool2x2x2_data_cpu(const octree* in, octree* out) {
     }
     else {
       octree_cpy_leaf(in_data, feature_size, out_data);
+      if(argmax) {
+        octree_cpy_leaf_argmax(in_data - in->data, feature_size, argmax + (out_data - out->data));
+      }
     }
 
   } 
@@ -147,7 +168,7 @@ void octree_pool2x2x2_data_cpu(const octree* in, octree* out) {
 
 
 template <int pool_fcn>
-void octree_pool2x2x2_cpu(const octree* in, bool level_0, bool level_1, bool level_2, octree* out) {
+void octree_pool2x2x2_cpu(const octree* in, bool level_0, bool level_1, bool level_2, octree* out, int* argmax) {
   octree_resize_cpu(in->n, in->grid_depth, in->grid_height, in->grid_width, in->feature_size, 0, out);
   octree_cpy_trees_cpu_cpu(in, out);
 
@@ -165,17 +186,21 @@ void octree_pool2x2x2_cpu(const octree* in, bool level_0, bool level_1, bool lev
   octree_resize_as_cpu(out, out);
   octree_upd_prefix_leafs_cpu(out);
 
-  octree_pool2x2x2_data_cpu<pool_fcn>(in, out);
+  octree_pool2x2x2_data_cpu<pool_fcn>(in, out, argmax);
 }
 
 
 
 void octree_pool2x2x2_avg_cpu(const octree* in, bool level_0, bool level_1, bool level_2, octree* out) {
-  octree_pool2x2x2_cpu<REDUCE_AVG>(in, level_0, level_1, level_2, out);
+  octree_pool2x2x2_cpu<REDUCE_AVG>(in, level_0, level_1, level_2, out, 0);
 }
 
 void octree_pool2x2x2_max_cpu(const octree* in, bool level_0, bool level_1, bool level_2, octree* out) {
-  octree_pool2x2x2_cpu<REDUCE_MAX>(in, level_0, level_1, level_2, out);
+  octree_pool2x2x2_cpu<REDUCE_MAX>(in, level_0, level_1, level_2, out, 0);
+}
+
+void octree_pool2x2x2_max_argmax_cpu(const octree* in, bool level_0, bool level_1, bool level_2, octree* out, int* argmax) {
+  octree_pool2x2x2_cpu<REDUCE_MAX>(in, level_0, level_1, level_2, out, argmax);
 }
 
 
@@ -266,3 +291,7 @@ void octree_pool2x2x2_avg_bwd_cpu(const octree* in, const octree* grad_out, octr
 void octree_pool2x2x2_max_bwd_cpu(const octree* in, const octree* grad_out, octree* grad_in) {
   octree_pool2x2x2_bwd_cpu<REDUCE_MAX>(in, grad_out, grad_in);
 }
+
+void octree_pool2x2x2_max_argmax_bwd_cpu(const octree* in, const octree* grad_out, const int* argmax, octree* grad_in) {
+  octree_pool_argmax_scatter_cpu(in, grad_out, argmax, grad_in);
+}
@@ -31,6 +31,10 @@
 #include "octnet/cpu/cpu.h"
 #include "octnet/test/objects.h"
 #include "octnet/cpu/bn.h"
+#include "octnet/cpu/dense.h"
+#include "octnet/cpu/conv.h"
+
+#include <vector>
 
 #define EPS 1e-4
 
@@ -154,9 +158,160 @@ void test_norm_bwd() {
   delete[] dl_dx;
 }
 
+// Statistics of a larger random octree with a big offset, compared to a
+// double precision reference on the dense volume.
+void test_norm_stat_rand() {
+  int gn = 4; int gd = 4; int gh = 5; int gw = 3; int fs = 3;
+  octree* grid = create_test_octree_rand(gn,gd,gh,gw, fs, 0.5,0.5,0.5, 1000.f, 1001.f);
+  
+  int dd = 8*gd; int dh = 8*gh; int dw = 8*gw;
+  int vx_per_sample = dd*dh*dw;
+  std::vector<ot_data_t> dense(gn * fs * vx_per_sample);
+  octree_to_cdhw_cpu(grid, dd, dh, dw, &dense[0]);
+  
+  std::vector<ot_data_t> avgs(fs, 0);
+  std::vector<ot_data_t> vars(fs, 0);
+  octree* grid_norm = octree_new_cpu();
+  octree_bn_norm_cpu(grid, &avgs[0], &vars[0], grid_norm);
+  
+  char buffer[100];
+  for (int c = 0; c < fs; ++c) {
+    double avg = 0;
+    for (int n = 0; n < gn; ++n) {
+      for (int idx = 0; idx < vx_per_sample; ++idx) {
+        avg += dense[(n*fs + c)*vx_per_sample + idx];
+      }
+    }
+    avg /= gn*vx_per_sample;
+    double var = 0;
+    for (int n = 0; n < gn; ++n) {
+      for (int idx = 0; idx < vx_per_sample; ++idx) {
+        double centered = dense[(n*fs + c)*vx_per_sample + idx] - avg;
+        var += centered*centered;
+      }
+    }
+    var /= gn*vx_per_sample;
+    
+    sprintf(buffer, "random average not right: %f != %f", avg, avgs[c]);
+    expect(fabs(avg - avgs[c]) < 1e-3, buffer);
+    sprintf(buffer, "random variance not right: %f != %f", var, vars[c]);
+    expect(fabs(var - vars[c]) < 1e-3*var, buffer);
+  }
+  
+  octree_free_cpu(grid);
+  octree_free_cpu(grid_norm);
+}
+
+// The fused forward and backward passes have to match the chained passes.
+void test_fused() {
+  int gn = 2; int gd = 2; int gh = 3; int gw = 2; int fs = 3;
+  octree* grid = create_test_octree_rand(gn,gd,gh,gw, fs, 0.5,0.5,0.5);
+  octree* grad_out = octree_new_cpu();
+  octree_copy_cpu(grid, grad_out);
+  for (int idx = 0; idx < grad_out->n_leafs * fs; ++idx) {
+    grad_out->data[idx] = float(rand()) / RAND_MAX - 0.5f;
+  }
+  
+  std::vector<ot_data_t> gamma(fs);
+  std::vector<ot_data_t> beta(fs);
+  for (int c = 0; c < fs; ++c) {
+    gamma[c] = 0.5f + c;
+    beta[c] = 0.25f - c;
+  }
+  
+  std::vector<ot_data_t> avgs(fs, 0), vars(fs, 0);
+  std::vector<ot_data_t> grad_gamma(fs, 0), grad_beta(fs, 0);
+  octree* norm = octree_new_cpu();
+  octree* out = octree_new_cpu();
+  octree* grad_norm = octree_new_cpu();
+  octree* grad_in = octree_new_cpu();
+  octree_bn_norm_cpu(grid, &avgs[0], &vars[0], norm);
+  octree_bn_ss_cpu(norm, &gamma[0], &beta[0], false, out);
+  octree_bn_ss_bwd_cpu(grad_out, &gamma[0], false, grad_norm);
+  octree_bn_ss_wbwd_cpu(norm, grad_out, &grad_gamma[0], &grad_beta[0]);
+  octree_bn_norm_bwd_cpu(grid, grad_norm, &avgs[0], &vars[0], grad_in);
+  
+  std::vector<ot_data_t> avgs_f(fs, 0), vars_f(fs, 0);
+  std::vector<ot_data_t> grad_gamma_f(fs, 0), grad_beta_f(fs, 0);
+  octree* out_f = octree_new_cpu();
+  octree* grad_in_f = octree_new_cpu();
+  octree_bn_cpu(grid, &avgs_f[0], &vars_f[0], &gamma[0], &beta[0], out_f);
+  octree_bn_bwd_cpu(grid, grad_out, &avgs_f[0], &vars_f[0], &gamma[0], grad_in_f, &grad_gamma_f[0], &grad_beta_f[0]);
+  
+  char buffer[100];
+  for (int c = 0; c < fs; ++c) {
+    sprintf(buffer, "fused grad gamma not right: %f != %f", grad_gamma[c], grad_gamma_f[c]);
+    expect(fabs(grad_gamma[c] - grad_gamma_f[c]) < 1e-3, buffer);
+    sprintf(buffer, "fused grad beta not right: %f != %f", grad_beta[c], grad_beta_f[c]);
+    expect(fabs(grad_beta[c] - grad_beta_f[c]) < 1e-3, buffer);
+  }
+  for (int idx = 0; idx < grid->n_leafs * fs; ++idx) {
+    sprintf(buffer, "fused output not right (%d): %f != %f", idx, out->data[idx], out_f->data[idx]);
+    expect(fabs(out->data[idx] - out_f->data[idx]) < EPS, buffer);
+    sprintf(buffer, "fused gradients not right (%d): %f != %f", idx, grad_in->data[idx], grad_in_f->data[idx]);
+    expect(fabs(grad_in->data[idx] - grad_in_f->data[idx]) < EPS, buffer);
+  }
+  
+  octree_free_cpu(grid);
+  octree_free_cpu(grad_out);
+  octree_free_cpu(norm);
+  octree_free_cpu(out);
+  octree_free_cpu(grad_norm);
+  octree_free_cpu(grad_in);
+  octree_free_cpu(out_f);
+  octree_free_cpu(grad_in_f);
+}
+
+// Convolution with folded batch normalization has to match the convolution
+// followed by batch normalization and scale and shift.
+void test_fold_conv() {
+  int gn = 2; int gd = 2; int gh = 1; int gw = 2; int fs = 3; int channels_out = 2;
+  octree* grid = create_test_octree_rand(gn,gd,gh,gw, fs, 0.5,0.5,0.5);
+  
+  std::vector<ot_data_t> weights(channels_out * fs * 3*3*3);
+  std::vector<ot_data_t> bias(channels_out);
+  for (size_t idx = 0; idx < weights.size(); ++idx) {
+    weights[idx] = float(rand()) / RAND_MAX - 0.5f;
+  }
+  std::vector<ot_data_t> gamma(channels_out), beta(channels_out);
+  for (int c = 0; c < channels_out; ++c) {
+    bias[c] = float(rand()) / RAND_MAX;
+    gamma[c] = 0.5f + c;
+    beta[c] = 0.25f - c;
+  }
+  
+  std::vector<ot_data_t> avgs(channels_out, 0), vars(channels_out, 0);
+  octree* conv = octree_new_cpu();
+  octree* norm = octree_new_cpu();
+  octree* out = octree_new_cpu();
+  octree_conv3x3x3_avg_cpu(grid, &weights[0], &bias[0], channels_out, conv);
+  octree_bn_norm_cpu(conv, &avgs[0], &vars[0], norm);
+  octree_bn_ss_cpu(norm, &gamma[0], &beta[0], false, out);
+  
+  std::vector<ot_data_t> weights_f(weights.size()), bias_f(channels_out);
+  octree_bn_fold_conv3x3x3_cpu(&weights[0], &bias[0], fs, channels_out, &avgs[0], &vars[0], &gamma[0], &beta[0], &weights_f[0], &bias_f[0]);
+  octree* out_f = octree_new_cpu();
+  octree_conv3x3x3_avg_cpu(grid, &weights_f[0], &bias_f[0], channels_out, out_f);
+  
+  char buffer[100];
+  for (int idx = 0; idx < out->n_leafs * channels_out; ++idx) {
+    sprintf(buffer, "folded conv not right (%d): %f != %f", idx, out->data[idx], out_f->data[idx]);
+    expect(fabs(out->data[idx] - out_f->data[idx]) < EPS, buffer);
+  }
+  
+  octree_free_cpu(grid);
+  octree_free_cpu(conv);
+  octree_free_cpu(norm);
+  octree_free_cpu(out);
+  octree_free_cpu(out_f);
+}
+
 int main(int argc, char** argv) {
   test_norm();
   test_norm_bwd();
+  test_norm_stat_rand();
+  test_fused();
+  test_fold_conv();
   return 0;
 }
 
@@ -28,6 +28,10 @@
 #include <vector>
 #include <string.h>
 
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
 #include "octnet/test/objects.h"
 
 #include "octnet/cpu/cpu.h"
@@ -36,6 +40,9 @@
 #include "octnet/cpu/io.h"
 #include "octnet/cpu/unpool.h"
 #include "octnet/cpu/split.h"
+#include "octnet/cpu/misc.h"
+#include "octnet/cpu/pool.h"
+#include "octnet/cpu/loss.h"
 
 void test_split_grid_idx_(int n, int grid_depth, int grid_height, int grid_width) {
   octree grid;
@@ -161,6 +168,7 @@ void test_IO(int n_threads) {
     octree_read_cpu(paths[idx].c_str(), grid);
     if(!octree_equal_cpu(grids[idx], grid)) {
       printf("[ERROR] octrees do not match\n");
+      exit(-1);
     }
     octree_free_cpu(grid);
   }
@@ -172,12 +180,51 @@ void test_IO(int n_threads) {
     octree_extract_n_cpu(grid, idx, idx+1, grid_ext);
     if(!octree_equal_cpu(grids[idx], grid_ext)) {
       printf("[ERROR] grid_ext is not the same as grids[%d]\n", idx);
+      exit(-1);
     }
     octree_free_cpu(grid_ext);
   }
   octree_free_cpu(grid);
   
   for(int idx = 0; idx < n; ++idx) {
+    remove(paths_c[idx]);
+    octree_free_cpu(grids[idx]);
+    delete[] paths_c[idx];
+  }
+  delete[] paths_c;
+  delete[] grids;
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_IO_n_leafs(int n_threads) {
+  std::cout << "[INFO] test_IO_n_leafs" << std::endl;
+  int n = 6;
+  octree** grids = new octree*[n];
+  char** paths_c = new char*[n];
+  for(int idx = 0; idx < n; ++idx) {
+    paths_c[idx] = new char[32];
+    snprintf(paths_c[idx], 32, "test_n_leafs_%d.oc", idx);
+    grids[idx] = create_test_octree_rand(1,4,8,8, 3, 0.5,0.5,0.5);
+    // interleaved and columnar headers
+    if(idx % 2 == 0) {
+      octree_write_cpu(paths_c[idx], grids[idx]);
+    }
+    else {
+      octree_write_columnar_cpu(paths_c[idx], grids[idx], OT_STORAGE_FLOAT32);
+    }
+  }
+
+  std::vector<ot_size_t> n_leafs(n, -1);
+  octree_read_n_leafs_batch_cpu(n, paths_c, n_threads, n_leafs.data());
+  for(int idx = 0; idx < n; ++idx) {
+    if(n_leafs[idx] != grids[idx]->n_leafs) {
+      printf("[ERROR] n_leafs of %d differ: %d, %d\n", idx, n_leafs[idx], grids[idx]->n_leafs);
+      exit(-1);
+    }
+  }
+
+  for(int idx = 0; idx < n; ++idx) {
+    remove(paths_c[idx]);
     octree_free_cpu(grids[idx]);
     delete[] paths_c[idx];
   }
@@ -186,6 +233,210 @@ void test_IO(int n_threads) {
   std::cout << "[DONE]" << std::endl;
 }
 
+void test_IO_typed(int storage_type, float max_rel_err, int n_threads) {
+  std::cout << "[INFO] test_IO_typed " << storage_type << std::endl;
+  int n = 4;
+  int gd = 4; int gh = 8; int gw = 8; int fs = 3;
+  octree** grids = new octree*[n];
+  char** paths_c = new char*[n];
+  for(int idx = 0; idx < n; ++idx) {
+    std::stringstream ss;
+    ss << "test_typed_" << idx << ".oc";
+    paths_c[idx] = new char[ss.str().size() + 1];
+    strcpy(paths_c[idx], ss.str().c_str());
+
+    grids[idx] = create_test_octree_rand(1,gd,gh,gw, fs, 0.5,0.5,0.5);
+    octree_write_typed_cpu(paths_c[idx], grids[idx], storage_type);
+  }
+
+  octree* batch = octree_new_cpu();
+  octree_read_batch_cpu(n, paths_c, n_threads, batch);
+  for(int idx = 0; idx < n; ++idx) {
+    octree* grid = octree_new_cpu();
+    octree_read_cpu(paths_c[idx], grid);
+    octree* grid_ext = octree_new_cpu();
+    octree_extract_n_cpu(batch, idx, idx+1, grid_ext);
+
+    if(!octree_equal_trees_cpu(grids[idx], grid) || !octree_equal_prefix_leafs_cpu(grids[idx], grid) || !octree_equal_cpu(grid, grid_ext)) {
+      printf("[ERROR] typed octree structure does not match\n");
+      exit(-1);
+    }
+    float max_abs = 0;
+    for(int didx = 0; didx < grid->n_leafs * fs; ++didx) {
+      max_abs = FMAX(max_abs, fabs(grids[idx]->data[didx]));
+    }
+    for(int didx = 0; didx < grid->n_leafs * fs; ++didx) {
+      if(fabs(grids[idx]->data[didx] - grid->data[didx]) > max_rel_err * max_abs) {
+        printf("[ERROR] typed octree data differs at %d: %f, %f\n", didx, grids[idx]->data[didx], grid->data[didx]);
+        exit(-1);
+      }
+    }
+    octree_free_cpu(grid);
+    octree_free_cpu(grid_ext);
+  }
+  octree_free_cpu(batch);
+
+  int dims[] = {2, 5, 6, 7, 3};
+  int size = 2*5*6*7*3;
+  ot_data_t* dense = new ot_data_t[size];
+  ot_data_t* dense_rd = new ot_data_t[size];
+  for(int idx = 0; idx < size; ++idx) {
+    dense[idx] = (idx % 3 + 1) * (rand() / float(RAND_MAX) - 0.5);
+  }
+  dense_write_typed_cpu("test_typed.dense", 5, dims, dense, storage_type);
+  dense_read_prealloc_cpu("test_typed.dense", 5, dims, dense_rd);
+  for(int idx = 0; idx < size; ++idx) {
+    if(fabs(dense[idx] - dense_rd[idx]) > max_rel_err * (idx % 3 + 1)) {
+      printf("[ERROR] typed dense data differs at %d: %f, %f\n", idx, dense[idx], dense_rd[idx]);
+      exit(-1);
+    }
+  }
+  delete[] dense;
+  delete[] dense_rd;
+  remove("test_typed.dense");
+  
+  for(int idx = 0; idx < n; ++idx) {
+    octree_free_cpu(grids[idx]);
+    remove(paths_c[idx]);
+    delete[] paths_c[idx];
+  }
+  delete[] paths_c;
+  delete[] grids;
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_IO_dense_batch(int n_threads) {
+  std::cout << "[INFO] test_IO_dense_batch" << std::endl;
+  const int n = 5;
+  int dims[] = {n, 8, 6, 4, 2};
+  int dims_single[] = {1, 8, 6, 4, 2};
+  int offset = 8*6*4*2;
+
+  ot_data_t* dense = new ot_data_t[n * offset];
+  ot_data_t* dense_rd = new ot_data_t[n * offset];
+  char** paths_c = new char*[n];
+  for(int idx = 0; idx < n * offset; ++idx) {
+    dense[idx] = rand() / float(RAND_MAX) - 0.5;
+  }
+  for(int idx = 0; idx < n; ++idx) {
+    paths_c[idx] = new char[32];
+    snprintf(paths_c[idx], 32, "test_batch_%d.dense", idx);
+    // mix plain and typed files in one batch
+    if(idx % 2 == 0) {
+      dense_write_cpu(paths_c[idx], 5, dims_single, dense + idx * offset);
+    }
+    else {
+      dense_write_typed_cpu(paths_c[idx], 5, dims_single, dense + idx * offset, OT_STORAGE_UINT8);
+    }
+  }
+
+  dense_read_prealloc_batch_cpu(n, paths_c, n_threads, 5, dims, dense_rd);
+  for(int idx = 0; idx < n * offset; ++idx) {
+    float max_err = (idx / offset) % 2 == 0 ? 0 : 1.1f / 255;
+    if(fabs(dense[idx] - dense_rd[idx]) > max_err) {
+      printf("[ERROR] batch dense data differs at %d: %f, %f\n", idx, dense[idx], dense_rd[idx]);
+      exit(-1);
+    }
+  }
+
+  ot_data_t* dense_single = dense_read_cpu(paths_c[0]);
+  for(int idx = 0; idx < offset; ++idx) {
+    if(dense_single[idx] != dense[idx]) {
+      printf("[ERROR] dense_read_cpu differs at %d: %f, %f\n", idx, dense[idx], dense_single[idx]);
+      exit(-1);
+    }
+  }
+  delete[] dense_single;
+
+  for(int idx = 0; idx < n; ++idx) {
+    remove(paths_c[idx]);
+    delete[] paths_c[idx];
+  }
+  delete[] paths_c;
+  delete[] dense;
+  delete[] dense_rd;
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_IO_columnar(int storage_type, int n_threads) {
+  std::cout << "[INFO] test_IO_columnar " << storage_type << std::endl;
+  int fs = 5;
+  octree* grid = create_test_octree_rand(2,4,8,8, fs, 0.5,0.5,0.5);
+  octree_write_columnar_cpu("test_columnar.oc", grid, storage_type);
+  octree_write_typed_cpu("test_interleaved.oc", grid, storage_type);
+
+  const char* paths[] = {"test_columnar.oc", "test_interleaved.oc"};
+  for(int path_idx = 0; path_idx < 2; ++path_idx) {
+    octree* full = octree_new_cpu();
+    octree_read_cpu(paths[path_idx], full);
+
+    octree* struc = octree_new_cpu();
+    octree_read_structure_cpu(paths[path_idx], struc);
+    if(struc->feature_size != 0 || struc->n_leafs != grid->n_leafs || !octree_equal_trees_cpu(grid, struc) || !octree_equal_prefix_leafs_cpu(grid, struc)) {
+      printf("[ERROR] structure of %s does not match\n", paths[path_idx]);
+      exit(-1);
+    }
+
+    int channels[] = {3, 0};
+    octree* sub = octree_new_cpu();
+    octree_read_channels_cpu(paths[path_idx], 2, channels, n_threads, sub);
+    if(sub->feature_size != 2 || !octree_equal_trees_cpu(grid, sub) || !octree_equal_prefix_leafs_cpu(grid, sub)) {
+      printf("[ERROR] channel subset of %s has invalid structure\n", paths[path_idx]);
+      exit(-1);
+    }
+    for(int leaf_idx = 0; leaf_idx < grid->n_leafs; ++leaf_idx) {
+      for(int cidx = 0; cidx < 2; ++cidx) {
+        if(sub->data[leaf_idx * 2 + cidx] != full->data[leaf_idx * fs + channels[cidx]]) {
+          printf("[ERROR] channel subset of %s differs at leaf %d\n", paths[path_idx], leaf_idx);
+          exit(-1);
+        }
+      }
+    }
+    if(storage_type == OT_STORAGE_FLOAT32 && !octree_equal_cpu(grid, full)) {
+      printf("[ERROR] full read of %s does not match\n", paths[path_idx]);
+      exit(-1);
+    }
+
+    octree_free_cpu(full);
+    octree_free_cpu(struc);
+    octree_free_cpu(sub);
+  }
+
+  // a plain read of a columnar file must not change the number of threads
+#if defined(_OPENMP)
+  int max_threads = omp_get_max_threads();
+  octree* tmp = octree_new_cpu();
+  octree_read_cpu(paths[0], tmp);
+  octree_free_cpu(tmp);
+  if(omp_get_max_threads() != max_threads) {
+    printf("[ERROR] octree_read_cpu changed the number of threads\n");
+    exit(-1);
+  }
+#endif
+
+  // columnar and interleaved files mixed in one batch
+  octree* batch = octree_new_cpu();
+  octree_read_batch_cpu(2, (char**) paths, n_threads, batch);
+  for(int path_idx = 0; path_idx < 2; ++path_idx) {
+    octree* full = octree_new_cpu();
+    octree_read_cpu(paths[path_idx], full);
+    octree* ext = octree_new_cpu();
+    octree_extract_n_cpu(batch, path_idx * grid->n, (path_idx + 1) * grid->n, ext);
+    if(!octree_equal_cpu(full, ext)) {
+      printf("[ERROR] batch read of %s does not match\n", paths[path_idx]);
+      exit(-1);
+    }
+    octree_free_cpu(full);
+    octree_free_cpu(ext);
+  }
+  octree_free_cpu(batch);
+  
+  remove(paths[0]);
+  remove(paths[1]);
+  octree_free_cpu(grid);
+  std::cout << "[DONE]" << std::endl;
+}
+
 void test_split_rec_surf() {
   
   octree* rec = create_test_octree_rand(1, 1,1,1, 1, 0,0,0);
@@ -200,6 +451,241 @@ void test_split_rec_surf() {
   octree_free_cpu(out);
 }
 
+void test_merge_homogeneous(int n_threads) {
+  std::cout << "[INFO] test_merge_homogeneous" << std::endl;
+  int gn = 2; int gd = 2; int gh = 3; int gw = 4; int fs = 2;
+  octree* grid = create_test_octree_rand(gn,gd,gh,gw, fs, 0.5,0.5,0.5);
+  // few distinct values, such that some siblings are identical
+  for(int idx = 0; idx < grid->n_leafs * fs; ++idx) {
+    grid->data[idx] = grid->data[idx] > 0.3 ? 1 : 0;
+  }
+
+  octree* merged = octree_new_cpu();
+  octree_merge_homogeneous_cpu(grid, 0, n_threads, merged);
+  if(merged->n_leafs > grid->n_leafs) {
+    printf("[ERROR] merge_homogeneous increased the number of leafs\n");
+    exit(-1);
+  }
+
+  int n_vx = gn * gd*8 * gh*8 * gw*8 * fs;
+  ot_data_t* dense = new ot_data_t[n_vx];
+  ot_data_t* dense_merged = new ot_data_t[n_vx];
+  octree_to_cdhw_cpu(grid, gd*8,gh*8,gw*8, dense);
+  octree_to_cdhw_cpu(merged, gd*8,gh*8,gw*8, dense_merged);
+  for(int idx = 0; idx < n_vx; ++idx) {
+    if(dense[idx] != dense_merged[idx]) {
+      printf("[ERROR] merge_homogeneous changed the dense representation at %d\n", idx);
+      exit(-1);
+    }
+  }
+
+  // constant features collapse every block to a single leaf, in place
+  for(int idx = 0; idx < grid->n_leafs * fs; ++idx) {
+    grid->data[idx] = 0.25 + 0.01 * (idx % fs);
+  }
+  octree_merge_homogeneous_cpu(grid, 0, n_threads, grid);
+  if(grid->n_leafs != octree_num_blocks(grid)) {
+    printf("[ERROR] constant octree was not merged to single leafs (%d leafs)\n", grid->n_leafs);
+    exit(-1);
+  }
+
+  delete[] dense;
+  delete[] dense_merged;
+  octree_free_cpu(merged);
+  octree_free_cpu(grid);
+  std::cout << "[DONE]" << std::endl;
+}
+
+void check_pool_argmax(const char* name, const octree* out, const octree* out_argmax, const octree* grad_in, const octree* grad_in_argmax) {
+  if(!octree_equal_cpu(out, out_argmax)) {
+    printf("[ERROR] %s argmax forward differs\n", name);
+    exit(-1);
+  }
+  if(!octree_equal_cpu(grad_in, grad_in_argmax)) {
+    printf("[ERROR] %s argmax backward differs\n", name);
+    exit(-1);
+  }
+}
+
+void test_pool_argmax() {
+  std::cout << "[INFO] test_pool_argmax" << std::endl;
+  int gn = 2; int gd = 2; int gh = 4; int gw = 2; int fs = 3;
+  octree* in = create_test_octree_rand(gn,gd,gh,gw, fs, 0.5,0.5,0.5);
+  std::vector<int> argmax(in->n_leafs * fs);
+
+  octree* out = octree_new_cpu();
+  octree* out_argmax = octree_new_cpu();
+  octree* grad_in = octree_new_cpu();
+  octree* grad_in_argmax = octree_new_cpu();
+
+  octree_gridpool2x2x2_max_cpu(in, out);
+  octree_gridpool2x2x2_max_argmax_cpu(in, out_argmax, &argmax[0]);
+  for(int idx = 0; idx < out->n_leafs * fs; ++idx) {
+    out->data[idx] = float(rand()) / RAND_MAX;
+  }
+  octree_gridpool2x2x2_max_bwd_cpu(in, out, grad_in);
+  octree_gridpool2x2x2_max_argmax_bwd_cpu(in, out, &argmax[0], grad_in_argmax);
+  octree_gridpool2x2x2_max_cpu(in, out);
+  check_pool_argmax("gridpool2x2x2", out, out_argmax, grad_in, grad_in_argmax);
+
+  for(int levels = 1; levels < 8; ++levels) {
+    bool level_0 = levels & 1;
+    bool level_1 = levels & 2;
+    bool level_2 = levels & 4;
+    octree_pool2x2x2_max_cpu(in, level_0, level_1, level_2, out);
+    octree_pool2x2x2_max_argmax_cpu(in, level_0, level_1, level_2, out_argmax, &argmax[0]);
+    octree* grad_out = octree_new_cpu();
+    octree_copy_cpu(out, grad_out);
+    for(int idx = 0; idx < grad_out->n_leafs * fs; ++idx) {
+      grad_out->data[idx] = float(rand()) / RAND_MAX;
+    }
+    octree_pool2x2x2_max_bwd_cpu(in, grad_out, grad_in);
+    octree_pool2x2x2_max_argmax_bwd_cpu(in, grad_out, &argmax[0], grad_in_argmax);
+    check_pool_argmax("pool2x2x2", out, out_argmax, grad_in, grad_in_argmax);
+    octree_free_cpu(grad_out);
+  }
+
+  octree_free_cpu(in);
+  octree_free_cpu(out);
+  octree_free_cpu(out_argmax);
+  octree_free_cpu(grad_in);
+  octree_free_cpu(grad_in_argmax);
+  std::cout << "[DONE]" << std::endl;
+}
+
+void check_gridunpool_bwd(const char* name, const octree* in, const octree* out_src, const octree* grad_out, const octree* grad_in) {
+  // out_src holds for every output leaf the index of the input leaf it was 
+  // copied from, hence, the gradient of an input leaf is the sum of the 
+  // gradients of those output leafs
+  const int fs = in->feature_size;
+  std::vector<double> ref(in->n_leafs * fs, 0);
+  std::vector<double> abs_sum(in->n_leafs * fs, 0);
+  for(int out_leaf_idx = 0; out_leaf_idx < out_src->n_leafs; ++out_leaf_idx) {
+    int in_leaf_idx = int(out_src->data[out_leaf_idx * fs]);
+    for(int f = 0; f < fs; ++f) {
+      ref[in_leaf_idx * fs + f] += grad_out->data[out_leaf_idx * fs + f];
+      abs_sum[in_leaf_idx * fs + f] += fabs(grad_out->data[out_leaf_idx * fs + f]);
+    }
+  }
+  for(int idx = 0; idx < in->n_leafs * fs; ++idx) {
+    if(fabs(ref[idx] - grad_in->data[idx]) > 1e-5 * abs_sum[idx] + 1e-6) {
+      std::cout << "[ERROR] " << name << " bwd at " << idx << ": " << ref[idx] << " vs. " << grad_in->data[idx] << std::endl;
+      exit(-1);
+    }
+  }
+}
+
+void test_gridunpool_bwd() {
+  std::cout << "[INFO] test_gridunpool_bwd" << std::endl;
+  int gn = 2; int gd = 2; int gh = 3; int gw = 2; int fs = 3;
+  octree* in = create_test_octree_rand(gn,gd,gh,gw, fs, 0.5,0.5,0.5);
+  octree* in_struct = create_test_octree_rand(gn,2*gd,2*gh,2*gw, fs, 0.5,0.5,0.5);
+  octree* out = octree_new_cpu();
+  octree* grad_out = octree_new_cpu();
+  octree* grad_in = octree_new_cpu();
+
+  // input with the leaf indices as data, unpooled to find the source leafs
+  octree* in_src = octree_new_cpu();
+  octree_copy_cpu(in, in_src);
+  for(int idx = 0; idx < in->n_leafs * fs; ++idx) {
+    in_src->data[idx] = idx / fs;
+  }
+  octree* out_src = octree_new_cpu();
+
+  octree_gridunpool2x2x2_cpu(in, out);
+  octree_copy_cpu(out, grad_out);
+  for(int idx = 0; idx < grad_out->n_leafs * fs; ++idx) {
+    grad_out->data[idx] = float(rand()) / RAND_MAX;
+  }
+  octree_gridunpool2x2x2_bwd_cpu(in, grad_out, grad_in);
+  octree_gridunpool2x2x2_cpu(in_src, out_src);
+  check_gridunpool_bwd("gridunpool2x2x2", in, out_src, grad_out, grad_in);
+
+  octree_gridunpoolguided2x2x2_cpu(in, in_struct, out);
+  octree_copy_cpu(out, grad_out);
+  for(int idx = 0; idx < grad_out->n_leafs * fs; ++idx) {
+    grad_out->data[idx] = float(rand()) / RAND_MAX;
+  }
+  octree_gridunpoolguided2x2x2_bwd_cpu(in, in_struct, grad_out, grad_in);
+  octree_gridunpoolguided2x2x2_cpu(in_src, in_struct, out_src);
+  check_gridunpool_bwd("gridunpoolguided2x2x2", in, out_src, grad_out, grad_in);
+
+  octree_free_cpu(in);
+  octree_free_cpu(in_struct);
+  octree_free_cpu(in_src);
+  octree_free_cpu(out_src);
+  octree_free_cpu(out);
+  octree_free_cpu(grad_out);
+  octree_free_cpu(grad_in);
+  std::cout << "[DONE]" << std::endl;
+}
+
+void losses(const octree* input, const octree* target, const octree* target_cls, const ot_data_t* cls_weights, const ot_data_t* target_dense, std::vector<ot_data_t>& out) {
+  out.clear();
+  out.push_back(octree_mse_loss_cpu(input, target, true, true));
+  out.push_back(octree_smooth_mae_loss_cpu(input, target, 0.1));
+  ot_data_t output, total_weight;
+  octree_nll_loss_cpu(input, target_cls, cls_weights, 0, true, true, &output, &total_weight);
+  out.push_back(output); out.push_back(total_weight);
+  octree_bce_loss_cpu(input, target, true, true, &output, &total_weight);
+  out.push_back(output); out.push_back(total_weight);
+  octree_bce_dense_loss_cpu(input, target_dense, true, &output, &total_weight);
+  out.push_back(output); out.push_back(total_weight);
+  octree_bce_ds_loss_cpu(input, target, target, true, &output, &total_weight);
+  out.push_back(output); out.push_back(total_weight);
+}
+
+void test_loss_deterministic() {
+  std::cout << "[INFO] test_loss_deterministic" << std::endl;
+  int gn = 2; int gd = 3; int gh = 4; int gw = 2; int fs = 3;
+  octree* input = create_test_octree_rand(gn,gd,gh,gw, fs, 0.5,0.5,0.5, 0.05,0.95);
+  octree* target = octree_new_cpu();
+  octree_copy_cpu(input, target);
+  for(int idx = 0; idx < target->n_leafs * fs; ++idx) {
+    target->data[idx] = float(rand()) / RAND_MAX;
+  }
+  octree* target_cls = octree_new_cpu();
+  octree_resize_cpu(gn,gd,gh,gw, 1, input->n_leafs, target_cls);
+  octree_cpy_trees_cpu_cpu(input, target_cls);
+  octree_cpy_prefix_leafs_cpu_cpu(input, target_cls);
+  for(int idx = 0; idx < target_cls->n_leafs; ++idx) {
+    target_cls->data[idx] = rand() % fs;
+  }
+  std::vector<ot_data_t> cls_weights(fs);
+  for(int c = 0; c < fs; ++c) {
+    cls_weights[c] = 0.5 + c;
+  }
+  std::vector<ot_data_t> target_dense(gn * fs * 8*gd * 8*gh * 8*gw);
+  octree_to_cdhw_cpu(target, 8*gd, 8*gh, 8*gw, &target_dense[0]);
+
+  std::vector<ot_data_t> ref;
+  std::vector<ot_data_t> out;
+#if defined(_OPENMP)
+  int max_threads = omp_get_max_threads();
+  omp_set_num_threads(1);
+#endif
+  losses(input, target, target_cls, &cls_weights[0], &target_dense[0], ref);
+  for(int n_threads = 2; n_threads <= 8; n_threads *= 2) {
+#if defined(_OPENMP)
+    omp_set_num_threads(n_threads);
+#endif
+    losses(input, target, target_cls, &cls_weights[0], &target_dense[0], out);
+    for(size_t idx = 0; idx < ref.size(); ++idx) {
+      if(ref[idx] != out[idx]) {
+        std::cout << "[ERROR] loss " << idx << " differs for " << n_threads << " threads: " << ref[idx] << " vs. " << out[idx] << std::endl;
+      }
+    }
+  }
+#if defined(_OPENMP)
+  omp_set_num_threads(max_threads);
+#endif
+
+  octree_free_cpu(input);
+  octree_free_cpu(target);
+  octree_free_cpu(target_cls);
+  std::cout << "[DONE]" << std::endl;
+}
+
 int main() {
   srand(time(NULL));
   
@@ -207,7 +693,19 @@ int main() {
   test_cdhw_to_octree();
   test_combine_extract_n();
   test_IO(1); test_IO(4);
+  test_IO_n_leafs(1); test_IO_n_leafs(4);
+  test_IO_typed(OT_STORAGE_FLOAT32, 0, 4);
+  test_IO_typed(OT_STORAGE_FLOAT16, 1e-3, 4);
+  test_IO_typed(OT_STORAGE_UINT8, 1.1f / 255, 4);
+  test_IO_typed(OT_STORAGE_INT8, 1.1f / 254, 1);
+  test_IO_dense_batch(4);
+  test_IO_columnar(OT_STORAGE_FLOAT32, 4);
+  test_IO_columnar(OT_STORAGE_UINT8, 2);
   test_split_rec_surf();
+  test_merge_homogeneous(1); test_merge_homogeneous(4);
+  test_pool_argmax();
+  test_gridunpool_bwd();
+  test_loss_deterministic();
 
   return 0;
 }
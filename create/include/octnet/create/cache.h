@@ -0,0 +1,108 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef OCTREE_CREATE_CACHE_CPU_H
+#define OCTREE_CREATE_CACHE_CPU_H
+
+#include "octnet/core/core.h"
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <utility>
+
+
+/// Two-level cache for created octrees.
+/// The first level is an in-memory LRU that is bounded by the number of bytes
+/// of the cached octrees (octree_mem_using), the second level is an optional
+/// directory of .oc files. Entries are keyed by the identity of the source
+/// file (path, mtime in ns, size) and a string that encodes the creation parameters,
+/// hence, a modified source file invalidates its entries. The lock of the
+/// cache is not held during disk reads and writes. If the directory can not
+/// be created or written, the cache falls back to the memory level.
+class OctreeCacheCpu {
+public:
+  /// Constructor.
+  /// @param max_bytes maximum number of bytes held in memory.
+  /// @param cache_dir directory for the on-disk cache, may be 0 or empty to
+  ///                  disable the second level.
+  OctreeCacheCpu(long max_bytes, const char* cache_dir);
+  virtual ~OctreeCacheCpu() {}
+
+  /// Looks up the octree created from path with params, first in memory,
+  /// then on disk. Entries found on disk are moved to memory.
+  /// @return the cached octree, or an empty pointer on a cache miss.
+  std::shared_ptr<octree> get(const char* path, const std::string& params);
+
+  /// Adds grid as octree created from path with params to the cache.
+  void put(const char* path, const std::string& params, std::shared_ptr<octree> grid);
+
+  long n_hits() const { return hits; }
+  long n_misses() const { return misses; }
+  long n_bytes() const { return bytes; }
+
+protected:
+  /// @return the key for path and params, or an empty string if path can not
+  ///         be stat'ed.
+  std::string key(const char* path, const std::string& params) const;
+  std::string disk_path(const std::string& key) const;
+  void put_memory(const std::string& key, std::shared_ptr<octree> grid);
+
+  typedef std::list<std::pair<std::string, std::shared_ptr<octree> > > lru_list;
+
+  long max_bytes;
+  std::string cache_dir;
+
+  lru_list lru;
+  std::map<std::string, lru_list::iterator> entries;
+  long bytes;
+  long hits;
+  long misses;
+  std::mutex mutex;
+};
+
+
+extern "C" {
+
+OctreeCacheCpu* octree_cache_new_cpu(long max_bytes, const char* cache_dir);
+void octree_cache_free_cpu(OctreeCacheCpu* cache);
+/// @return number of cache hits, misses and bytes held in memory.
+void octree_cache_stats_cpu(const OctreeCacheCpu* cache, long* n_hits, long* n_misses, long* n_bytes);
+
+/// Cached variant of octree_create_from_dense_features_batch_cpu. The sample
+/// n is identified by paths[n]. On a cache miss the sample is taken from data
+/// (as for the uncached function), or if data is 0, read from paths[n] with
+/// dense_read_prealloc_cpu as 1 x depth x height x width x feature_size tensor.
+octree* octree_create_from_dense_features_batch_cached_cpu(OctreeCacheCpu* cache, int n_paths, char** paths, const ot_data_t* data, int depth, int height, int width, int feature_size, ot_data_t tr_dist, bool fit, int fit_multiply, bool pack, int n_threads);
+
+/// Cached variant of octree_create_from_dense_batch_cpu, @see octree_create_from_dense_features_batch_cached_cpu.
+/// Samples read from paths[n] have the shape 1 x depth x height x width.
+octree* octree_create_from_dense_batch_cached_cpu(OctreeCacheCpu* cache, int n_paths, char** paths, const ot_data_t* data, int depth, int height, int width, int n_ranges, const ot_data_t* ranges, bool fit, int fit_multiply, bool pack, int n_threads);
+
+}
+
+#endif
@@ -77,6 +77,19 @@ public:
 
   virtual octree* operator()(bool fit=false, int fit_multiply=1, bool pack=false, int n_threads=1);
 
+  /// Sets up the source specific state, e.g., acceleration structures, before
+  /// the octree is created. Called by operator() and create_batch.
+  virtual void prepare(int n_threads) {}
+
+  /// Creates a single octree with batch_size samples from the sources 
+  /// creates, which have to use the default OctreeCreateHelperCpu (i.e., do
+  /// not override operator()). In a first phase the structures of all samples
+  /// are created in parallel directly in the trees of the output, then the 
+  /// data of all samples is filled in parallel directly into the output data
+  /// array, hence, no per sample octrees have to be allocated and combined.
+  /// If fit is true, all fitted grids have to have the same dimensions.
+  static octree* create_batch(int batch_size, OctreeCreateCpu** creates, bool fit, int fit_multiply, bool pack, int n_threads);
+
 protected:
   virtual octree* create_octree(bool fit, int fit_multiply, bool pack, int n_threads, OctreeCreateHelperCpu* helper);
 
@@ -86,6 +99,10 @@ protected:
   virtual void pack_octree(octree* grid, OctreeCreateHelperCpu* helper);
   virtual void update_and_resize_octree(octree* grid);
   virtual void fill_octree_data(octree* grid, bool packed, OctreeCreateHelperCpu* helper);
+  /// Second stage of pack=true: after pack_octree collapsed fully occupied 
+  /// subtrees and the data is filled, subtrees whose leafs have identical 
+  /// features are merged (octree_merge_homogeneous_cpu with eps = 0).
+  virtual void merge_homogeneous(octree* grid, int n_threads);
 
   virtual bool is_occupied(float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper) = 0;
   virtual void get_data(bool oc, float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper, ot_data_t* dst) = 0;
@@ -116,6 +133,21 @@ octree* octree_create_from_obj_cpu(const char* path, ot_size_t depth, ot_size_t
 
 octree* octree_create_from_pc_simple_cpu(float* xyz, int n_pts, int feature_size, ot_size_t depth, ot_size_t height, ot_size_t width, bool normalize, bool normalize_inplace, bool fit, int fit_multiply, bool pack, int pad, int n_threads);
 octree* octree_create_from_pc_cpu(float* xyz, const float* features, int n_pts, int feature_size, ot_size_t depth, ot_size_t height, ot_size_t width, bool normalize, bool normalize_inplace, bool fit, int fit_multiply, bool pack, int pad, int n_threads);
+/// Point cloud conversion like octree_create_from_pc_cpu, but the points are
+/// quantized to voxels and radix-sorted by their block and Morton code, such
+/// that the octree bits and the averaged features are derived from contiguous
+/// ranges of the sorted points. A point on a voxel boundary is assigned to 
+/// floor(x,y,z) only. features may be 0 to set the occupancy as data.
+octree* octree_create_from_pc_morton_cpu(float* xyz, const float* features, int n_pts, int feature_size, ot_size_t depth, ot_size_t height, ot_size_t width, bool normalize, bool normalize_inplace, bool fit, int fit_multiply, bool pack, int pad, int n_threads);
+
+/// Variants of the functions above that use the bottom-up creation engine 
+/// (OctreeCreateBottomUpCpu), i.e., the voxel occupancy of each block is 
+/// computed once and the split bits and the data are derived from it in the
+/// same sweep. The point cloud variant builds on octree_create_from_pc_morton_cpu.
+octree* octree_create_from_dense_bottom_up_cpu(const ot_data_t* data, int depth, int height, int width, int n_ranges, const ot_data_t* ranges, bool fit, int fit_multiply, bool pack, int n_threads);
+octree* octree_create_from_dense_features_bottom_up_cpu(const ot_data_t* data, int depth, int height, int width, int feature_size, ot_data_t tr_dist, bool fit, int fit_multiply, bool pack, int n_threads);
+octree* octree_create_from_mesh_bottom_up_cpu(int n_verts_, float* verts_, int n_faces_, int* faces, bool rescale_verts, ot_size_t depth, ot_size_t height, ot_size_t width, bool fit, int fit_multiply, bool pack, int pad, int n_threads);
+octree* octree_create_from_pc_bottom_up_cpu(float* xyz, const float* features, int n_pts, int feature_size, ot_size_t depth, ot_size_t height, ot_size_t width, bool normalize, bool normalize_inplace, bool fit, int fit_multiply, bool pack, int pad, int n_threads);
 
 
 }
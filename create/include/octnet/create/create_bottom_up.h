@@ -0,0 +1,232 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef OCTREE_CREATE_BOTTOM_UP_CPU_H
+#define OCTREE_CREATE_BOTTOM_UP_CPU_H
+
+#include "octnet/create/create.h"
+#include "octnet/cpu/cpu.h"
+
+#include <vector>
+#include <cstring>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+
+/// @return the 9 bit Morton code of the voxel ld,lh,lw within a shallow 
+///         octree; the 3 most significant bits are the child index at level 
+///         1, the 3 least significant bits the child index at level 3. Hence,
+///         every cell covers a contiguous range of codes.
+inline int morton_local(int ld, int lh, int lw) {
+  int key = 0;
+  for(int l = 2; l >= 0; --l) {
+    key = (key << 3) | (((ld >> l) & 1) << 2) | (((lh >> l) & 1) << 1) | ((lw >> l) & 1);
+  }
+  return key;
+}
+
+/// Inverse of morton_local.
+inline void morton_local_inv(int key, int& ld, int& lh, int& lw) {
+  ld = 0; lh = 0; lw = 0;
+  for(int l = 2; l >= 0; --l) {
+    int child = (key >> (3 * l)) & 7;
+    ld = (ld << 1) | (child >> 2);
+    lh = (lh << 1) | ((child >> 1) & 1);
+    lw = (lw << 1) | (child & 1);
+  }
+}
+
+/// @return 8 bit mask, where bit i is set if byte i of x is non-zero.
+inline int nonzero_bytes(unsigned long long x) {
+  x |= x >> 4;
+  x |= x >> 2;
+  x |= x >> 1;
+  x &= 0x0101010101010101ULL;
+  return (x * 0x0102040810204080ULL) >> 56;
+}
+
+
+/// Bottom-up (leaf first) creation engine for any OctreeCreateCpu source 
+/// Base. Instead of querying Base::is_occupied top-down on every level, and
+/// again when packing and filling the data, each block is swept once: the 
+/// occupancy of its 512 voxels is collected in a bit mask in Morton order
+/// (morton_local), the split bits of level 2, 1 and 0 are the OR-reductions
+/// of the 2x2x2 groups (bytes, 64 bit words, and the full mask), and the leaf
+/// data is computed in the same sweep. Blocks that are empty at level 0 are 
+/// skipped after a single query. Base::is_occupied and Base::get_data are
+/// called without virtual dispatch. The resulting octree equals the top-down 
+/// one, if the occupancy of a cell is the union of its voxels' occupancy.
+template <typename Base>
+class OctreeCreateBottomUpCpu : public Base {
+public:
+  using Base::Base;
+  virtual ~OctreeCreateBottomUpCpu() {}
+
+protected:
+  virtual octree* create_octree(bool fit, int fit_multiply, bool pack, int n_threads, OctreeCreateHelperCpu* helper) {
+    octree* grid = this->alloc_grid();
+    int n_blocks = octree_num_blocks(grid);
+    std::vector<std::vector<ot_data_t> > block_data(n_blocks);
+    std::vector<char> packed_root(n_blocks, 0);
+
+#if defined(_OPENMP)
+    omp_set_num_threads(n_threads);
+#endif
+    #pragma omp parallel for
+    for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
+      // fit has to see packed full blocks as occupied, the root bit is unset
+      // again after fitting
+      ot_tree_t* tree = octree_get_tree(grid, grid_idx);
+      packed_root[grid_idx] = sweep_block(grid_idx, pack, helper, tree, block_data[grid_idx]);
+      if(packed_root[grid_idx]) {
+        tree_set_bit(tree, 0);
+      }
+    }
+
+    if(fit) {
+      this->fit_octree(grid, fit_multiply, helper);
+    }
+
+    n_blocks = octree_num_blocks(grid);
+    std::vector<int> src_idx(n_blocks);
+    for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
+      int gd = grid_idx / (grid->grid_height * grid->grid_width);
+      int gh = (grid_idx / grid->grid_width) % grid->grid_height;
+      int gw = grid_idx % grid->grid_width;
+      helper->update_grid_coords(gd,gh,gw);
+      src_idx[grid_idx] = helper->get_grid_idx(gd,gh,gw);
+      if(packed_root[src_idx[grid_idx]]) {
+        tree_unset_bit(octree_get_tree(grid, grid_idx), 0);
+      }
+    }
+    this->update_and_resize_octree(grid);
+
+    #pragma omp parallel for
+    for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
+      const std::vector<ot_data_t>& src = block_data[src_idx[grid_idx]];
+      memcpy(octree_get_data(grid, grid_idx), src.data(), src.size() * sizeof(ot_data_t));
+    }
+
+    if(pack) {
+      this->merge_homogeneous(grid, n_threads);
+    }
+
+    return grid;
+  }
+
+  /// Sets the tree bits of block grid_idx and computes the data of its leafs
+  /// in data index order.
+  /// @return true, if the block is fully occupied and packed to a single leaf.
+  bool sweep_block(int grid_idx, bool pack, OctreeCreateHelperCpu* helper, ot_tree_t* tree, std::vector<ot_data_t>& data) {
+    const int fs = this->feature_size;
+    int gd = grid_idx / (this->grid_height * this->grid_width);
+    int gh = (grid_idx / this->grid_width) % this->grid_height;
+    int gw = grid_idx % this->grid_width;
+    float cx = gw * 8 + 4;
+    float cy = gh * 8 + 4;
+    float cz = gd * 8 + 4;
+
+    unsigned long long mask[8] = {0,0,0,0,0,0,0,0};
+    if(Base::is_occupied(cx,cy,cz, 8,8,8, gd,gh,gw, helper)) {
+      for(int key = 0; key < 512; ++key) {
+        int ld, lh, lw;
+        morton_local_inv(key, ld, lh, lw);
+        if(Base::is_occupied(cx - 3.5f + lw, cy - 3.5f + lh, cz - 3.5f + ld, 1,1,1, gd,gh,gw, helper)) {
+          mask[key / 64] |= 1ULL << (key % 64);
+        }
+      }
+    }
+
+    // split bits are the OR-reductions of the voxel occupancy, a full 
+    // subtree is not split if packed
+    bool any = false;
+    bool full = true;
+    for(int c1 = 0; c1 < 8; ++c1) {
+      any = any || mask[c1] != 0;
+      full = full && mask[c1] == ~0ULL;
+    }
+    if(!any || (pack && full)) {
+      data.resize(fs);
+      Base::get_data(any, cx,cy,cz, 8,8,8, gd,gh,gw, helper, data.data());
+      return any;
+    }
+
+    tree_set_bit(tree, 0);
+    for(int c1 = 0; c1 < 8; ++c1) {
+      if(mask[c1] == 0 || (pack && mask[c1] == ~0ULL)) {
+        continue;
+      }
+      tree_set_bit(tree, 1 + c1);
+      int split_l2 = nonzero_bytes(mask[c1]);
+      if(pack) {
+        // bytes that are not full
+        split_l2 &= nonzero_bytes(~mask[c1]);
+      }
+      for(int c2 = 0; c2 < 8; ++c2) {
+        if(split_l2 & (1 << c2)) {
+          tree_set_bit(tree, 9 + 8 * c1 + c2);
+        }
+      }
+    }
+
+    data.resize(tree_n_leafs(tree) * fs);
+    for(int c1 = 0; c1 < 8; ++c1) {
+      int bit_idx_l1 = 1 + c1;
+      float cx_l1 = cx + 4 * (c1 & 1) - 2;
+      float cy_l1 = cy + 4 * ((c1 >> 1) & 1) - 2;
+      float cz_l1 = cz + 4 * (c1 >> 2) - 2;
+      if(!tree_isset_bit(tree, bit_idx_l1)) {
+        ot_data_t* dst = data.data() + tree_data_idx(tree, bit_idx_l1, fs);
+        Base::get_data(mask[c1] != 0, cx_l1,cy_l1,cz_l1, 4,4,4, gd,gh,gw, helper, dst);
+        continue;
+      }
+      for(int c2 = 0; c2 < 8; ++c2) {
+        int bit_idx_l2 = tree_child_bit_idx(bit_idx_l1) + c2;
+        float cx_l2 = cx_l1 + 2 * (c2 & 1) - 1;
+        float cy_l2 = cy_l1 + 2 * ((c2 >> 1) & 1) - 1;
+        float cz_l2 = cz_l1 + 2 * (c2 >> 2) - 1;
+        int byte = (mask[c1] >> (8 * c2)) & 0xFF;
+        if(!tree_isset_bit(tree, bit_idx_l2)) {
+          ot_data_t* dst = data.data() + tree_data_idx(tree, bit_idx_l2, fs);
+          Base::get_data(byte != 0, cx_l2,cy_l2,cz_l2, 2,2,2, gd,gh,gw, helper, dst);
+          continue;
+        }
+        for(int c3 = 0; c3 < 8; ++c3) {
+          int bit_idx_l3 = tree_child_bit_idx(bit_idx_l2) + c3;
+          float cx_l3 = cx_l2 + (c3 & 1) - 0.5f;
+          float cy_l3 = cy_l2 + ((c3 >> 1) & 1) - 0.5f;
+          float cz_l3 = cz_l2 + (c3 >> 2) - 0.5f;
+          ot_data_t* dst = data.data() + tree_data_idx(tree, bit_idx_l3, fs);
+          Base::get_data((byte >> c3) & 1, cx_l3,cy_l3,cz_l3, 1,1,1, gd,gh,gw, helper, dst);
+        }
+      }
+    }
+    return false;
+  }
+};
+
+#endif
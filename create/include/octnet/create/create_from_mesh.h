@@ -29,11 +29,14 @@
 #include "octnet/create/create.h"
 #include "octnet/cpu/cpu.h"
 #include "octnet/geometry/geometry.h"
+#include "octnet/geometry/geometry_sse.h"
 
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 
 #if defined(_OPENMP)
@@ -46,12 +49,17 @@ class OctreeCreateFromMeshHelperCpu : public OctreeCreateHelperCpu {
 public:
   OctreeCreateFromMeshHelperCpu(ot_size_t grid_depth_, ot_size_t grid_height_, ot_size_t grid_width_) :
     OctreeCreateHelperCpu(grid_depth_, grid_height_, grid_width_), 
-    tinds(grid_depth_ * grid_height_ * grid_width_)
+    tinds(grid_depth_ * grid_height_ * grid_width_),
+    tpackets(grid_depth_ * grid_height_ * grid_width_)
   {}
   virtual ~OctreeCreateFromMeshHelperCpu() {}
 
 public:
   std::vector<std::vector<int> > tinds;
+  /// the triangles tinds of each block as packets of 4 for 
+  /// intersection_triangles_voxel_sse, the last packet is padded by repeating
+  /// the last triangle.
+  std::vector<std::vector<float> > tpackets;
 };
 
 
@@ -80,9 +88,50 @@ public:
 #endif
     OctreeCreateFromMeshHelperCpu helper(grid_depth, grid_height, grid_width);
 
+    // bin the triangles by their AABB into the blocks (CSR), only these 
+    // candidates are tested for intersection with a block
+    std::vector<int> face_bb(n_faces * 6);
+    std::vector<int> block_offsets(n_blocks + 1, 0);
+
 #if defined(_OPENMP)
     omp_set_num_threads(n_threads);
 #endif
+    #pragma omp parallel for
+    for(int fidx = 0; fidx < n_faces; ++fidx) {
+      int* bb = face_bb.data() + fidx * 6;
+      face_block_bb(fidx, bb);
+      for(int gd = bb[0]; gd <= bb[1]; ++gd) {
+        for(int gh = bb[2]; gh <= bb[3]; ++gh) {
+          for(int gw = bb[4]; gw <= bb[5]; ++gw) {
+            int grid_idx = (gd * grid_height + gh) * grid_width + gw;
+            #pragma omp atomic
+            block_offsets[grid_idx + 1]++;
+          }
+        }
+      }
+    }
+    for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
+      block_offsets[grid_idx + 1] += block_offsets[grid_idx];
+    }
+
+    std::vector<int> block_fill(block_offsets.begin(), block_offsets.end() - 1);
+    std::vector<int> block_faces(block_offsets[n_blocks]);
+    #pragma omp parallel for
+    for(int fidx = 0; fidx < n_faces; ++fidx) {
+      const int* bb = face_bb.data() + fidx * 6;
+      for(int gd = bb[0]; gd <= bb[1]; ++gd) {
+        for(int gh = bb[2]; gh <= bb[3]; ++gh) {
+          for(int gw = bb[4]; gw <= bb[5]; ++gw) {
+            int grid_idx = (gd * grid_height + gh) * grid_width + gw;
+            int pos;
+            #pragma omp atomic capture
+            pos = block_fill[grid_idx]++;
+            block_faces[pos] = fidx;
+          }
+        }
+      }
+    }
+
     #pragma omp parallel for
     for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
       int gd = grid_idx / (grid_height * grid_width);
@@ -92,7 +141,11 @@ public:
       float cx = gw * 8 + 4;
       float cy = gh * 8 + 4;
       float cz = gd * 8 + 4;
-      block_triangles(cx,cy,cz, 8,8,8, helper.tinds[grid_idx]);
+      int n_cand = block_offsets[grid_idx + 1] - block_offsets[grid_idx];
+      block_triangles(cx,cy,cz, 8,8,8, block_faces.data() + block_offsets[grid_idx], n_cand, helper.tinds[grid_idx]);
+      const std::vector<int>& tinds = helper.tinds[grid_idx];
+      helper.tpackets[grid_idx].resize((tinds.size() + 3) / 4 * TRIANGLE_PACKET_SIZE);
+      triangle_packets(tinds.data(), tinds.size(), helper.tpackets[grid_idx].data());
     }
     
     return create_octree(fit, fit_multiply, pack, n_threads, &helper);
@@ -100,76 +153,84 @@ public:
 
 
 protected:
-  virtual void block_triangles(float cx, float cy, float cz, float vd, float vh, float vw, std::vector<int>& tinds) {
-    for(int fidx = 0; fidx < n_faces; ++fidx) {
-      float3 vx_c;
-      vx_c.x = cx;
-      vx_c.y = cy;
-      vx_c.z = cz;
-      float3 vx_w;
-      vx_w.x = vw;
-      vx_w.y = vh;
-      vx_w.z = vd;
-
-      float3 v0;
-      v0.x = verts[faces[fidx * 3 + 0] * 3 + 0];
-      v0.y = verts[faces[fidx * 3 + 0] * 3 + 1];
-      v0.z = verts[faces[fidx * 3 + 0] * 3 + 2];
-      float3 v1;
-      v1.x = verts[faces[fidx * 3 + 1] * 3 + 0];
-      v1.y = verts[faces[fidx * 3 + 1] * 3 + 1];
-      v1.z = verts[faces[fidx * 3 + 1] * 3 + 2];
-      float3 v2;
-      v2.x = verts[faces[fidx * 3 + 2] * 3 + 0];
-      v2.y = verts[faces[fidx * 3 + 2] * 3 + 1];
-      v2.z = verts[faces[fidx * 3 + 2] * 3 + 2];
-
-      bool tria_inter = intersection_triangle_voxel(vx_c, vx_w, v0, v1, v2);
-      if(tria_inter) {
-        tinds.push_back(fidx);
+  /// Computes the inclusive range of blocks that is overlapped by the AABB
+  /// of face fidx as [gd_min, gd_max, gh_min, gh_max, gw_min, gw_max]. The 
+  /// AABB is slightly enlarged, such that triangles touching a block face are
+  /// candidates of both blocks. The range is empty if the face is outside.
+  void face_block_bb(int fidx, int* bb) const {
+    float min_v[3] = {1e9, 1e9, 1e9};
+    float max_v[3] = {-1e9, -1e9, -1e9};
+    for(int vidx = 0; vidx < 3; ++vidx) {
+      for(int dim = 0; dim < 3; ++dim) {
+        float v = verts[faces[fidx * 3 + vidx] * 3 + dim];
+        min_v[dim] = FMIN(min_v[dim], v);
+        max_v[dim] = FMAX(max_v[dim], v);
+      }
+    }
+    // verts are x,y,z, blocks are d,h,w
+    const int sizes[3] = {grid_width, grid_height, grid_depth};
+    for(int dim = 0; dim < 3; ++dim) {
+      int lo = floor(min_v[dim] / 8.f - 1e-4f);
+      int hi = floor(max_v[dim] / 8.f + 1e-4f);
+      lo = IMAX(lo, 0);
+      hi = IMIN(hi, sizes[dim] - 1);
+      bb[(2 - dim) * 2 + 0] = lo;
+      bb[(2 - dim) * 2 + 1] = hi;
+    }
+  }
+
+  /// Stores the faces fidxs as (n + 3) / 4 packets of 4 triangles in packets.
+  void triangle_packets(const int* fidxs, int n, float* packets) const {
+    const int n_packets = (n + 3) / 4;
+    for(int idx = 0; idx < n_packets * 4; ++idx) {
+      int fidx = fidxs[IMIN(idx, n - 1)];
+      triangle_packet_set(packets + (idx / 4) * TRIANGLE_PACKET_SIZE, idx % 4, 
+          verts + faces[fidx * 3 + 0] * 3, verts + faces[fidx * 3 + 1] * 3, verts + faces[fidx * 3 + 2] * 3);
+    }
+  }
+
+  virtual void block_triangles(float cx, float cy, float cz, float vd, float vh, float vw, const int* cand_faces, int n_cand, std::vector<int>& tinds) {
+    float3 vx_c;
+    vx_c.x = cx;
+    vx_c.y = cy;
+    vx_c.z = cz;
+    float3 vx_w;
+    vx_w.x = vw;
+    vx_w.y = vh;
+    vx_w.z = vd;
+
+    float packet[TRIANGLE_PACKET_SIZE];
+    for(int cidx = 0; cidx < n_cand; cidx += 4) {
+      int n_lanes = IMIN(4, n_cand - cidx);
+      triangle_packets(cand_faces + cidx, n_lanes, packet);
+      int mask = intersection_triangles_voxel_sse(vx_c, vx_w, packet);
+      for(int lane = 0; lane < n_lanes; ++lane) {
+        if(mask & (1 << lane)) {
+          tinds.push_back(cand_faces[cidx + lane]);
+        }
       }
     }
+    // the candidates are binned in parallel, keep the face order deterministic
+    std::sort(tinds.begin(), tinds.end());
   }
 
 
   virtual bool is_occupied(float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper_) {
-    OctreeCreateFromMeshHelperCpu* helper = dynamic_cast<OctreeCreateFromMeshHelperCpu*>(helper_);
+    OctreeCreateFromMeshHelperCpu* helper = static_cast<OctreeCreateFromMeshHelperCpu*>(helper_);
     int grid_idx = helper->get_grid_idx(gd, gh, gw);
-    std::vector<int>& tinds = helper->tinds[grid_idx];
-
-    for(size_t idx = 0; idx < tinds.size(); ++idx) {
-      int fidx = tinds[idx];
-      float3 vx_c;
-      vx_c.x = cx;
-      vx_c.y = cy;
-      vx_c.z = cz;
-      float3 vx_w;
-      vx_w.x = vw;
-      vx_w.y = vh;
-      vx_w.z = vd;
-
-      float3 v0;
-      v0.x = verts[faces[fidx * 3 + 0] * 3 + 0];
-      v0.y = verts[faces[fidx * 3 + 0] * 3 + 1];
-      v0.z = verts[faces[fidx * 3 + 0] * 3 + 2];
-      float3 v1;
-      v1.x = verts[faces[fidx * 3 + 1] * 3 + 0];
-      v1.y = verts[faces[fidx * 3 + 1] * 3 + 1];
-      v1.z = verts[faces[fidx * 3 + 1] * 3 + 2];
-      float3 v2;
-      v2.x = verts[faces[fidx * 3 + 2] * 3 + 0];
-      v2.y = verts[faces[fidx * 3 + 2] * 3 + 1];
-      v2.z = verts[faces[fidx * 3 + 2] * 3 + 2]; 
-
-      // printf("[%f,%f,%f] inter [%f,%f,%f], [%f,%f,%f], [%f,%f,%f]\n",
-      //     vx_c.x, vx_c.y, vx_c.z,
-      //     v0.x, v0.y, v0.z,
-      //     v1.x, v1.y, v1.z,
-      //     v2.x, v2.y, v2.z);
-
-      bool tria_inter = intersection_triangle_voxel(vx_c, vx_w, v0, v1, v2);
-      if(tria_inter) {
-        // printf("  triang intersection at (%f,%f,%f)\n", vx_c.x,vx_c.y,vx_c.z);
+    const std::vector<float>& tpackets = helper->tpackets[grid_idx];
+
+    float3 vx_c;
+    vx_c.x = cx;
+    vx_c.y = cy;
+    vx_c.z = cz;
+    float3 vx_w;
+    vx_w.x = vw;
+    vx_w.y = vh;
+    vx_w.z = vd;
+
+    for(size_t idx = 0; idx < tpackets.size(); idx += TRIANGLE_PACKET_SIZE) {
+      if(intersection_triangles_voxel_sse(vx_c, vx_w, tpackets.data() + idx)) {
         return true;
       }
     }
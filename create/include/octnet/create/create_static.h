@@ -0,0 +1,338 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef OCTREE_CREATE_STATIC_CPU_H
+#define OCTREE_CREATE_STATIC_CPU_H
+
+#include "octnet/create/create.h"
+#include "octnet/cpu/cpu.h"
+
+
+/// Top-down structure pass of OctreeCreateCpu: sets the split bits of every 
+/// block, where the occupancy is given by the callable is_occupied with the 
+/// signature of OctreeCreateCpu::is_occupied. The pass is a template, such 
+/// that the occupancy test can be inlined into the loops.
+template <typename IsOccupied>
+void octree_create_structure_cpu(octree* grid, OctreeCreateHelperCpu* helper, IsOccupied is_occupied) {
+  int n_blocks = octree_num_blocks(grid);
+  int grid_height = grid->grid_height;
+  int grid_width = grid->grid_width;
+
+  #pragma omp parallel for
+  for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
+    ot_tree_t* tree = octree_get_tree(grid, grid_idx);
+
+    int gd = grid_idx / (grid_height * grid_width);
+    int gh = (grid_idx / grid_width) % grid_height;
+    int gw = grid_idx % grid_width;
+    
+    float cx = gw * 8 + 4;
+    float cy = gh * 8 + 4;
+    float cz = gd * 8 + 4;
+    if(is_occupied(cx,cy,cz, 8,8,8, gd,gh,gw, helper)) {
+      tree_set_bit(tree, 0);
+
+      int bit_idx_l1 = 1;
+      for(int dl1 = 0; dl1 < 2; ++dl1) {
+        for(int hl1 = 0; hl1 < 2; ++hl1) {
+          for(int wl1 = 0; wl1 < 2; ++wl1) {
+            float cx_l1 = cx + (wl1 * 4) - 2;
+            float cy_l1 = cy + (hl1 * 4) - 2;
+            float cz_l1 = cz + (dl1 * 4) - 2;
+
+            if(is_occupied(cx_l1,cy_l1,cz_l1, 4,4,4, gd,gh,gw, helper)) {
+              tree_set_bit(tree, bit_idx_l1);
+
+              int bit_idx_l2 = tree_child_bit_idx(bit_idx_l1);
+              for(int dl2 = 0; dl2 < 2; ++dl2) {
+                for(int hl2 = 0; hl2 < 2; ++hl2) {
+                  for(int wl2 = 0; wl2 < 2; ++wl2) {
+                    float cx_l2 = cx_l1 + (wl2 * 2) - 1;
+                    float cy_l2 = cy_l1 + (hl2 * 2) - 1;
+                    float cz_l2 = cz_l1 + (dl2 * 2) - 1;
+
+                    if(is_occupied(cx_l2,cy_l2,cz_l2, 2,2,2, gd,gh,gw, helper)) {
+                      tree_set_bit(tree, bit_idx_l2);
+                    }
+                    bit_idx_l2++;
+                  }
+                }
+              }
+            }
+
+            bit_idx_l1++;
+          }
+        }
+      }
+
+    }
+  }
+}
+
+
+/// Pack pass of OctreeCreateCpu, @see octree_create_structure_cpu.
+template <typename IsOccupied>
+void octree_pack_cpu(octree* grid, OctreeCreateHelperCpu* helper, IsOccupied is_occupied) {
+  int n_blocks = octree_num_blocks(grid);
+  
+  #pragma omp parallel for
+  for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
+    ot_tree_t* tree = octree_get_tree(grid, grid_idx);
+
+    int gd = grid_idx / (grid->grid_height * grid->grid_width);
+    int gh = (grid_idx / grid->grid_width) % grid->grid_height;
+    int gw = grid_idx % grid->grid_width;
+
+    helper->update_grid_coords(gd,gh,gw);
+    
+    float cx = gw * 8 + 4;
+    float cy = gh * 8 + 4;
+    float cz = gd * 8 + 4;
+
+    //check l3
+    int bit_idx_l2 = 9;
+    for(int dl1 = 0; dl1 < 2; ++dl1) {
+      for(int hl1 = 0; hl1 < 2; ++hl1) {
+        for(int wl1 = 0; wl1 < 2; ++wl1) {
+
+          for(int dl2 = 0; dl2 < 2; ++dl2) {
+            for(int hl2 = 0; hl2 < 2; ++hl2) {
+              for(int wl2 = 0; wl2 < 2; ++wl2) {
+                
+                if(tree_isset_bit(tree, bit_idx_l2)) {
+                  //check if all leafs are occupied
+                  bool all_oc = true;
+                  for(int dl3 = 0; dl3 < 2 && all_oc; ++dl3) {
+                    for(int hl3 = 0; hl3 < 2 && all_oc; ++hl3) {
+                      for(int wl3 = 0; wl3 < 2 && all_oc; ++wl3) {
+                        float cx_l3 = cx + (4*wl1 - 2) + (2*wl2 - 1) + (wl3 * 1) - 0.5;
+                        float cy_l3 = cy + (4*hl1 - 2) + (2*hl2 - 1) + (hl3 * 1) - 0.5;
+                        float cz_l3 = cz + (4*dl1 - 2) + (2*dl2 - 1) + (dl3 * 1) - 0.5;
+                        all_oc = all_oc && is_occupied(cx_l3, cy_l3, cz_l3, 1,1,1, gd,gh,gw, helper);
+                      }
+                    }
+                  }
+                  if(all_oc) {
+                    tree_unset_bit(tree, bit_idx_l2);
+                  }
+                }
+                bit_idx_l2++;
+
+              }
+            }
+          }
+
+        }
+      }
+    }
+
+    //check l2
+    int bit_idx_l1 = 1;
+    for(int dl1 = 0; dl1 < 2; ++dl1) {
+      for(int hl1 = 0; hl1 < 2; ++hl1) {
+        for(int wl1 = 0; wl1 < 2; ++wl1) {
+
+          if(tree_isset_bit(tree, bit_idx_l1)) {
+            bool all_oc = true;
+            int bit_idx_l2 = tree_child_bit_idx(bit_idx_l1);
+            for(int dl2 = 0; dl2 < 2 && all_oc; ++dl2) {
+              for(int hl2 = 0; hl2 < 2 && all_oc; ++hl2) {
+                for(int wl2 = 0; wl2 < 2 && all_oc; ++wl2) {
+                  float cx_l2 = cx + (4*wl1 - 2) + (2*wl2 - 1);
+                  float cy_l2 = cy + (4*hl1 - 2) + (2*hl2 - 1);
+                  float cz_l2 = cz + (4*dl1 - 2) + (2*dl2 - 1);
+                  
+                  all_oc = all_oc && !tree_isset_bit(tree, bit_idx_l2) && is_occupied(cx_l2, cy_l2, cz_l2, 2,2,2, gd,gh,gw, helper);
+                  bit_idx_l2++;
+                }
+              }
+            }
+      
+            if(all_oc) {
+              tree_unset_bit(tree, bit_idx_l1);
+            }
+          }
+          bit_idx_l1++;
+
+        }
+      }
+    }
+
+    //check l1
+    if(tree_isset_bit(tree, 0)) {
+      bool all_oc = true;
+      int bit_idx_l1 = 1;
+      for(int dl1 = 0; dl1 < 2 && all_oc; ++dl1) {
+        for(int hl1 = 0; hl1 < 2 && all_oc; ++hl1) {
+          for(int wl1 = 0; wl1 < 2 && all_oc; ++wl1) {
+            float cx_l2 = cx + (4*wl1 - 2);
+            float cy_l2 = cy + (4*hl1 - 2);
+            float cz_l2 = cz + (4*dl1 - 2);
+            
+            all_oc = all_oc && !tree_isset_bit(tree, bit_idx_l1) && is_occupied(cx_l2, cy_l2, cz_l2, 2,2,2, gd,gh,gw, helper);
+            bit_idx_l1++;
+          }
+        }
+      }
+
+      if(all_oc) {
+        tree_unset_bit(tree, 0);
+      } 
+    }
+
+  } // for grid_idx
+}
+
+
+/// Data pass of OctreeCreateCpu, get_data is a callable with the signature 
+/// of OctreeCreateCpu::get_data, @see octree_create_structure_cpu.
+template <typename IsOccupied, typename GetData>
+void octree_fill_data_cpu(octree* grid, bool packed, OctreeCreateHelperCpu* helper, IsOccupied is_occupied, GetData get_data) {
+  int n_blocks = octree_num_blocks(grid);
+  int feature_size = grid->feature_size;
+
+  #pragma omp parallel for
+  for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
+    ot_tree_t* tree = octree_get_tree(grid, grid_idx);
+    ot_data_t* data = octree_get_data(grid, grid_idx);
+
+    int gd = grid_idx / (grid->grid_height * grid->grid_width);
+    int gh = (grid_idx / grid->grid_width) % grid->grid_height;
+    int gw = grid_idx % grid->grid_width;
+    
+    helper->update_grid_coords(gd,gh,gw);
+    
+    float cx = gw * 8 + 4;
+    float cy = gh * 8 + 4;
+    float cz = gd * 8 + 4;
+    if(tree_isset_bit(tree, 0)) {
+
+      int bit_idx_l1 = 1;
+      for(int dl1 = 0; dl1 < 2; ++dl1) {
+        for(int hl1 = 0; hl1 < 2; ++hl1) {
+          for(int wl1 = 0; wl1 < 2; ++wl1) {
+            float cx_l1 = cx + (wl1 * 4) - 2;
+            float cy_l1 = cy + (hl1 * 4) - 2;
+            float cz_l1 = cz + (dl1 * 4) - 2;
+
+            if(tree_isset_bit(tree, bit_idx_l1)) {
+
+              int bit_idx_l2 = tree_child_bit_idx(bit_idx_l1);
+              for(int dl2 = 0; dl2 < 2; ++dl2) {
+                for(int hl2 = 0; hl2 < 2; ++hl2) {
+                  for(int wl2 = 0; wl2 < 2; ++wl2) {
+                    float cx_l2 = cx_l1 + (wl2 * 2) - 1;
+                    float cy_l2 = cy_l1 + (hl2 * 2) - 1;
+                    float cz_l2 = cz_l1 + (dl2 * 2) - 1;
+
+                    if(tree_isset_bit(tree, bit_idx_l2)) {
+  
+                      int bit_idx_l3 = tree_child_bit_idx(bit_idx_l2);
+                      for(int dl3 = 0; dl3 < 2; ++dl3) {
+                        for(int hl3 = 0; hl3 < 2; ++hl3) {
+                          for(int wl3 = 0; wl3 < 2; ++wl3) {
+                            float cx_l3 = cx_l2 + (wl3 * 1) - 0.5;
+                            float cy_l3 = cy_l2 + (hl3 * 1) - 0.5;
+                            float cz_l3 = cz_l2 + (dl3 * 1) - 0.5;
+
+                            int data_idx = tree_data_idx(tree, bit_idx_l3, feature_size);
+                            bool oc = is_occupied(cx_l3,cy_l3,cz_l3, 1,1,1, gd,gh,gw, helper);
+                            get_data(oc, cx_l3,cy_l3,cz_l3, 1,1,1, gd,gh,gw, helper, data + data_idx);
+                            bit_idx_l3++;
+                          }
+                        }
+                      }
+
+                    }
+                    else {
+                      int data_idx = tree_data_idx(tree, bit_idx_l2, feature_size);
+                      bool oc = packed && is_occupied(cx_l2,cy_l2,cz_l2, 2,2,2, gd,gh,gw, helper);
+                      get_data(oc, cx_l2,cy_l2,cz_l2, 2,2,2, gd,gh,gw, helper, data + data_idx);
+                    }
+                    bit_idx_l2++;
+                  }
+                }
+              }
+            }
+            else {
+              int data_idx = tree_data_idx(tree, bit_idx_l1, feature_size);
+              bool oc = packed && is_occupied(cx_l1,cy_l1,cz_l1, 4,4,4, gd,gh,gw, helper);
+              get_data(oc, cx_l1,cy_l1,cz_l1, 4,4,4, gd,gh,gw, helper, data + data_idx);
+            }
+
+            bit_idx_l1++;
+          }
+        }
+      }
+
+    }
+    else {
+      bool oc = packed && is_occupied(cx,cy,cz, 8,8,8, gd,gh,gw, helper);
+      get_data(oc, cx,cy,cz, 8,8,8, gd,gh,gw, helper, data);
+    }
+
+  }
+}
+
+
+/// Statically dispatched top-down creation for any OctreeCreateCpu source 
+/// Base. The structure, pack and data passes call Base::is_occupied and 
+/// Base::get_data qualified, i.e., without a virtual call per cell, such that
+/// the compiler can inline the source kernels into the passes. The resulting
+/// octree is identical to the one of Base, which remains usable through the 
+/// virtual OctreeCreateCpu interface.
+template <typename Base>
+class OctreeCreateStaticCpu : public Base {
+public:
+  using Base::Base;
+  virtual ~OctreeCreateStaticCpu() {}
+
+protected:
+  virtual void create_octree_structure(octree* grid, OctreeCreateHelperCpu* helper) {
+    octree_create_structure_cpu(grid, helper, 
+        [this](float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper) {
+          return this->Base::is_occupied(cx,cy,cz, vd,vh,vw, gd,gh,gw, helper);
+        });
+  }
+
+  virtual void pack_octree(octree* grid, OctreeCreateHelperCpu* helper) {
+    octree_pack_cpu(grid, helper, 
+        [this](float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper) {
+          return this->Base::is_occupied(cx,cy,cz, vd,vh,vw, gd,gh,gw, helper);
+        });
+  }
+
+  virtual void fill_octree_data(octree* grid, bool packed, OctreeCreateHelperCpu* helper) {
+    octree_fill_data_cpu(grid, packed, helper, 
+        [this](float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper) {
+          return this->Base::is_occupied(cx,cy,cz, vd,vh,vw, gd,gh,gw, helper);
+        },
+        [this](bool oc, float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper, ot_data_t* dst) {
+          this->Base::get_data(oc, cx,cy,cz, vd,vh,vw, gd,gh,gw, helper, dst);
+        });
+  }
+};
+
+#endif
@@ -0,0 +1,43 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef OCTREE_CREATE_MESH_IO_CPU_H
+#define OCTREE_CREATE_MESH_IO_CPU_H
+
+#include <vector>
+
+/// Reads the triangle mesh of the OFF file at path. The file is memory mapped
+/// and split into chunks on line boundaries that are parsed in parallel by 
+/// n_threads. The vertices are rotated by the row-major 3x3 matrix R.
+/// @param verts n_verts x 3 vertex coordinates.
+/// @param faces n_faces x 3 zero-based vertex indices.
+void mesh_read_off_cpu(const char* path, const float R[9], int n_threads, std::vector<float>& verts, std::vector<int>& faces);
+
+/// Reads the triangle mesh of the OBJ file at path, @see mesh_read_off_cpu.
+/// Only v and f (triangles) statements are used, face indices of the form
+/// v/vt/vn are supported.
+void mesh_read_obj_cpu(const char* path, const float R[9], int n_threads, std::vector<float>& verts, std::vector<int>& faces);
+
+#endif
@@ -0,0 +1,148 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef OCTREE_CREATE_RAY_CASTING_CPU_H
+#define OCTREE_CREATE_RAY_CASTING_CPU_H
+
+#include "octnet/core/core.h"
+#include "octnet/geometry/geometry_cpu.h"
+
+
+/// Traverses the leaf cells of sample gn of grid that are hit by the viewing 
+/// ray C + t * ray, t >= 0, in the order of t. The shallow octrees are 
+/// traversed with a 3D-DDA on the block level (ray_casting_traverse_cpu), and
+/// within a block the ray steps from leaf to leaf, hence, empty blocks and 
+/// large cells are passed in a single step. The voxel (d,h,w) of grid spans 
+/// vx_offset + [w,w+1] * vx_width.x, etc.
+/// For each cell visit(data, d, h, w, size, t) is called, where data points to
+/// the feature_size values of the cell, (d,h,w) is its first voxel, size its 
+/// width in voxels, and t the distance where the line enters the cell. The 
+/// traversal is stopped if visit returns false.
+/// @return number of visited cells.
+template <typename Visitor>
+inline int octree_ray_casting_traverse_cpu(const octree* grid, int gn, float3 vx_offset, float3 vx_width, float3 C, float3 ray, Visitor visit) {
+  // the ray in voxel coordinates
+  float p[3], dir[3];
+  for(int axis = 0; axis < 3; ++axis) {
+    p[axis] = (C[axis] - vx_offset[axis]) / vx_width[axis];
+    dir[axis] = fabs(ray[axis]) < EPS ? 0 : ray[axis] / vx_width[axis];
+  }
+
+  float3 block_width;
+  block_width.x = 8 * vx_width.x;
+  block_width.y = 8 * vx_width.y;
+  block_width.z = 8 * vx_width.z;
+
+  int n_visited = 0;
+  bool stopped = false;
+  ray_casting_traverse_cpu(vx_offset, block_width, grid->grid_depth, grid->grid_height, grid->grid_width, C, ray, 
+      [&](int gw, int gh, int gd, float t_block) {
+        const int grid_idx = octree_grid_idx(grid, gn, gd, gh, gw);
+        const ot_tree_t* tree = octree_get_tree(grid, grid_idx);
+        const ot_data_t* data = octree_get_data(grid, grid_idx);
+        const int origin[3] = {gw * 8, gh * 8, gd * 8};
+
+        // first voxel of the ray in the block
+        const float t0 = FMAX(t_block, 0);
+        int bx[3];
+        for(int axis = 0; axis < 3; ++axis) {
+          bx[axis] = floor(p[axis] + t0 * dir[axis]) - origin[axis];
+          bx[axis] = IMAX(0, IMIN(7, bx[axis]));
+        }
+
+        while(true) {
+          const int bit_idx = tree_bit_idx(tree, bx[2], bx[1], bx[0]);
+          const int size = width_from_bit_idx(bit_idx);
+          int cell[3];
+          float t_enter = -1e9;
+          float t_exit = 1e9;
+          int exit_axis = 0;
+          for(int axis = 0; axis < 3; ++axis) {
+            cell[axis] = bx[axis] & ~(size - 1);
+            if(dir[axis] != 0) {
+              float t1 = (origin[axis] + cell[axis] - p[axis]) / dir[axis];
+              float t2 = (origin[axis] + cell[axis] + size - p[axis]) / dir[axis];
+              t_enter = FMAX(t_enter, FMIN(t1, t2));
+              if(FMAX(t1, t2) < t_exit) {
+                t_exit = FMAX(t1, t2);
+                exit_axis = axis;
+              }
+            }
+          }
+
+          n_visited++;
+          if(!visit(data + tree_data_idx(tree, bit_idx, grid->feature_size), origin[2] + cell[2], origin[1] + cell[1], origin[0] + cell[0], size, t_enter)) {
+            stopped = true;
+            return false;
+          }
+
+          // step to the neighbouring cell across the exit face
+          int next = dir[exit_axis] > 0 ? cell[exit_axis] + size : cell[exit_axis] - 1;
+          if(next < 0 || next > 7) {
+            return true;
+          }
+          for(int axis = 0; axis < 3; ++axis) {
+            if(axis == exit_axis) {
+              bx[axis] = next;
+            }
+            else {
+              bx[axis] = floor(p[axis] + t_exit * dir[axis]) - origin[axis];
+              bx[axis] = IMAX(cell[axis], IMIN(cell[axis] + size - 1, bx[axis]));
+            }
+          }
+        }
+      });
+  return n_visited;
+}
+
+
+extern "C" {
+
+/// Renders for each sample of grid a depth map of im_height x im_width pixels
+/// with the camera center C and the inverse projection Pi (3x4), @see 
+/// ray_casting_depth_map_max_cpu. The first feature of grid is interpreted as
+/// probability, and each pixel is set to the depth of the first cell that 
+/// maximizes the probability along the viewing ray, or -1. The depth of a 
+/// cell is the distance where the ray enters it, i.e., 0 for the cell that 
+/// contains C. im has the shape n x im_height x im_width.
+void octree_ray_casting_depth_map_max_cpu(const octree* grid, float3 vx_offset, float3 vx_width, float3 C, const float* Pi, float* im, int im_height, int im_width, int n_threads);
+
+/// Like octree_ray_casting_depth_map_max_cpu, but each pixel is set to the 
+/// mean depth weighted by the probability times the length of the ray in the
+/// cell, or -1 if the ray does not hit a cell with positive probability.
+/// Unlike ray_casting_depth_map_avg_cpu, which divides the sum of the voxel 
+/// depths by the sum of the probabilities, the result does not depend on how 
+/// the octree subdivides a region of constant probability, and the part of 
+/// the ray behind C is clipped.
+void octree_ray_casting_depth_map_avg_cpu(const octree* grid, float3 vx_offset, float3 vx_width, float3 C, const float* Pi, float* im, int im_height, int im_width, int n_threads);
+
+/// Like octree_ray_casting_depth_map_max_cpu, but each pixel is set to the 
+/// depth of the first cell with a probability >= threshold, or -1. The 
+/// traversal of a ray stops at the first hit.
+void octree_ray_casting_depth_map_first_cpu(const octree* grid, float3 vx_offset, float3 vx_width, float3 C, const float* Pi, ot_data_t threshold, float* im, int im_height, int im_width, int n_threads);
+
+}
+
+#endif
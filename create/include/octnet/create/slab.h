@@ -0,0 +1,68 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef OCTREE_CREATE_SLAB_CPU_H
+#define OCTREE_CREATE_SLAB_CPU_H
+
+#include "octnet/core/core.h"
+
+#include <cstdio>
+#include <string>
+
+/// @return path of the shard file slab_idx for shard_prefix, i.e.,
+///         <shard_prefix>_<slab_idx with 5 digits>.oc
+inline std::string octree_slab_path(const char* shard_prefix, int slab_idx) {
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), "_%05d.oc", slab_idx);
+  return std::string(shard_prefix) + suffix;
+}
+
+
+extern "C" {
+
+/// Out-of-core variant of octree_create_from_pc_morton_cpu. The grid is 
+/// processed in slabs of slab_blocks blocks along depth: every slab gathers 
+/// its points in one pass over the input (which can be mmap'd) and converts 
+/// them to an octree of grid_depth = slab_blocks, which is written to the 
+/// shard file octree_slab_path(shard_prefix, slab_idx) and freed. Hence, the 
+/// memory besides the input is bounded by one slab. The points have to be given in voxel 
+/// coordinates (no normalization), fitting is not supported.
+/// @return number of written slabs.
+int octree_create_from_pc_slabs_cpu(const float* xyz, const float* features, int n_pts, int feature_size, ot_size_t depth, ot_size_t height, ot_size_t width, int slab_blocks, bool pack, const char* shard_prefix, int n_threads);
+
+/// Out-of-core variant of octree_create_from_mesh_cpu, @see 
+/// octree_create_from_pc_slabs_cpu. The triangles are binned once by the 
+/// slabs their z-extent overlaps, the vertices have to be given in voxel 
+/// coordinates (no rescaling).
+/// @return number of written slabs.
+int octree_create_from_mesh_slabs_cpu(int n_verts, const float* verts, int n_faces, const int* faces, ot_size_t depth, ot_size_t height, ot_size_t width, int slab_blocks, bool pack, const char* shard_prefix, int n_threads);
+
+/// Reads the shards [slab_from, slab_to) of shard_prefix and concatenates 
+/// them along depth to a single octree (sub-grid) out.
+void octree_read_slabs_cpu(const char* shard_prefix, int slab_from, int slab_to, octree* out);
+
+}
+
+#endif
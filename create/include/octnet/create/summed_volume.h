@@ -0,0 +1,142 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef OCTREE_CREATE_SUMMED_VOLUME_CPU_H
+#define OCTREE_CREATE_SUMMED_VOLUME_CPU_H
+
+#include <vector>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+
+/// 3D summed-volume table (3D prefix sums) of a dense volume with n_channels
+/// channels. After set() has been called for the voxels and integrate() once,
+/// the sum over any box of voxels is computed in O(1) by sum(). 
+/// T should be an integer type for counts and double for feature sums.
+template <typename T>
+class SummedVolumeCpu {
+public:
+  SummedVolumeCpu() : depth(0), height(0), width(0), n_channels(0) {}
+
+  /// Resizes the table and sets all voxels to zero.
+  void resize(int depth_, int height_, int width_, int n_channels_) {
+    depth = depth_;
+    height = height_;
+    width = width_;
+    n_channels = n_channels_;
+    table.assign(long(n_channels) * (depth + 1) * (height + 1) * (width + 1), 0);
+  }
+
+  /// Sets the value of voxel d,h,w in channel c, only valid before integrate().
+  void set(int c, int d, int h, int w, T value) {
+    table[idx(c, d + 1, h + 1, w + 1)] = value;
+  }
+
+  /// Computes the prefix sums in place, first 2D per depth slice, then along
+  /// the depth dimension.
+  void integrate(int n_threads) {
+#if defined(_OPENMP)
+    omp_set_num_threads(n_threads);
+#endif
+    #pragma omp parallel for
+    for(int cd = 0; cd < n_channels * depth; ++cd) {
+      int c = cd / depth;
+      int d = cd % depth + 1;
+      for(int h = 1; h <= height; ++h) {
+        T row = 0;
+        for(int w = 1; w <= width; ++w) {
+          row += table[idx(c, d, h, w)];
+          table[idx(c, d, h, w)] = row + table[idx(c, d, h - 1, w)];
+        }
+      }
+    }
+
+    #pragma omp parallel for
+    for(int ch = 0; ch < n_channels * height; ++ch) {
+      int c = ch / height;
+      int h = ch % height + 1;
+      for(int d = 1; d <= depth; ++d) {
+        for(int w = 1; w <= width; ++w) {
+          table[idx(c, d, h, w)] += table[idx(c, d - 1, h, w)];
+        }
+      }
+    }
+  }
+
+  /// @return the sum of channel c over the voxels [d1,d2) x [h1,h2) x [w1,w2),
+  ///         the box is clipped to the volume.
+  T sum(int c, int d1, int d2, int h1, int h2, int w1, int w2) const {
+    d1 = clip(d1, depth); d2 = clip(d2, depth);
+    h1 = clip(h1, height); h2 = clip(h2, height);
+    w1 = clip(w1, width); w2 = clip(w2, width);
+    if(d1 >= d2 || h1 >= h2 || w1 >= w2) {
+      return 0;
+    }
+    return table[idx(c, d2, h2, w2)] 
+         - table[idx(c, d1, h2, w2)] - table[idx(c, d2, h1, w2)] - table[idx(c, d2, h2, w1)]
+         + table[idx(c, d1, h1, w2)] + table[idx(c, d1, h2, w1)] + table[idx(c, d2, h1, w1)]
+         - table[idx(c, d1, h1, w1)];
+  }
+
+private:
+  long idx(int c, int d, int h, int w) const {
+    return ((long(c) * (depth + 1) + d) * (height + 1) + h) * (width + 1) + w;
+  }
+
+  static int clip(int v, int max_v) {
+    return v < 0 ? 0 : (v > max_v ? max_v : v);
+  }
+
+  int depth;
+  int height;
+  int width;
+  int n_channels;
+  std::vector<T> table;
+};
+
+/// Fills occupancy (one channel) with src.voxel_occupied(d,h,w) for every 
+/// voxel of the depth x height x width volume and integrates it. This visits 
+/// every voxel once, afterwards the occupancy of any cell is an O(1) box sum,
+/// instead of a scan over its voxels on every level of the octree creation.
+template <typename Src>
+void summed_volume_occupancy(const Src& src, int depth, int height, int width, int n_threads, SummedVolumeCpu<int>& occupancy) {
+  occupancy.resize(depth, height, width, 1);
+#if defined(_OPENMP)
+  omp_set_num_threads(n_threads);
+#endif
+  #pragma omp parallel for
+  for(int d = 0; d < depth; ++d) {
+    for(int h = 0; h < height; ++h) {
+      for(int w = 0; w < width; ++w) {
+        occupancy.set(0, d, h, w, src.voxel_occupied(d, h, w));
+      }
+    }
+  }
+  occupancy.integrate(n_threads);
+}
+
+#endif
@@ -0,0 +1,264 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "octnet/create/cache.h"
+#include "octnet/create/create.h"
+#include "octnet/cpu/cpu.h"
+#include "octnet/cpu/io.h"
+#include "octnet/cpu/combine.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+OctreeCacheCpu::OctreeCacheCpu(long max_bytes_, const char* cache_dir_) :
+  max_bytes(max_bytes_), cache_dir(cache_dir_ ? cache_dir_ : ""),
+  bytes(0), hits(0), misses(0) {
+  if(cache_dir.size() > 0) {
+    bool exists = mkdir(cache_dir.c_str(), 0755) == 0 || errno == EEXIST;
+    if(!exists || access(cache_dir.c_str(), R_OK | W_OK | X_OK) != 0) {
+      printf("[WARNING] can not use cache dir %s, caching in memory only\n", cache_dir.c_str());
+      cache_dir = "";
+    }
+  }
+}
+
+std::string OctreeCacheCpu::key(const char* path, const std::string& params) const {
+  struct stat st;
+  if(stat(path, &st) != 0) {
+    return "";
+  }
+  // st_mtime has a resolution of seconds, a file rewritten within the same
+  // second would hit the stale entry
+#if defined(__APPLE__)
+  long mtime_nsec = st.st_mtimespec.tv_nsec;
+#else
+  long mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+  char identity[96];
+  snprintf(identity, sizeof(identity), "|%ld.%09ld|%ld|", long(st.st_mtime), mtime_nsec, long(st.st_size));
+  return std::string(path) + identity + params;
+}
+
+std::string OctreeCacheCpu::disk_path(const std::string& key) const {
+  // 64 bit FNV-1a hash of the key as file name
+  unsigned long long hash = 14695981039346656037ULL;
+  for(size_t idx = 0; idx < key.size(); ++idx) {
+    hash ^= (unsigned char) key[idx];
+    hash *= 1099511628211ULL;
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx.oc", hash);
+  return cache_dir + name;
+}
+
+void OctreeCacheCpu::put_memory(const std::string& key, std::shared_ptr<octree> grid) {
+  long grid_bytes = octree_mem_using(grid.get());
+  if(grid_bytes > max_bytes) {
+    return;
+  }
+
+  std::map<std::string, lru_list::iterator>::iterator it = entries.find(key);
+  if(it != entries.end()) {
+    bytes -= octree_mem_using(it->second->second.get());
+    lru.erase(it->second);
+    entries.erase(it);
+  }
+
+  lru.push_front(std::make_pair(key, grid));
+  entries[key] = lru.begin();
+  bytes += grid_bytes;
+
+  while(bytes > max_bytes) {
+    bytes -= octree_mem_using(lru.back().second.get());
+    entries.erase(lru.back().first);
+    lru.pop_back();
+  }
+}
+
+std::shared_ptr<octree> OctreeCacheCpu::get(const char* path, const std::string& params) {
+  std::string k = key(path, params);
+  if(k.size() == 0) {
+    std::lock_guard<std::mutex> lock(mutex);
+    misses++;
+    return std::shared_ptr<octree>();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<std::string, lru_list::iterator>::iterator it = entries.find(k);
+    if(it != entries.end()) {
+      lru.splice(lru.begin(), lru, it->second);
+      hits++;
+      return lru.front().second;
+    }
+  }
+
+  // the disk level is read without holding the lock, such that other loader
+  // threads are not blocked by the I/O
+  std::shared_ptr<octree> grid;
+  if(cache_dir.size() > 0) {
+    std::string dpath = disk_path(k);
+    if(access(dpath.c_str(), R_OK) == 0) {
+      grid = std::shared_ptr<octree>(octree_new_cpu(), octree_free_cpu);
+      octree_read_cpu(dpath.c_str(), grid.get());
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if(grid) {
+    put_memory(k, grid);
+    hits++;
+  }
+  else {
+    misses++;
+  }
+  return grid;
+}
+
+void OctreeCacheCpu::put(const char* path, const std::string& params, std::shared_ptr<octree> grid) {
+  std::string k = key(path, params);
+  if(k.size() == 0) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    put_memory(k, grid);
+  }
+
+  if(cache_dir.size() > 0) {
+    // write to a temporary file first, such that concurrent readers never
+    // see partial files, the name is unique per process and octree
+    std::string dpath = disk_path(k);
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".%d.%p.tmp", int(getpid()), (void*) grid.get());
+    std::string tmp_path = dpath + suffix;
+    FILE* fp = fopen(tmp_path.c_str(), "wb");
+    if(fp == 0) {
+      printf("[WARNING] can not write cache file %s\n", tmp_path.c_str());
+      return;
+    }
+    fclose(fp);
+    octree_write_cpu(tmp_path.c_str(), grid.get());
+    rename(tmp_path.c_str(), dpath.c_str());
+  }
+}
+
+
+extern "C"
+OctreeCacheCpu* octree_cache_new_cpu(long max_bytes, const char* cache_dir) {
+  return new OctreeCacheCpu(max_bytes, cache_dir);
+}
+
+extern "C"
+void octree_cache_free_cpu(OctreeCacheCpu* cache) {
+  delete cache;
+}
+
+extern "C"
+void octree_cache_stats_cpu(const OctreeCacheCpu* cache, long* n_hits, long* n_misses, long* n_bytes) {
+  n_hits[0] = cache->n_hits();
+  n_misses[0] = cache->n_misses();
+  n_bytes[0] = cache->n_bytes();
+}
+
+
+extern "C"
+octree* octree_create_from_dense_features_batch_cached_cpu(OctreeCacheCpu* cache, int n_paths, char** paths, const ot_data_t* data, int depth, int height, int width, int feature_size, ot_data_t tr_dist, bool fit, int fit_multiply, bool pack, int n_threads) {
+  char params[256];
+  snprintf(params, sizeof(params), "dense_features|%d,%d,%d,%d|%.9g|%d,%d,%d",
+      depth, height, width, feature_size, tr_dist, int(fit), fit_multiply, int(pack));
+
+  int offset = depth * height * width * feature_size;
+  std::vector<std::shared_ptr<octree> > grids(n_paths);
+  std::vector<ot_data_t> sample;
+  for(int n = 0; n < n_paths; ++n) {
+    grids[n] = cache->get(paths[n], params);
+    if(!grids[n]) {
+      const ot_data_t* sample_data = data ? data + n * offset : 0;
+      if(data == 0) {
+        int dims[] = {1, depth, height, width, feature_size};
+        sample.resize(offset);
+        dense_read_prealloc_cpu(paths[n], 5, dims, &sample[0]);
+        sample_data = &sample[0];
+      }
+      grids[n] = std::shared_ptr<octree>(octree_create_from_dense_features_cpu(sample_data, depth, height, width, feature_size, tr_dist, fit, fit_multiply, pack, n_threads), octree_free_cpu);
+      cache->put(paths[n], params, grids[n]);
+    }
+  }
+
+  std::vector<octree*> octrees(n_paths);
+  for(int n = 0; n < n_paths; ++n) {
+    octrees[n] = grids[n].get();
+  }
+  octree* ret = octree_new_cpu();
+  octree_combine_n_cpu(&octrees[0], n_paths, ret);
+  return ret;
+}
+
+extern "C"
+octree* octree_create_from_dense_batch_cached_cpu(OctreeCacheCpu* cache, int n_paths, char** paths, const ot_data_t* data, int depth, int height, int width, int n_ranges, const ot_data_t* ranges, bool fit, int fit_multiply, bool pack, int n_threads) {
+  std::string params;
+  char buf[256];
+  snprintf(buf, sizeof(buf), "dense|%d,%d,%d|%d,%d,%d|", depth, height, width, int(fit), fit_multiply, int(pack));
+  params += buf;
+  for(int ridx = 0; ridx < 2 * n_ranges; ++ridx) {
+    snprintf(buf, sizeof(buf), "%.9g,", ranges[ridx]);
+    params += buf;
+  }
+
+  int offset = depth * height * width;
+  std::vector<std::shared_ptr<octree> > grids(n_paths);
+  std::vector<ot_data_t> sample;
+  for(int n = 0; n < n_paths; ++n) {
+    grids[n] = cache->get(paths[n], params);
+    if(!grids[n]) {
+      const ot_data_t* sample_data = data ? data + n * offset : 0;
+      if(data == 0) {
+        int dims[] = {1, depth, height, width};
+        sample.resize(offset);
+        dense_read_prealloc_cpu(paths[n], 4, dims, &sample[0]);
+        sample_data = &sample[0];
+      }
+      grids[n] = std::shared_ptr<octree>(octree_create_from_dense_cpu(sample_data, depth, height, width, n_ranges, ranges, fit, fit_multiply, pack, n_threads), octree_free_cpu);
+      cache->put(paths[n], params, grids[n]);
+    }
+  }
+
+  std::vector<octree*> octrees(n_paths);
+  for(int n = 0; n < n_paths; ++n) {
+    octrees[n] = grids[n].get();
+  }
+  octree* ret = octree_new_cpu();
+  octree_combine_n_cpu(&octrees[0], n_paths, ret);
+  return ret;
+}
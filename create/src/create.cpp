@@ -24,9 +24,12 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "octnet/create/create.h"
+#include "octnet/create/create_static.h"
 #include "octnet/cpu/cpu.h"
 #include "octnet/cpu/io.h"
+#include "octnet/cpu/misc.h"
 #include <cstring>
+#include <vector>
 
 #if defined(_OPENMP)
 #include <omp.h>
@@ -41,57 +44,10 @@ octree* OctreeCreateCpu::alloc_grid() {
 
 
 void OctreeCreateCpu::create_octree_structure(octree* grid, OctreeCreateHelperCpu* helper) {
-  int n_blocks = octree_num_blocks(grid);
-
-  #pragma omp parallel for
-  for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
-    ot_tree_t* tree = octree_get_tree(grid, grid_idx);
-
-    int gd = grid_idx / (grid_height * grid_width);
-    int gh = (grid_idx / grid_width) % grid_height;
-    int gw = grid_idx % grid_width;
-    
-    float cx = gw * 8 + 4;
-    float cy = gh * 8 + 4;
-    float cz = gd * 8 + 4;
-    if(is_occupied(cx,cy,cz, 8,8,8, gd,gh,gw, helper)) {
-      tree_set_bit(tree, 0);
-
-      int bit_idx_l1 = 1;
-      for(int dl1 = 0; dl1 < 2; ++dl1) {
-        for(int hl1 = 0; hl1 < 2; ++hl1) {
-          for(int wl1 = 0; wl1 < 2; ++wl1) {
-            float cx_l1 = cx + (wl1 * 4) - 2;
-            float cy_l1 = cy + (hl1 * 4) - 2;
-            float cz_l1 = cz + (dl1 * 4) - 2;
-
-            if(is_occupied(cx_l1,cy_l1,cz_l1, 4,4,4, gd,gh,gw, helper)) {
-              tree_set_bit(tree, bit_idx_l1);
-
-              int bit_idx_l2 = tree_child_bit_idx(bit_idx_l1);
-              for(int dl2 = 0; dl2 < 2; ++dl2) {
-                for(int hl2 = 0; hl2 < 2; ++hl2) {
-                  for(int wl2 = 0; wl2 < 2; ++wl2) {
-                    float cx_l2 = cx_l1 + (wl2 * 2) - 1;
-                    float cy_l2 = cy_l1 + (hl2 * 2) - 1;
-                    float cz_l2 = cz_l1 + (dl2 * 2) - 1;
-
-                    if(is_occupied(cx_l2,cy_l2,cz_l2, 2,2,2, gd,gh,gw, helper)) {
-                      tree_set_bit(tree, bit_idx_l2);
-                    }
-                    bit_idx_l2++;
-                  }
-                }
-              }
-            }
-
-            bit_idx_l1++;
-          }
-        }
-      }
-
-    }
-  }
+  octree_create_structure_cpu(grid, helper, 
+      [this](float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper) {
+        return is_occupied(cx,cy,cz, vd,vh,vw, gd,gh,gw, helper);
+      });
 }
 
 
@@ -107,7 +63,7 @@ void OctreeCreateCpu::fit_octree(octree* grid, int fit_multiply, OctreeCreateHel
   for(int d = 0; d < grid->grid_depth; ++d) {
     for(int h = 0; h < grid->grid_height; ++h) {
       for(int w = 0; w < grid->grid_width; ++w) {
-        const int grid_idx = octree_grid_idx(grid, 1,d,h,w);
+        const int grid_idx = octree_grid_idx(grid, 0,d,h,w);
         const ot_tree_t* tree = octree_get_tree(grid, grid_idx);
         if(tree_isset_bit(tree, 0)) {
           min[0] = IMIN(min[0], d);
@@ -222,130 +178,15 @@ void OctreeCreateCpu::fit_octree(octree* grid, int fit_multiply, OctreeCreateHel
 
 
 void OctreeCreateCpu::pack_octree(octree* grid, OctreeCreateHelperCpu* helper) {
-  int n_blocks = octree_num_blocks(grid);
-  
-  #pragma omp parallel for
-  for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
-    ot_tree_t* tree = octree_get_tree(grid, grid_idx);
-
-    int gd = grid_idx / (grid->grid_height * grid->grid_width);
-    int gh = (grid_idx / grid->grid_width) % grid->grid_height;
-    int gw = grid_idx % grid->grid_width;
-
-    helper->update_grid_coords(gd,gh,gw);
-    
-    float cx = gw * 8 + 4;
-    float cy = gh * 8 + 4;
-    float cz = gd * 8 + 4;
-
-    //check l3
-    int bit_idx_l2 = 9;
-    for(int dl1 = 0; dl1 < 2; ++dl1) {
-      for(int hl1 = 0; hl1 < 2; ++hl1) {
-        for(int wl1 = 0; wl1 < 2; ++wl1) {
-
-          for(int dl2 = 0; dl2 < 2; ++dl2) {
-            for(int hl2 = 0; hl2 < 2; ++hl2) {
-              for(int wl2 = 0; wl2 < 2; ++wl2) {
-                
-                if(tree_isset_bit(tree, bit_idx_l2)) {
-                  // printf("    [pack] tree_bit at %d = %d\n", bit_idx_l2, tree_isset_bit(tree, bit_idx_l2));
-                  //check if all leafs are occupied
-                  bool all_oc = true;
-                  for(int dl3 = 0; dl3 < 2 && all_oc; ++dl3) {
-                    for(int hl3 = 0; hl3 < 2 && all_oc; ++hl3) {
-                      for(int wl3 = 0; wl3 < 2 && all_oc; ++wl3) {
-                        float cx_l3 = cx + (4*wl1 - 2) + (2*wl2 - 1) + (wl3 * 1) - 0.5;
-                        float cy_l3 = cy + (4*hl1 - 2) + (2*hl2 - 1) + (hl3 * 1) - 0.5;
-                        float cz_l3 = cz + (4*dl1 - 2) + (2*dl2 - 1) + (dl3 * 1) - 0.5;
-                        // printf("    [pack] CHECK %f,%f,%f, %d,%d,%d, %d,%d,%d\n", cx,cy,cz, wl2,hl2,dl2, wl3,hl3,dl3); 
-                        // printf("    [pack] CHECK %f,%f,%f => %d \n", cx_l3, cy_l3, cz_l3, is_occupied(cx_l3, cy_l3, cz_l3, 1,1,1));
-                        
-                        all_oc = all_oc && is_occupied(cx_l3, cy_l3, cz_l3, 1,1,1, gd,gh,gw, helper);
-                      }
-                    }
-                  }
-                  if(all_oc) {
-                    // printf("    [pack] unset tree at %d\n", bit_idx_l2);
-                    // printf("      %s\n", tree_bit_str(tree).c_str());
-                    tree_unset_bit(tree, bit_idx_l2);
-                    // printf("      %s\n", tree_bit_str(tree).c_str());
-                  }
-                }
-                bit_idx_l2++;
-
-              }
-            }
-          }
-
-        }
-      }
-    }
-
-    //check l2
-    // printf("---------------------------------------------\n");
-    int bit_idx_l1 = 1;
-    for(int dl1 = 0; dl1 < 2; ++dl1) {
-      for(int hl1 = 0; hl1 < 2; ++hl1) {
-        for(int wl1 = 0; wl1 < 2; ++wl1) {
-
-          if(tree_isset_bit(tree, bit_idx_l1)) {
-            bool all_oc = true;
-            int bit_idx_l2 = tree_child_bit_idx(bit_idx_l1);
-            for(int dl2 = 0; dl2 < 2 && all_oc; ++dl2) {
-              for(int hl2 = 0; hl2 < 2 && all_oc; ++hl2) {
-                for(int wl2 = 0; wl2 < 2 && all_oc; ++wl2) {
-                  float cx_l2 = cx + (4*wl1 - 2) + (2*wl2 - 1);
-                  float cy_l2 = cy + (4*hl1 - 2) + (2*hl2 - 1);
-                  float cz_l2 = cz + (4*dl1 - 2) + (2*dl2 - 1);
-                  
-                  all_oc = all_oc && !tree_isset_bit(tree, bit_idx_l2) && is_occupied(cx_l2, cy_l2, cz_l2, 2,2,2, gd,gh,gw, helper);
-                  bit_idx_l2++;
-                }
-              }
-            }
-      
-            if(all_oc) {
-              // printf("    [pack] unset tree at %d\n", bit_idx_l1);
-              // printf("      %s\n", tree_bit_str(tree).c_str());
-              tree_unset_bit(tree, bit_idx_l1);
-              // printf("      %s\n", tree_bit_str(tree).c_str());
-            }
-          }
-          bit_idx_l1++;
-
-        }
-      }
-    }
-
-    //check l1
-    // printf("---------------------------------------------\n");
-    if(tree_isset_bit(tree, 0)) {
-     bool all_oc = true;
-     int bit_idx_l1 = 1;
-      for(int dl1 = 0; dl1 < 2 && all_oc; ++dl1) {
-        for(int hl1 = 0; hl1 < 2 && all_oc; ++hl1) {
-          for(int wl1 = 0; wl1 < 2 && all_oc; ++wl1) {
-            float cx_l2 = cx + (4*wl1 - 2);
-            float cy_l2 = cy + (4*hl1 - 2);
-            float cz_l2 = cz + (4*dl1 - 2);
-            
-            all_oc = all_oc && !tree_isset_bit(tree, bit_idx_l1) && is_occupied(cx_l2, cy_l2, cz_l2, 2,2,2, gd,gh,gw, helper);
-            bit_idx_l1++;
-          }
-        }
-      }
-
-      if(all_oc) {
-        // printf("    [pack] unset tree at %d\n", 0);
-        // printf("      %s\n", tree_bit_str(tree).c_str());
-        tree_unset_bit(tree, 0);
-        // printf("      %s\n", tree_bit_str(tree).c_str());
-      } 
-    }
+  octree_pack_cpu(grid, helper, 
+      [this](float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper) {
+        return is_occupied(cx,cy,cz, vd,vh,vw, gd,gh,gw, helper);
+      });
+}
 
-  } // for grid_idx
 
+void OctreeCreateCpu::merge_homogeneous(octree* grid, int n_threads) {
+  octree_merge_homogeneous_cpu(grid, 0, n_threads, grid);
 }
 
 
@@ -356,99 +197,13 @@ void OctreeCreateCpu::update_and_resize_octree(octree* grid) {
 }
 
 void OctreeCreateCpu::fill_octree_data(octree* grid, bool packed, OctreeCreateHelperCpu* helper) {
-  int n_blocks = octree_num_blocks(grid);
-
-  #pragma omp parallel for
-  for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
-    // printf("    [OctreeCreateCpu] fill grid block %d\n", grid_idx);
-    ot_tree_t* tree = octree_get_tree(grid, grid_idx);
-    // ot_data_t* data = grid->data_ptrs[grid_idx];
-    ot_data_t* data = octree_get_data(grid, grid_idx);
-
-    int gd = grid_idx / (grid->grid_height * grid->grid_width);
-    int gh = (grid_idx / grid->grid_width) % grid->grid_height;
-    int gw = grid_idx % grid->grid_width;
-    
-    helper->update_grid_coords(gd,gh,gw);
-    // if(grid_idx == 1030) printf("      gd,gh,gw, %d,%d,%d\n", gd,gh,gw);
-    
-    float cx = gw * 8 + 4;
-    float cy = gh * 8 + 4;
-    float cz = gd * 8 + 4;
-    // if(grid_idx == 1030) printf("      cx,cy,cz, %f,%f,%f\n", cx,cy,cz);
-    if(tree_isset_bit(tree, 0)) {
-
-      int bit_idx_l1 = 1;
-      for(int dl1 = 0; dl1 < 2; ++dl1) {
-        for(int hl1 = 0; hl1 < 2; ++hl1) {
-          for(int wl1 = 0; wl1 < 2; ++wl1) {
-            float cx_l1 = cx + (wl1 * 4) - 2;
-            float cy_l1 = cy + (hl1 * 4) - 2;
-            float cz_l1 = cz + (dl1 * 4) - 2;
-            // if(grid_idx == 1030) printf("        cz_l1 %f = %f + (%d * 4) - 2\n", cz_l1, cz, dl1);
-
-            if(tree_isset_bit(tree, bit_idx_l1)) {
-
-              int bit_idx_l2 = tree_child_bit_idx(bit_idx_l1);
-              for(int dl2 = 0; dl2 < 2; ++dl2) {
-                for(int hl2 = 0; hl2 < 2; ++hl2) {
-                  for(int wl2 = 0; wl2 < 2; ++wl2) {
-                    float cx_l2 = cx_l1 + (wl2 * 2) - 1;
-                    float cy_l2 = cy_l1 + (hl2 * 2) - 1;
-                    float cz_l2 = cz_l1 + (dl2 * 2) - 1;
-
-                    if(tree_isset_bit(tree, bit_idx_l2)) {
-  
-                      int bit_idx_l3 = tree_child_bit_idx(bit_idx_l2);
-                      for(int dl3 = 0; dl3 < 2; ++dl3) {
-                        for(int hl3 = 0; hl3 < 2; ++hl3) {
-                          for(int wl3 = 0; wl3 < 2; ++wl3) {
-                            float cx_l3 = cx_l2 + (wl3 * 1) - 0.5;
-                            float cy_l3 = cy_l2 + (hl3 * 1) - 0.5;
-                            float cz_l3 = cz_l2 + (dl3 * 1) - 0.5;
-
-                            int data_idx = tree_data_idx(tree, bit_idx_l3, feature_size);
-                            bool oc = is_occupied(cx_l3,cy_l3,cz_l3, 1,1,1, gd,gh,gw, helper);
-
-                            // if(grid_idx == 1030) printf("      get_data l3 %f %f %f\n", cx_l3,cy_l3,cz_l3);
-                            get_data(oc, cx_l3,cy_l3,cz_l3, 1,1,1, gd,gh,gw, helper, data + data_idx);
-                            bit_idx_l3++;
-                          }
-                        }
-                      }
-
-                    }
-                    else {
-                      int data_idx = tree_data_idx(tree, bit_idx_l2, feature_size);
-                      bool oc = packed && is_occupied(cx_l2,cy_l2,cz_l2, 2,2,2, gd,gh,gw, helper);
-                      // if(grid_idx == 1030) printf("      get_data l2 %f %f %f\n", cx_l2,cy_l2,cz_l2);
-                      get_data(oc, cx_l2,cy_l2,cz_l2, 2,2,2, gd,gh,gw, helper, data + data_idx);
-                    }
-                    bit_idx_l2++;
-                  }
-                }
-              }
-            }
-            else {
-              int data_idx = tree_data_idx(tree, bit_idx_l1, feature_size);
-              bool oc = packed && is_occupied(cx_l1,cy_l1,cz_l1, 4,4,4, gd,gh,gw, helper);
-              // if(grid_idx == 1030) printf("      get_data l1 %f %f %f\n", cx_l1,cy_l1,cz_l1);
-              get_data(oc, cx_l1,cy_l1,cz_l1, 4,4,4, gd,gh,gw, helper, data + data_idx);
-            }
-
-            bit_idx_l1++;
-          }
-        }
-      }
-
-    }
-    else {
-      bool oc = packed && is_occupied(cx,cy,cz, 8,8,8, gd,gh,gw, helper);
-      // if(grid_idx == 1030) printf("      get_data l0 %f %f %f\n", cx,cy,cz);
-      get_data(oc, cx,cy,cz, 8,8,8, gd,gh,gw, helper, data);
-    }
-
-  }
+  octree_fill_data_cpu(grid, packed, helper, 
+      [this](float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper) {
+        return is_occupied(cx,cy,cz, vd,vh,vw, gd,gh,gw, helper);
+      },
+      [this](bool oc, float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper, ot_data_t* dst) {
+        get_data(oc, cx,cy,cz, vd,vh,vw, gd,gh,gw, helper, dst);
+      });
 }
 
 
@@ -520,6 +275,13 @@ octree* OctreeCreateCpu::create_octree(bool fit, int fit_multiply, bool pack, in
   omp_set_num_threads(n_threads);
 #endif
   fill_octree_data(grid, pack, helper);
+
+  if(pack) {
+#ifdef VERBOSE
+    printf("  [OctreeCreateCpu] merge homogeneous subtrees\n");
+#endif
+    merge_homogeneous(grid, n_threads);
+  }
 #ifdef VERBOSE
   printf("  [OctreeCreateCpu] done\n");
 #endif
@@ -529,11 +291,102 @@ octree* OctreeCreateCpu::create_octree(bool fit, int fit_multiply, bool pack, in
 
 
 octree* OctreeCreateCpu::operator()(bool fit, int fit_multiply, bool pack, int n_threads) {
+  prepare(n_threads);
   OctreeCreateHelperCpu helper(grid_depth, grid_height, grid_width);
   return create_octree(fit, fit_multiply, pack, n_threads, &helper);
 }
 
 
+/// @return a single sample view onto the trees and data of the batch grid,
+///         starting at block block_offset.
+static octree octree_batch_view(octree* grid, int block_offset) {
+  octree view = *grid;
+  view.n = 1;
+  view.trees = grid->trees + block_offset * N_TREE_INTS;
+  view.prefix_leafs = grid->prefix_leafs + block_offset;
+  return view;
+}
+
+octree* OctreeCreateCpu::create_batch(int batch_size, OctreeCreateCpu** creates, bool fit, int fit_multiply, bool pack, int n_threads) {
+  OctreeCreateCpu* create0 = creates[0];
+  for(int n = 1; n < batch_size; ++n) {
+    if(creates[n]->grid_depth != create0->grid_depth || creates[n]->grid_height != create0->grid_height || 
+       creates[n]->grid_width != create0->grid_width || creates[n]->feature_size != create0->feature_size) {
+      printf("[ERROR] all sources of a batch have to have the same grid dimensions and feature_size\n");
+      exit(-1);
+    }
+  }
+
+  octree* grid = octree_new_cpu();
+  octree_resize_cpu(batch_size, create0->grid_depth, create0->grid_height, create0->grid_width, create0->feature_size, 0, grid);
+  octree_clr_trees_cpu(grid);
+  int n_blocks = create0->grid_depth * create0->grid_height * create0->grid_width;
+
+  std::vector<OctreeCreateHelperCpu> helpers(batch_size, OctreeCreateHelperCpu(create0->grid_depth, create0->grid_height, create0->grid_width));
+  std::vector<octree> views(batch_size);
+
+  // parallelize over the samples if there are enough of them, otherwise 
+  // within the passes of each sample
+  bool parallel_samples = batch_size >= n_threads;
+#if defined(_OPENMP)
+  omp_set_num_threads(n_threads);
+#endif
+
+  // phase 1: structure of every sample in its range of the output trees
+  #pragma omp parallel for if(parallel_samples)
+  for(int n = 0; n < batch_size; ++n) {
+    views[n] = octree_batch_view(grid, n * n_blocks);
+    creates[n]->prepare(n_threads);
+    creates[n]->create_octree_structure(&views[n], &helpers[n]);
+    if(fit) {
+      creates[n]->fit_octree(&views[n], fit_multiply, &helpers[n]);
+    }
+    if(pack) {
+      creates[n]->pack_octree(&views[n], &helpers[n]);
+    }
+  }
+
+  // fitted trees are moved to their final position in the output
+  if(fit) {
+    for(int n = 1; n < batch_size; ++n) {
+      if(views[n].grid_depth != views[0].grid_depth || views[n].grid_height != views[0].grid_height || views[n].grid_width != views[0].grid_width) {
+        printf("[ERROR] fitted grids of all samples have to have the same dimensions\n");
+        exit(-1);
+      }
+    }
+    grid->grid_depth = views[0].grid_depth;
+    grid->grid_height = views[0].grid_height;
+    grid->grid_width = views[0].grid_width;
+    int fit_n_blocks = grid->grid_depth * grid->grid_height * grid->grid_width;
+    for(int n = 1; n < batch_size; ++n) {
+      memmove(grid->trees + n * fit_n_blocks * N_TREE_INTS, views[n].trees, fit_n_blocks * N_TREE_INTS * sizeof(ot_tree_t));
+    }
+    n_blocks = fit_n_blocks;
+  }
+
+  // prefix sum over the leafs of all samples, allocates the output data
+  octree_upd_n_leafs_cpu(grid);
+  octree_resize_as_cpu(grid, grid);
+  octree_upd_prefix_leafs_cpu(grid);
+
+  // phase 2: data of every sample directly in the output data array
+#if defined(_OPENMP)
+  omp_set_num_threads(n_threads);
+#endif
+  #pragma omp parallel for if(parallel_samples)
+  for(int n = 0; n < batch_size; ++n) {
+    views[n] = octree_batch_view(grid, n * n_blocks);
+    creates[n]->fill_octree_data(&views[n], pack, &helpers[n]);
+  }
+
+  if(pack) {
+    create0->merge_homogeneous(grid, n_threads);
+  }
+
+  return grid;
+}
+
+
 
 
 
@@ -26,6 +26,11 @@
 #include "octnet/create/create.h"
 #include "octnet/cpu/cpu.h"
 #include "octnet/cpu/combine.h"
+#include "octnet/create/summed_volume.h"
+#include "octnet/create/create_bottom_up.h"
+#include "octnet/create/create_static.h"
+
+#include <vector>
 
 class OctreeCreateFromDenseCpu : public OctreeCreateCpu {
 public:
@@ -34,32 +39,26 @@ public:
       depth(depth_), height(height_), width(width_), data(data_), n_ranges(n_ranges_), ranges(ranges_) {}
 
   virtual ~OctreeCreateFromDenseCpu() {}
+
+  virtual void prepare(int n_threads) {
+    summed_volume_occupancy(*this, depth, height, width, n_threads, occupancy);
+  }
+
+  bool voxel_occupied(int d, int h, int w) const {
+    float val = data[(d * height + h) * width + w];
+    for(int ridx = 0; ridx < n_ranges; ++ridx) {
+      if(val >= ranges[ridx*2+0] && val < ranges[ridx*2+1]) {
+        return true;
+      }
+    }
+    return false;
+  }
   
   virtual bool is_occupied(float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper) {
-    // printf("is_occupied %f,%f,%f, %f,%f,%f\n", cx, cy, cz, vw, vh, vd);
     int d1 = cz - vd/2.f; int d2 = cz + vd/2.f;
     int h1 = cy - vh/2.f; int h2 = cy + vh/2.f;
     int w1 = cx - vw/2.f; int w2 = cx + vw/2.f;
-    // printf("  %d,%d, %d,%d, %d,%d, (%d,%d,%d)\n", d1,d2, h1,h2, w1,w2, depth,height,width);
-
-    for(int d = d1; d < d2; ++d) {
-      for(int h = h1; h < h2; ++h) {
-        for(int w = w1; w < w2; ++w) {
-          // printf("    l %d,%d,%d\n", d,h,w);
-          if(d >= 0 && h >= 0 && w >= 0 && d < depth && h < height && w < width) {
-            float val = data[(d * height + h) * width + w];
-            // printf("    lval %f\n", val);
-            
-            for(int ridx = 0; ridx < n_ranges; ++ridx) {
-              if(val >= ranges[ridx*2+0] && val < ranges[ridx*2+1]) {
-                return true;
-              }
-            }
-          }
-        }
-      }
-    }
-    return false;
+    return occupancy.sum(0, d1,d2, h1,h2, w1,w2) > 0;
   }
 
   virtual void get_data(bool oc, float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper, ot_data_t* dst) {
@@ -80,33 +79,30 @@ private:
 
   int n_ranges;
   const ot_data_t* ranges;
+
+  SummedVolumeCpu<int> occupancy;
 };
 
 
 extern "C"
 octree* octree_create_from_dense_batch_cpu(const ot_data_t* data, int batch_size, int depth, int height, int width, int n_ranges, const ot_data_t* ranges, bool fit, int fit_multiply, bool pack, int n_threads) {
-  // create individual octrees
-  octree** octrees = new octree*[batch_size];
+  std::vector<OctreeCreateCpu*> creates(batch_size);
   for (int n = 0; n < batch_size; ++n) {
-    octrees[n] = octree_create_from_dense_cpu(data + n*depth*height*width, depth, height, width, n_ranges, ranges, fit, fit_multiply, pack, n_threads);
+    creates[n] = new OctreeCreateStaticCpu<OctreeCreateFromDenseCpu>(depth, height, width, data + n*depth*height*width, n_ranges, ranges);
   }
-  
-  // stack/combine octrees
-  octree* ret = octree_new_cpu();
-  octree_combine_n_cpu(octrees, batch_size, ret);
-  
-  // clean up
+
+  octree* ret = OctreeCreateCpu::create_batch(batch_size, creates.data(), fit, fit_multiply, pack, n_threads);
+
   for (int n = 0; n < batch_size; ++n) {
-    octree_free_cpu(octrees[n]);
+    delete creates[n];
   }
-  
   return ret;
 }
 
 
 extern "C"
 octree* octree_create_from_dense_cpu(const ot_data_t* data, int depth, int height, int width, int n_ranges, const ot_data_t* ranges, bool fit, int fit_multiply, bool pack, int n_threads) {
-  OctreeCreateFromDenseCpu create(depth, height, width, data, n_ranges, ranges);
+  OctreeCreateStaticCpu<OctreeCreateFromDenseCpu> create(depth, height, width, data, n_ranges, ranges);
   return create(fit, fit_multiply, pack, n_threads);
 }
 
@@ -121,25 +117,37 @@ public:
       depth(depth_), height(height_), width(width_), occupancy(occupancy_), features(features_) {}
 
   virtual ~OctreeCreateFromDense2Cpu() {}
-  
-  virtual bool is_occupied(float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper) {
-    int d1 = cz - vd/2.f; int d2 = cz + vd/2.f;
-    int h1 = cy - vh/2.f; int h2 = cy + vh/2.f;
-    int w1 = cx - vw/2.f; int w2 = cx + vw/2.f;
 
-    for(int d = d1; d < d2; ++d) {
-      for(int h = h1; h < h2; ++h) {
-        for(int w = w1; w < w2; ++w) {
-          if(d >= 0 && h >= 0 && w >= 0 && d < depth && h < height && w < width) {
-            float val = occupancy[(d * height + h) * width + w];
-            if(val != 0) {
-              return true;
-            }
+  virtual void prepare(int n_threads) {
+    summed_volume_occupancy(*this, depth, height, width, n_threads, occupancy_sum);
+
+    // feature sums as well, then get_data averages a cell in O(feature_size)
+    features_sum.resize(depth, height, width, feature_size);
+#if defined(_OPENMP)
+    omp_set_num_threads(n_threads);
+#endif
+    #pragma omp parallel for
+    for(int d = 0; d < depth; ++d) {
+      for(int h = 0; h < height; ++h) {
+        for(int w = 0; w < width; ++w) {
+          for(int f = 0; f < feature_size; ++f) {
+            features_sum.set(f, d, h, w, features[((f * depth + d) * height + h) * width + w]);
           }
         }
       }
     }
-    return false;
+    features_sum.integrate(n_threads);
+  }
+
+  bool voxel_occupied(int d, int h, int w) const {
+    return occupancy[(d * height + h) * width + w] != 0;
+  }
+  
+  virtual bool is_occupied(float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper) {
+    int d1 = cz - vd/2.f; int d2 = cz + vd/2.f;
+    int h1 = cy - vh/2.f; int h2 = cy + vh/2.f;
+    int w1 = cx - vw/2.f; int w2 = cx + vw/2.f;
+    return occupancy_sum.sum(0, d1,d2, h1,h2, w1,w2) > 0;
   }
 
   virtual void get_data(bool oc, float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper, ot_data_t* dst) {
@@ -148,17 +156,7 @@ public:
     int w1 = cx - vw/2.f; int w2 = cx + vw/2.f;
 
     for(int f = 0; f < feature_size; ++f) {
-      dst[f] = 0;
-      for(int d = d1; d < d2; ++d) {
-        for(int h = h1; h < h2; ++h) {
-          for(int w = w1; w < w2; ++w) {
-            if(d >= 0 && h >= 0 && w >= 0 && d < depth && h < height && w < width) {
-              dst[f] = features[((f * depth + d) * height + h) * width + w];
-            }
-          }
-        }
-      }
-      dst[f] /= (d2 - d1) * (h2 - h1) * (w2 - w1);
+      dst[f] = features_sum.sum(f, d1,d2, h1,h2, w1,w2) / ((d2 - d1) * (h2 - h1) * (w2 - w1));
     }
   }
 
@@ -169,9 +167,18 @@ private:
 
   const ot_data_t* occupancy;
   const ot_data_t* features;
+
+  SummedVolumeCpu<int> occupancy_sum;
+  SummedVolumeCpu<double> features_sum;
 };
 
 octree* octree_create_from_dense2_cpu(const ot_data_t* occupancy, const ot_data_t* features, int feature_size, int depth, int height, int width, bool fit, int fit_multiply, bool pack, int n_threads) {
-  OctreeCreateFromDense2Cpu create(depth, height, width, occupancy, features, feature_size);
+  OctreeCreateStaticCpu<OctreeCreateFromDense2Cpu> create(depth, height, width, occupancy, features, feature_size);
+  return create(fit, fit_multiply, pack, n_threads);
+}
+
+extern "C"
+octree* octree_create_from_dense_bottom_up_cpu(const ot_data_t* data, int depth, int height, int width, int n_ranges, const ot_data_t* ranges, bool fit, int fit_multiply, bool pack, int n_threads) {
+  OctreeCreateBottomUpCpu<OctreeCreateFromDenseCpu> create(depth, height, width, data, n_ranges, ranges);
   return create(fit, fit_multiply, pack, n_threads);
 }
@@ -27,8 +27,12 @@
 #include "octnet/cpu/cpu.h"
 #include "octnet/cpu/combine.h"
 #include "octnet/cpu/math.h"
+#include "octnet/create/summed_volume.h"
+#include "octnet/create/create_bottom_up.h"
+#include "octnet/create/create_static.h"
 #include <math.h>
 #include <iostream>
+#include <vector>
 
 #if defined(_OPENMP)
 #include <omp.h>
@@ -51,6 +55,19 @@ public:
 
   /// Destructor.
   virtual ~OctreeCreateFromDenseFeaturesCpu() {}
+
+  virtual void prepare(int n_threads) {
+    summed_volume_occupancy(*this, depth, height, width, n_threads, occupancy);
+  }
+
+  /// Occupied if the product of the features is close to zero.
+  bool voxel_occupied(int d, int h, int w) const {
+    ot_data_t prod = 1.0;
+    for (int f = 0; f < feature_size; ++f) {
+      prod *= data[((d*height + h)*width + w)*feature_size + f];
+    }
+    return prod < tr_dist && prod > -tr_dist;
+  }
   
   /// Determine if the given position is occupied, i.e. one feature is different
   /// from zero.
@@ -69,40 +86,11 @@ public:
     int d1 = cz - vd/2.f; int d2 = cz + vd/2.f;
     int h1 = cy - vh/2.f; int h2 = cy + vh/2.f;
     int w1 = cx - vw/2.f; int w2 = cx + vw/2.f;
-
-    for(int d = d1; d < d2; ++d) {
-      for(int h = h1; h < h2; ++h) {
-        for(int w = w1; w < w2; ++w) {
-          if(d >= 0 && h >= 0 && w >= 0 && d < depth && h < height && w < width) {
-            // std::cout << "features: ";
-            bool isnumeric = true;
-            ot_data_t prod = 1.0;
-            for (int f = 0; isnumeric && f < feature_size; ++f) {
-              float val = data[((d*height + h)*width + w)*feature_size + f];
-              
-              // occupied if at least one of the features is significantly
-              // different from zero.
-              prod *= val;
-              // if(isinf(val)){
-              //   isnumeric = false;
-              // } 
-              // std::cout << val << std::endl;
-
-              // if(val > epsilon || val < -epsilon) {
-              //   return true;
-              // }
-            }
-            // if(isnumeric) return true;
-            if(prod < tr_dist && prod > -tr_dist) return true;
-          }
-        }
-      }
-    }
-    
-    return false;
+    return occupancy.sum(0, d1,d2, h1,h2, w1,w2) > 0;
   }
   
-  /// Get the data for the location, i.e. the features.
+  /// Get the data for the location, i.e. the features of the first voxel of
+  /// the cell (not an average), which is O(feature_size).
   /// @param oc
   /// @param cx
   /// @param cy
@@ -136,35 +124,31 @@ private:
   const ot_size_t width;
   const ot_data_t* data;
   const ot_data_t tr_dist;
+
+  SummedVolumeCpu<int> occupancy;
 };
 
 
 extern "C"
 octree* octree_create_from_dense_features_batch_cpu(const ot_data_t* data, int batch_size, int depth, int height, int width, int feature_size, ot_data_t tr_dist, bool fit, int fit_multiply, bool pack, int n_threads) {
-  // create individual octrees
-  octree** octrees = new octree*[batch_size];
-  // #pragma omp parallel for
+  std::vector<OctreeCreateCpu*> creates(batch_size);
   for (int n = 0; n < batch_size; ++n) {
     int offset = depth * height * width * feature_size * n;
-    octrees[n] = octree_create_from_dense_features_cpu(data + offset, depth, height, width, feature_size, tr_dist, fit, fit_multiply, pack, n_threads);
+    creates[n] = new OctreeCreateStaticCpu<OctreeCreateFromDenseFeaturesCpu>(depth, height, width, feature_size, data + offset, tr_dist);
   }
 
-  // stack/combine octrees
-  octree* ret = octree_new_cpu();
-  octree_combine_n_cpu(octrees, batch_size, ret);
-  
-  // clean up
+  octree* ret = OctreeCreateCpu::create_batch(batch_size, creates.data(), fit, fit_multiply, pack, n_threads);
+
   for (int n = 0; n < batch_size; ++n) {
-    octree_free_cpu(octrees[n]);
+    delete creates[n];
   }
-  
   return ret;
 }
 
 
 extern "C"
 octree* octree_create_from_dense_features_cpu(const ot_data_t* data, int depth, int height, int width, int feature_size, ot_data_t tr_dist, bool fit, int fit_multiply, bool pack, int n_threads) {
-  OctreeCreateFromDenseFeaturesCpu create(depth, height, width, feature_size, data, tr_dist);
+  OctreeCreateStaticCpu<OctreeCreateFromDenseFeaturesCpu> create(depth, height, width, feature_size, data, tr_dist);
   return create(fit, fit_multiply, pack, n_threads);
 }
 
@@ -186,6 +170,19 @@ public:
 
   /// Destructor.
   virtual ~OctreeCreateFromDenseFeaturesCpuInverted() {}
+
+  virtual void prepare(int n_threads) {
+    summed_volume_occupancy(*this, depth, height, width, n_threads, occupancy);
+  }
+
+  /// Occupied if the product of the features is close to zero.
+  bool voxel_occupied(int d, int h, int w) const {
+    ot_data_t prod = 1.0;
+    for (int f = 0; f < feature_size; ++f) {
+      prod *= data[((f*depth + d)*height + h)*width + w];
+    }
+    return prod <= tr_dist && prod >= -tr_dist;
+  }
   
   /// Determine if the given position is occupied, i.e. one feature is different
   /// from zero.
@@ -204,40 +201,11 @@ public:
     int d1 = cz - vd/2.f; int d2 = cz + vd/2.f;
     int h1 = cy - vh/2.f; int h2 = cy + vh/2.f;
     int w1 = cx - vw/2.f; int w2 = cx + vw/2.f;
-
-    for(int d = d1; d < d2; ++d) {
-      for(int h = h1; h < h2; ++h) {
-        for(int w = w1; w < w2; ++w) {
-          if(d >= 0 && h >= 0 && w >= 0 && d < depth && h < height && w < width) {
-            // std::cout << "features: ";
-            bool isnumeric = true;
-            ot_data_t prod = 1.0;
-            for (int f = 0; isnumeric && f < feature_size; ++f) {
-              float val = data[((f*depth + d)*height + h)*width + w];
-              
-              // occupied if at least one of the features is significantly
-              // different from zero.
-              prod *= val;
-              // if(isinf(val)){
-              //   isnumeric = false;
-              // } 
-              // std::cout << val << std::endl;
-
-              // if(val > epsilon || val < -epsilon) {
-              //   return true;
-              // }
-            }
-            // if(isnumeric) return true;
-            if(prod <= tr_dist && prod >= -tr_dist) return true;
-          }
-        }
-      }
-    }
-    
-    return false;
+    return occupancy.sum(0, d1,d2, h1,h2, w1,w2) > 0;
   }
   
-  /// Get the data for the location, i.e. the features.
+  /// Get the data for the location, i.e. the features of the first voxel of
+  /// the cell (not an average), which is O(feature_size).
   /// @param oc
   /// @param cx
   /// @param cy
@@ -271,35 +239,36 @@ private:
   const ot_size_t width;
   const ot_data_t* data;
   const ot_data_t tr_dist;
+
+  SummedVolumeCpu<int> occupancy;
 };
 
 
 extern "C"
 octree* octree_create_from_dense_features_batch_inverted_cpu(const ot_data_t* data, int batch_size, int depth, int height, int width, int feature_size, ot_data_t tr_dist, bool fit, int fit_multiply, bool pack, int n_threads) {
-  // create individual octrees
-  octree** octrees = new octree*[batch_size];
- 
-  #pragma omp parallel for
+  std::vector<OctreeCreateCpu*> creates(batch_size);
   for (int n = 0; n < batch_size; ++n) {
     int offset = depth * height * width * feature_size * n;
-    octrees[n] = octree_create_from_dense_features_inverted_cpu(data + offset, depth, height, width, feature_size, tr_dist, fit, fit_multiply, pack, n_threads);
+    creates[n] = new OctreeCreateStaticCpu<OctreeCreateFromDenseFeaturesCpuInverted>(depth, height, width, feature_size, data + offset, tr_dist);
   }
 
-  // stack/combine octrees
-  octree* ret = octree_new_cpu();
-  octree_combine_n_cpu(octrees, batch_size, ret);
-  
-  // clean up
+  octree* ret = OctreeCreateCpu::create_batch(batch_size, creates.data(), fit, fit_multiply, pack, n_threads);
+
   for (int n = 0; n < batch_size; ++n) {
-    octree_free_cpu(octrees[n]);
+    delete creates[n];
   }
-  
   return ret;
 }
 
 
 extern "C"
 octree* octree_create_from_dense_features_inverted_cpu(const ot_data_t* data, int depth, int height, int width, int feature_size, ot_data_t tr_dist, bool fit, int fit_multiply, bool pack, int n_threads) {
-  OctreeCreateFromDenseFeaturesCpuInverted create(depth, height, width, feature_size, data, tr_dist);
+  OctreeCreateStaticCpu<OctreeCreateFromDenseFeaturesCpuInverted> create(depth, height, width, feature_size, data, tr_dist);
   return create(fit, fit_multiply, pack, n_threads);
-}
\ No newline at end of file
+}
+
+extern "C"
+octree* octree_create_from_dense_features_bottom_up_cpu(const ot_data_t* data, int depth, int height, int width, int feature_size, ot_data_t tr_dist, bool fit, int fit_multiply, bool pack, int n_threads) {
+  OctreeCreateBottomUpCpu<OctreeCreateFromDenseFeaturesCpu> create(depth, height, width, feature_size, data, tr_dist);
+  return create(fit, fit_multiply, pack, n_threads);
+}
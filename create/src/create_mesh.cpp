@@ -24,17 +24,109 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "octnet/create/create_from_mesh.h"
+#include "octnet/create/create_bottom_up.h"
+#include "octnet/create/create_static.h"
+#include "octnet/create/slab.h"
+#include "octnet/cpu/cpu.h"
+#include "octnet/cpu/io.h"
+
+#include <cmath>
+#include <vector>
 
 extern "C"
 octree* octree_create_from_mesh_cpu(int n_verts_, float* verts_, int n_faces_, int* faces_, bool rescale_verts, ot_size_t depth, ot_size_t height, ot_size_t width, bool fit, int fit_multiply, bool pack, int pad, int n_threads) {
 #ifdef VERBOSE
   printf("create octree\n");
 #endif
-  OctreeFromMesh create(n_verts_, verts_, n_faces_, faces_, rescale_verts, depth, height, width, pad);
+  OctreeCreateStaticCpu<OctreeFromMesh> create(n_verts_, verts_, n_faces_, faces_, rescale_verts, depth, height, width, pad);
   return create(fit, fit_multiply, pack, n_threads);
 }
 
+extern "C"
+octree* octree_create_from_mesh_bottom_up_cpu(int n_verts_, float* verts_, int n_faces_, int* faces_, bool rescale_verts, ot_size_t depth, ot_size_t height, ot_size_t width, bool fit, int fit_multiply, bool pack, int pad, int n_threads) {
+  OctreeCreateBottomUpCpu<OctreeFromMesh> create(n_verts_, verts_, n_faces_, faces_, rescale_verts, depth, height, width, pad);
+  return create(fit, fit_multiply, pack, n_threads);
+}
 
+extern "C"
+int octree_create_from_mesh_slabs_cpu(int n_verts, const float* verts, int n_faces, const int* faces, ot_size_t depth, ot_size_t height, ot_size_t width, int slab_blocks, bool pack, const char* shard_prefix, int n_threads) {
+  if(slab_blocks <= 0) {
+    printf("[ERROR] slab_blocks has to be positive in octree_create_from_mesh_slabs_cpu\n");
+    exit(-1);
+  }
+  const int grid_depth = (depth + 7) / 8;
+  const int n_slabs = (grid_depth + slab_blocks - 1) / slab_blocks;
 
+  // range of slabs of a face, from its range of blocks along depth enlarged
+  // as in OctreeFromMesh::face_block_bb
+  auto face_slabs = [&](int fidx, int& slab_lo, int& slab_hi) {
+    float min_z = 1e9;
+    float max_z = -1e9;
+    for(int vidx = 0; vidx < 3; ++vidx) {
+      float z = verts[faces[fidx * 3 + vidx] * 3 + 2];
+      min_z = FMIN(min_z, z);
+      max_z = FMAX(max_z, z);
+    }
+    int gd_lo = floor(min_z / 8.f - 1e-4f);
+    int gd_hi = floor(max_z / 8.f + 1e-4f);
+    slab_lo = IMAX(gd_lo, 0) / slab_blocks;
+    slab_hi = IMIN(gd_hi, grid_depth - 1) / slab_blocks;
+    return gd_hi >= 0 && gd_lo < grid_depth;
+  };
 
+  // bin the faces once by the slabs they overlap (counting sort)
+  std::vector<int> slab_offsets(n_slabs + 1, 0);
+  for(int fidx = 0; fidx < n_faces; ++fidx) {
+    int slab_lo, slab_hi;
+    if(face_slabs(fidx, slab_lo, slab_hi)) {
+      for(int slab_idx = slab_lo; slab_idx <= slab_hi; ++slab_idx) {
+        slab_offsets[slab_idx + 1]++;
+      }
+    }
+  }
+  for(int slab_idx = 0; slab_idx < n_slabs; ++slab_idx) {
+    slab_offsets[slab_idx + 1] += slab_offsets[slab_idx];
+  }
+  std::vector<int> slab_fidx(slab_offsets[n_slabs]);
+  std::vector<int> slab_pos(slab_offsets.begin(), slab_offsets.end() - 1);
+  for(int fidx = 0; fidx < n_faces; ++fidx) {
+    int slab_lo, slab_hi;
+    if(face_slabs(fidx, slab_lo, slab_hi)) {
+      for(int slab_idx = slab_lo; slab_idx <= slab_hi; ++slab_idx) {
+        slab_fidx[slab_pos[slab_idx]++] = fidx;
+      }
+    }
+  }
 
+  std::vector<float> slab_verts;
+  std::vector<int> slab_faces;
+  for(int slab_idx = 0; slab_idx < n_slabs; ++slab_idx) {
+    const int gd0 = slab_idx * slab_blocks;
+    const int slab_depth = IMIN(slab_blocks * 8, depth - gd0 * 8);
+
+    // copy the faces of the slab with unshared vertices in slab coordinates
+    slab_verts.clear();
+    slab_faces.clear();
+    for(int idx = slab_offsets[slab_idx]; idx < slab_offsets[slab_idx + 1]; ++idx) {
+      int fidx = slab_fidx[idx];
+      for(int vidx = 0; vidx < 3; ++vidx) {
+        const float* v = verts + faces[fidx * 3 + vidx] * 3;
+        slab_faces.push_back(slab_verts.size() / 3);
+        slab_verts.push_back(v[0]);
+        slab_verts.push_back(v[1]);
+        slab_verts.push_back(v[2] - gd0 * 8);
+      }
+    }
+    int slab_n_faces = slab_faces.size() / 3;
+    int slab_n_verts = slab_verts.size() / 3;
+    slab_verts.resize(IMAX(slab_verts.size(), 3));
+    slab_faces.resize(IMAX(slab_faces.size(), 3));
+
+    OctreeCreateStaticCpu<OctreeFromMesh> create(slab_n_verts, &slab_verts[0], slab_n_faces, &slab_faces[0], false, slab_depth, height, width, 0);
+    octree* grid = create(false, 1, pack, n_threads);
+    octree_write_cpu(octree_slab_path(shard_prefix, slab_idx).c_str(), grid);
+    octree_free_cpu(grid);
+  }
+
+  return n_slabs;
+}
@@ -24,85 +24,23 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "octnet/create/create_from_mesh.h"
+#include "octnet/create/mesh_io.h"
 
 
 extern "C"
 octree* octree_create_from_off_cpu(const char* path, ot_size_t depth, ot_size_t height, ot_size_t width, const float R[9], bool fit, int fit_multiply, bool pack, int pad, int n_threads) {
-  std::ifstream file(path);
-  std::string line;
-  std::stringstream ss;
-  int line_nb = 0;
 #ifdef VERBOSE
   printf("[INFO] parse off file\n");
 #endif
-  //parse header
-  std::getline(file, line); ++line_nb;
-  if(line != "off" && line != "OFF") {
-    std::cout << "invalid header: " << line << std::endl;
-    std::cout << path << std::endl;
-    exit(-1);
-  }
-
-  //parse n vertices, n faces
-  size_t n_verts, n_faces;
-  std::getline(file, line); ++line_nb;
-  ss << line;
-  ss >> n_verts;
-  ss >> n_faces;
-  int dummy;
-  ss >> dummy;
-
-  //reserve memory for vertices and triangs
   std::vector<float> verts;
   std::vector<int> faces;
+  mesh_read_off_cpu(path, R, n_threads, verts, faces);
 
-  //parse vertices
-  float x,y,z;
-  float x_,y_,z_;
-  for(size_t idx = 0; idx < n_verts; ++idx) {
-    std::getline(file, line); ++line_nb;
-    ss.clear(); ss.str("");
-    ss << line;
-    ss >> x_;  
-    ss >> y_;  
-    ss >> z_;  
-
-    x = R[0] * x_ + R[1] * y_ + R[2] * z_;
-    y = R[3] * x_ + R[4] * y_ + R[5] * z_;
-    z = R[6] * x_ + R[7] * y_ + R[8] * z_;
-
-    verts.push_back(x);
-    verts.push_back(y);
-    verts.push_back(z);
-  }
-
-  //parse faces
-  for(size_t idx = 0; idx < n_faces; ++idx) {
-    std::getline(file, line); ++line_nb;
-    ss.clear(); ss.str("");
-    ss << line;
-    ss >> dummy;
-    if(dummy != 3) {
-      std::cout << "not a triangle, has " << dummy << " pts" << std::endl;
-      exit(-1);
-    }
-
-    ss >> dummy; faces.push_back(dummy);
-    ss >> dummy; faces.push_back(dummy);
-    ss >> dummy; faces.push_back(dummy);
-  }
-
-  if(n_verts != verts.size() / 3) {
-    std::cout << "n_verts in header differs from actual n_verts" << std::endl;
-    exit(-1);
-  }
-  if(n_faces != faces.size() / 3) {
-    std::cout << "n_faces in header differs from actual n_faces" << std::endl;
-    exit(-1);
-  }
-
-  file.close();
-
+  int n_verts = verts.size() / 3;
+  int n_faces = faces.size() / 3;
+#ifdef VERBOSE
+  printf("[INFO] parsed %d vertices and %d faces\n", n_verts, n_faces);
+#endif
   bool rescale = true;
 #ifdef VERBOSE
   printf("[INFO] create octree from mesh\n");
@@ -111,8 +49,3 @@ octree* octree_create_from_off_cpu(const char* path, ot_size_t depth, ot_size_t
 
   return grid;
 }
-
-
-
-
-
@@ -24,10 +24,16 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "octnet/create/create.h"
+#include "octnet/create/create_bottom_up.h"
+#include "octnet/create/create_static.h"
+#include "octnet/create/slab.h"
 #include "octnet/cpu/cpu.h"
+#include "octnet/cpu/io.h"
 
 #include <vector>
+#include <algorithm>
 #include <cstring>
+#include <cmath>
 
 #if defined(_OPENMP)
 #include <omp.h>
@@ -125,7 +131,7 @@ public:
   }
 
   virtual bool is_occupied(float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper_) {
-    OctreeCreateFromPCHelperCpu* helper = dynamic_cast<OctreeCreateFromPCHelperCpu*>(helper_);
+    OctreeCreateFromPCHelperCpu* helper = static_cast<OctreeCreateFromPCHelperCpu*>(helper_);
     std::vector<int>& xyz_inds = helper->xyz_inds[helper->get_grid_idx(gd, gh, gw)];
 
     float min_x = cx - vw/2;
@@ -150,7 +156,7 @@ public:
   }
 
   virtual void get_data(bool oc, float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper_, ot_data_t* dst) {
-    OctreeCreateFromPCHelperCpu* helper = dynamic_cast<OctreeCreateFromPCHelperCpu*>(helper_);
+    OctreeCreateFromPCHelperCpu* helper = static_cast<OctreeCreateFromPCHelperCpu*>(helper_);
     std::vector<int>& xyz_inds = helper->xyz_inds[helper->get_grid_idx(gd, gh, gw)];
     
     if(features == 0) {
@@ -271,12 +277,211 @@ protected:
 };
 
 
+/// Sorts keys in ascending order and permutes inds accordingly with a stable
+/// LSD radix sort (8 bit digits). Only the digits up to the highest set bit 
+/// of max_key are sorted. Histograms and scatter are computed in parallel on
+/// fixed chunks, hence, the result does not depend on the number of threads.
+static void radix_sort_keys(std::vector<unsigned long long>& keys, std::vector<int>& inds, unsigned long long max_key, int n_threads) {
+  const long n = keys.size();
+  const int n_chunks = IMAX(1, IMIN(n_threads, int(n / 4096)));
+  const long chunk_size = (n + n_chunks - 1) / n_chunks;
+
+  std::vector<unsigned long long> keys_tmp(n);
+  std::vector<int> inds_tmp(n);
+  std::vector<long> hist(n_chunks * 256);
+
+  for(int shift = 0; shift < 64 && (max_key >> shift) > 0; shift += 8) {
+    std::fill(hist.begin(), hist.end(), 0);
+    #pragma omp parallel for
+    for(int chunk = 0; chunk < n_chunks; ++chunk) {
+      long* h = hist.data() + chunk * 256;
+      long end = IMIN(n, (chunk + 1) * chunk_size);
+      for(long idx = chunk * chunk_size; idx < end; ++idx) {
+        h[(keys[idx] >> shift) & 255]++;
+      }
+    }
+
+    // exclusive prefix sum, digit major, chunk minor for stability
+    long sum = 0;
+    for(int digit = 0; digit < 256; ++digit) {
+      for(int chunk = 0; chunk < n_chunks; ++chunk) {
+        long cnt = hist[chunk * 256 + digit];
+        hist[chunk * 256 + digit] = sum;
+        sum += cnt;
+      }
+    }
+
+    #pragma omp parallel for
+    for(int chunk = 0; chunk < n_chunks; ++chunk) {
+      long* h = hist.data() + chunk * 256;
+      long end = IMIN(n, (chunk + 1) * chunk_size);
+      for(long idx = chunk * chunk_size; idx < end; ++idx) {
+        long pos = h[(keys[idx] >> shift) & 255]++;
+        keys_tmp[pos] = keys[idx];
+        inds_tmp[pos] = inds[idx];
+      }
+    }
+    keys.swap(keys_tmp);
+    inds.swap(inds_tmp);
+  }
+}
+
+class OctreeCreateFromPCMortonHelperCpu : public OctreeCreateHelperCpu {
+public:
+  OctreeCreateFromPCMortonHelperCpu(ot_size_t grid_depth_, ot_size_t grid_height_, ot_size_t grid_width_) :
+    OctreeCreateHelperCpu(grid_depth_, grid_height_, grid_width_), 
+    block_offsets(grid_depth_ * grid_height_ * grid_width_ + 1),
+    masks(8 * grid_depth_ * grid_height_ * grid_width_, 0)
+  {}
+  virtual ~OctreeCreateFromPCMortonHelperCpu() {}
+
+public:
+  /// sorted keys (grid_idx << 9 | morton_local) of the points within the grid
+  std::vector<unsigned long long> keys;
+  /// point indices in the order of keys
+  std::vector<int> inds;
+  /// range of keys for every block
+  std::vector<long> block_offsets;
+  /// 512 bit voxel occupancy of every block, indexed by morton_local
+  std::vector<unsigned long long> masks;
+};
+
+
+/// Point cloud to octree conversion that quantizes the points to voxels and
+/// sorts them by block and Morton code. Occupancy of any cell is then a range 
+/// test on a per block bit mask, and the features of a cell are averaged over
+/// a contiguous range of the sorted points. In contrast to OctreeFromPC, a 
+/// point on a voxel boundary is assigned only to the voxel floor(x,y,z).
+class OctreeFromPCMorton : public OctreeFromPC {
+public:
+  OctreeFromPCMorton(float* xyz_, const float* features_, int n_pts_, int feature_size_, ot_size_t depth_, ot_size_t height_, ot_size_t width_, bool normalize, bool normalize_inplace, int pad_) : 
+      OctreeFromPC(xyz_, features_, n_pts_, feature_size_, depth_, height_, width_, normalize, normalize_inplace, pad_) {}
+  virtual ~OctreeFromPCMorton() {}
+
+  virtual octree* operator()(bool fit, int fit_multiply, bool pack, int n_threads) {
+    int n_blocks = grid_depth * grid_height * grid_width;
+    OctreeCreateFromPCMortonHelperCpu helper(grid_depth, grid_height, grid_width);
+
+#if defined(_OPENMP)
+    omp_set_num_threads(n_threads);
+#endif
+    // quantize, points outside of the grid get the key n_blocks << 9 and are
+    // sorted to the end
+    const unsigned long long invalid_key = (unsigned long long)(n_blocks) << 9;
+    helper.keys.resize(n_pts);
+    helper.inds.resize(n_pts);
+    #pragma omp parallel for
+    for(int xyz_idx = 0; xyz_idx < n_pts; ++xyz_idx) {
+      float x = xyz[xyz_idx * 3 + 0];
+      float y = xyz[xyz_idx * 3 + 1];
+      float z = xyz[xyz_idx * 3 + 2];
+      unsigned long long key = invalid_key;
+      if(x >= 0 && y >= 0 && z >= 0 && x < grid_width * 8 && y < grid_height * 8 && z < grid_depth * 8) {
+        int w = x;
+        int h = y;
+        int d = z;
+        int grid_idx = ((d / 8) * grid_height + (h / 8)) * grid_width + (w / 8);
+        key = ((unsigned long long)(grid_idx) << 9) | morton_local(d % 8, h % 8, w % 8);
+      }
+      helper.keys[xyz_idx] = key;
+      helper.inds[xyz_idx] = xyz_idx;
+    }
+
+    radix_sort_keys(helper.keys, helper.inds, invalid_key, n_threads);
+
+    #pragma omp parallel for
+    for(int grid_idx = 0; grid_idx <= n_blocks; ++grid_idx) {
+      unsigned long long key = (unsigned long long)(grid_idx) << 9;
+      helper.block_offsets[grid_idx] = std::lower_bound(helper.keys.begin(), helper.keys.end(), key) - helper.keys.begin();
+    }
+
+    #pragma omp parallel for
+    for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
+      unsigned long long* mask = helper.masks.data() + grid_idx * 8;
+      for(long idx = helper.block_offsets[grid_idx]; idx < helper.block_offsets[grid_idx + 1]; ++idx) {
+        int local = helper.keys[idx] & 511;
+        mask[local / 64] |= 1ULL << (local % 64);
+      }
+    }
+
+    return create_octree(fit, fit_multiply, pack, n_threads, &helper);
+  }
+
+  virtual bool is_occupied(float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper_) {
+    OctreeCreateFromPCMortonHelperCpu* helper = static_cast<OctreeCreateFromPCMortonHelperCpu*>(helper_);
+    int grid_idx, local, n_local;
+    cell_range(cx,cy,cz, vd, gd,gh,gw, helper, grid_idx, local, n_local);
+    
+    const unsigned long long* mask = helper->masks.data() + grid_idx * 8;
+    if(n_local >= 64) {
+      for(int widx = local / 64; widx < (local + n_local) / 64; ++widx) {
+        if(mask[widx] != 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+    unsigned long long bits = (1ULL << n_local) - 1;
+    return ((mask[local / 64] >> (local % 64)) & bits) != 0;
+  }
+
+  virtual void get_data(bool oc, float cx, float cy, float cz, float vd, float vh, float vw, int gd, int gh, int gw, OctreeCreateHelperCpu* helper_, ot_data_t* dst) {
+    if(features == 0) {
+      for(int f = 0; f < feature_size; ++f) {
+        dst[f] = oc ? 1 : 0;
+      }
+      return;
+    }
+
+    for(int f = 0; f < feature_size; ++f) {
+      dst[f] = 0;
+    }
+    if(!oc) {
+      return;
+    }
+
+    OctreeCreateFromPCMortonHelperCpu* helper = static_cast<OctreeCreateFromPCMortonHelperCpu*>(helper_);
+    int grid_idx, local, n_local;
+    cell_range(cx,cy,cz, vd, gd,gh,gw, helper, grid_idx, local, n_local);
+
+    std::vector<unsigned long long>::const_iterator block_begin = helper->keys.begin() + helper->block_offsets[grid_idx];
+    std::vector<unsigned long long>::const_iterator block_end = helper->keys.begin() + helper->block_offsets[grid_idx + 1];
+    unsigned long long key = ((unsigned long long)(grid_idx) << 9) | local;
+    long begin = std::lower_bound(block_begin, block_end, key) - helper->keys.begin();
+    long end = std::lower_bound(block_begin, block_end, key + n_local) - helper->keys.begin();
+
+    for(long idx = begin; idx < end; ++idx) {
+      int xyz_idx = helper->inds[idx];
+      for(int f = 0; f < feature_size; ++f) {
+        dst[f] += features[xyz_idx * feature_size + f];
+      }
+    }
+    for(int f = 0; f < feature_size; ++f) {
+      dst[f] /= (end - begin);
+    }
+  }
+
+protected:
+  /// Computes the block index and the range of Morton codes [local, local + 
+  /// n_local) of the cell with center cx,cy,cz and size vd.
+  void cell_range(float cx, float cy, float cz, float vd, int gd, int gh, int gw, OctreeCreateHelperCpu* helper, int& grid_idx, int& local, int& n_local) {
+    int size = vd;
+    int ld = int(cz - vd/2) - gd * 8;
+    int lh = int(cy - vd/2) - gh * 8;
+    int lw = int(cx - vd/2) - gw * 8;
+    grid_idx = helper->get_grid_idx(gd, gh, gw);
+    local = morton_local(ld, lh, lw);
+    n_local = size * size * size;
+  }
+};
+
+
 extern "C"
 octree* octree_create_from_pc_simple_cpu(float* xyz, int n_pts, int feature_size, ot_size_t depth, ot_size_t height, ot_size_t width, bool normalize, bool normalize_inplace, bool fit, int fit_multiply, bool pack, int pad, int n_threads) {
 #ifdef VERBOSE
   printf("pc simple - n_pts: %d, feature_size: %d\n", n_pts, feature_size);
 #endif
-  OctreeFromPC create(xyz, n_pts, feature_size, depth, height, width, normalize, normalize_inplace, pad);
+  OctreeCreateStaticCpu<OctreeFromPC> create(xyz, n_pts, feature_size, depth, height, width, normalize, normalize_inplace, pad);
 #ifdef VERBOSE
   printf("create octree\n");
 #endif
@@ -288,9 +493,68 @@ octree* octree_create_from_pc_cpu(float* xyz, const float* features, int n_pts,
 #ifdef VERBOSE
   printf("pc - n_pts: %d, feature_size: %d\n", n_pts, feature_size);
 #endif
-  OctreeFromPC create(xyz, features, n_pts, feature_size, depth, height, width, normalize, normalize_inplace, pad);
+  OctreeCreateStaticCpu<OctreeFromPC> create(xyz, features, n_pts, feature_size, depth, height, width, normalize, normalize_inplace, pad);
 #ifdef VERBOSE
   printf("create octree\n");
 #endif
   return create(fit, fit_multiply, pack, n_threads);
 }
+
+extern "C"
+octree* octree_create_from_pc_morton_cpu(float* xyz, const float* features, int n_pts, int feature_size, ot_size_t depth, ot_size_t height, ot_size_t width, bool normalize, bool normalize_inplace, bool fit, int fit_multiply, bool pack, int pad, int n_threads) {
+  OctreeCreateStaticCpu<OctreeFromPCMorton> create(xyz, features, n_pts, feature_size, depth, height, width, normalize, normalize_inplace, pad);
+  return create(fit, fit_multiply, pack, n_threads);
+}
+
+extern "C"
+octree* octree_create_from_pc_bottom_up_cpu(float* xyz, const float* features, int n_pts, int feature_size, ot_size_t depth, ot_size_t height, ot_size_t width, bool normalize, bool normalize_inplace, bool fit, int fit_multiply, bool pack, int pad, int n_threads) {
+  OctreeCreateBottomUpCpu<OctreeFromPCMorton> create(xyz, features, n_pts, feature_size, depth, height, width, normalize, normalize_inplace, pad);
+  return create(fit, fit_multiply, pack, n_threads);
+}
+
+extern "C"
+int octree_create_from_pc_slabs_cpu(const float* xyz, const float* features, int n_pts, int feature_size, ot_size_t depth, ot_size_t height, ot_size_t width, int slab_blocks, bool pack, const char* shard_prefix, int n_threads) {
+  if(slab_blocks <= 0) {
+    printf("[ERROR] slab_blocks has to be positive in octree_create_from_pc_slabs_cpu\n");
+    exit(-1);
+  }
+  const int grid_depth = (depth + 7) / 8;
+  const int n_slabs = (grid_depth + slab_blocks - 1) / slab_blocks;
+
+  // one pass over the input per slab that gathers only the points of the slab
+  // in slab coordinates, hence, the memory is bounded by the largest slab and
+  // an mmap'd input is streamed. Points outside of the grid depth are dropped
+  // as in octree_create_from_pc_morton_cpu
+  std::vector<float> slab_xyz;
+  std::vector<float> slab_features;
+  for(int slab_idx = 0; slab_idx < n_slabs; ++slab_idx) {
+    const int gd0 = slab_idx * slab_blocks;
+    const int slab_depth = IMIN(slab_blocks * 8, depth - gd0 * 8);
+
+    slab_xyz.clear();
+    slab_features.clear();
+    for(int pt_idx = 0; pt_idx < n_pts; ++pt_idx) {
+      float z = xyz[pt_idx * 3 + 2];
+      if(!(z >= 0 && z < grid_depth * 8) || (int(z) / 8) / slab_blocks != slab_idx) {
+        continue;
+      }
+      // the shift is exact as z >= gd0 * 8 > z / 2
+      slab_xyz.push_back(xyz[pt_idx * 3 + 0]);
+      slab_xyz.push_back(xyz[pt_idx * 3 + 1]);
+      slab_xyz.push_back(z - gd0 * 8);
+      if(features) {
+        slab_features.insert(slab_features.end(), features + long(pt_idx) * feature_size, features + long(pt_idx + 1) * feature_size);
+      }
+    }
+    const int slab_n_pts = slab_xyz.size() / 3;
+    slab_xyz.resize(3 * IMAX(slab_n_pts, 1));
+    slab_features.resize(features ? IMAX(slab_n_pts, 1) * feature_size : 0);
+
+    OctreeCreateStaticCpu<OctreeFromPCMorton> create(&slab_xyz[0], features ? &slab_features[0] : 0, slab_n_pts, feature_size, slab_depth, height, width, false, false, 0);
+    octree* grid = create(false, 1, pack, n_threads);
+    octree_write_cpu(octree_slab_path(shard_prefix, slab_idx).c_str(), grid);
+    octree_free_cpu(grid);
+  }
+
+  return n_slabs;
+}
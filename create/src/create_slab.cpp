@@ -0,0 +1,80 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "octnet/create/slab.h"
+#include "octnet/cpu/cpu.h"
+#include "octnet/cpu/io.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+
+extern "C"
+void octree_read_slabs_cpu(const char* shard_prefix, int slab_from, int slab_to, octree* out) {
+  if(slab_to <= slab_from) {
+    printf("[ERROR] invalid slab range [%d, %d) in octree_read_slabs_cpu\n", slab_from, slab_to);
+    exit(-1);
+  }
+
+  // the structure of the shards determines the size of the sub-grid
+  int grid_depth = 0;
+  int grid_height = 0;
+  int grid_width = 0;
+  int n_leafs = 0;
+  octree* slab = octree_new_cpu();
+  for(int slab_idx = slab_from; slab_idx < slab_to; ++slab_idx) {
+    octree_read_structure_cpu(octree_slab_path(shard_prefix, slab_idx).c_str(), slab);
+    if(slab->n != 1 || (slab_idx > slab_from && (slab->grid_height != grid_height || slab->grid_width != grid_width))) {
+      printf("[ERROR] shard %d of %s does not match the other shards\n", slab_idx, shard_prefix);
+      exit(-1);
+    }
+    grid_depth += slab->grid_depth;
+    grid_height = slab->grid_height;
+    grid_width = slab->grid_width;
+    n_leafs += slab->n_leafs;
+  }
+
+  // trees and data are ordered by depth first, hence, the slabs are appended
+  int block_offset = 0;
+  int leaf_offset = 0;
+  for(int slab_idx = slab_from; slab_idx < slab_to; ++slab_idx) {
+    octree_read_cpu(octree_slab_path(shard_prefix, slab_idx).c_str(), slab);
+    if(slab_idx == slab_from) {
+      octree_resize_cpu(1, grid_depth, grid_height, grid_width, slab->feature_size, n_leafs, out);
+    }
+    else if(slab->feature_size != out->feature_size) {
+      printf("[ERROR] feature_size of shard %d of %s does not match\n", slab_idx, shard_prefix);
+      exit(-1);
+    }
+    int n_blocks = octree_num_blocks(slab);
+    memcpy(out->trees + block_offset * N_TREE_INTS, slab->trees, n_blocks * N_TREE_INTS * sizeof(ot_tree_t));
+    memcpy(out->data + long(leaf_offset) * out->feature_size, slab->data, long(slab->n_leafs) * slab->feature_size * sizeof(ot_data_t));
+    block_offset += n_blocks;
+    leaf_offset += slab->n_leafs;
+  }
+  octree_upd_prefix_leafs_cpu(out);
+  octree_free_cpu(slab);
+}
@@ -0,0 +1,378 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "octnet/create/mesh_io.h"
+#include "octnet/cpu/file_mapping.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+
+/// Memory maps the text file at path, exits on failure.
+static void text_map(const char* path, const char* fcn, file_mapping& m) {
+  const char* err = m.map(path);
+  if(err) {
+    printf("[ERROR] %s: %s in %s\n", err, path, fcn);
+    exit(-1);
+  }
+}
+
+/// Splits [begin, end) into chunks that start at line beginnings.
+/// @return the n_chunks + 1 chunk boundaries.
+static std::vector<const char*> text_chunks(const char* begin, const char* end, int n_threads) {
+  long length = end - begin;
+  int n_chunks = std::max(1L, std::min(long(4 * n_threads), length / (1 << 16)));
+  std::vector<const char*> bounds(n_chunks + 1);
+  bounds[0] = begin;
+  for(int c = 1; c < n_chunks; ++c) {
+    const char* ptr = std::max(bounds[c - 1], begin + length * c / n_chunks);
+    const char* nl = (const char*) memchr(ptr, '\n', end - ptr);
+    bounds[c] = nl ? nl + 1 : end;
+  }
+  bounds[n_chunks] = end;
+  return bounds;
+}
+
+/// @return 1-based line number of ptr, only used for error messages.
+static long text_line_nb(const char* begin, const char* ptr) {
+  return std::count(begin, ptr, '\n') + 1;
+}
+
+inline const char* skip_blanks(const char* ptr, const char* end) {
+  while(ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r')) {
+    ++ptr;
+  }
+  return ptr;
+}
+
+inline const char* skip_token(const char* ptr, const char* end) {
+  while(ptr < end && *ptr != ' ' && *ptr != '\t' && *ptr != '\r' && *ptr != '\n') {
+    ++ptr;
+  }
+  return ptr;
+}
+
+inline const char* line_end(const char* ptr, const char* end) {
+  const char* nl = (const char*) memchr(ptr, '\n', end - ptr);
+  return nl ? nl : end;
+}
+
+/// Parses a decimal integer at ptr.
+/// @return the position after the number, or 0 if there is no number.
+inline const char* parse_int(const char* ptr, const char* end, int& val) {
+  bool neg = false;
+  if(ptr < end && (*ptr == '-' || *ptr == '+')) {
+    neg = *ptr == '-';
+    ++ptr;
+  }
+  const char* digits = ptr;
+  long v = 0;
+  while(ptr < end && *ptr >= '0' && *ptr <= '9') {
+    v = 10 * v + (*ptr - '0');
+    ++ptr;
+  }
+  if(ptr == digits) {
+    return 0;
+  }
+  val = neg ? -v : v;
+  return ptr;
+}
+
+/// Parses a decimal floating point number with optional exponent at ptr. 
+/// Up to 19 significant digits are accumulated exactly, the result is scaled
+/// by the power of ten in double precision.
+/// @return the position after the number, or 0 if there is no number.
+inline const char* parse_float(const char* ptr, const char* end, float& val) {
+  bool neg = false;
+  if(ptr < end && (*ptr == '-' || *ptr == '+')) {
+    neg = *ptr == '-';
+    ++ptr;
+  }
+  unsigned long long mantissa = 0;
+  int n_digits = 0;
+  int exp10 = 0;
+  bool any = false;
+  while(ptr < end && *ptr >= '0' && *ptr <= '9') {
+    if(n_digits < 19) {
+      mantissa = 10 * mantissa + (*ptr - '0');
+      n_digits += mantissa > 0;
+    }
+    else {
+      exp10++;
+    }
+    any = true;
+    ++ptr;
+  }
+  if(ptr < end && *ptr == '.') {
+    ++ptr;
+    while(ptr < end && *ptr >= '0' && *ptr <= '9') {
+      if(n_digits < 19) {
+        mantissa = 10 * mantissa + (*ptr - '0');
+        n_digits += mantissa > 0;
+        exp10--;
+      }
+      any = true;
+      ++ptr;
+    }
+  }
+  if(!any) {
+    return 0;
+  }
+  if(ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+    int e;
+    const char* after = parse_int(ptr + 1, end, e);
+    if(after) {
+      exp10 += e;
+      ptr = after;
+    }
+  }
+
+  static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 
+      1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  double v = mantissa;
+  while(exp10 > 22) { v *= 1e22; exp10 -= 22; }
+  while(exp10 < -22) { v /= 1e22; exp10 += 22; }
+  v = exp10 >= 0 ? v * pow10[exp10] : v / pow10[-exp10];
+  val = neg ? -v : v;
+  return ptr;
+}
+
+/// Applies the rotation R to all vertices in parallel.
+static void rotate_verts(const float R[9], std::vector<float>& verts) {
+  int n_verts = verts.size() / 3;
+  float* v = verts.data();
+  #pragma omp parallel for
+  for(int idx = 0; idx < n_verts; ++idx) {
+    float x_ = v[idx * 3 + 0];
+    float y_ = v[idx * 3 + 1];
+    float z_ = v[idx * 3 + 2];
+    v[idx * 3 + 0] = R[0] * x_ + R[1] * y_ + R[2] * z_;
+    v[idx * 3 + 1] = R[3] * x_ + R[4] * y_ + R[5] * z_;
+    v[idx * 3 + 2] = R[6] * x_ + R[7] * y_ + R[8] * z_;
+  }
+}
+
+
+
+void mesh_read_off_cpu(const char* path, const float R[9], int n_threads, std::vector<float>& verts, std::vector<int>& faces) {
+  file_mapping m;
+  text_map(path, "mesh_read_off_cpu", m);
+
+  //parse header
+  const char* ptr = m.begin();
+  const char* eol = line_end(ptr, m.end());
+  const char* tok = skip_token(ptr, eol);
+  if(!((tok - ptr == 3 && (strncmp(ptr, "OFF", 3) == 0 || strncmp(ptr, "off", 3) == 0)) && skip_blanks(tok, eol) == eol)) {
+    printf("[ERROR] invalid header in %s\n", path);
+    exit(-1);
+  }
+
+  //parse n vertices, n faces
+  ptr = eol < m.end() ? eol + 1 : m.end();
+  eol = line_end(ptr, m.end());
+  int n_verts, n_faces;
+  ptr = parse_int(skip_blanks(ptr, eol), eol, n_verts);
+  if(ptr) {
+    ptr = parse_int(skip_blanks(ptr, eol), eol, n_faces);
+  }
+  if(!ptr || n_verts < 0 || n_faces < 0) {
+    printf("[ERROR] invalid number of vertices and faces in %s\n", path);
+    exit(-1);
+  }
+  const char* body = eol < m.end() ? eol + 1 : m.end();
+
+  verts.resize(3 * long(n_verts));
+  faces.resize(3 * long(n_faces));
+
+#if defined(_OPENMP)
+  omp_set_num_threads(n_threads);
+#endif
+  // the line index determines if a line is a vertex or a face, hence, count
+  // the lines of every chunk first
+  std::vector<const char*> bounds = text_chunks(body, m.end(), n_threads);
+  int n_chunks = bounds.size() - 1;
+  std::vector<long> chunk_lines(n_chunks + 1, 0);
+  #pragma omp parallel for
+  for(int c = 0; c < n_chunks; ++c) {
+    chunk_lines[c + 1] = std::count(bounds[c], bounds[c + 1], '\n');
+  }
+  for(int c = 0; c < n_chunks; ++c) {
+    chunk_lines[c + 1] += chunk_lines[c];
+  }
+
+  long n_lines = long(n_verts) + n_faces;
+  std::vector<char> chunk_ok(n_chunks, 1);
+  #pragma omp parallel for
+  for(int c = 0; c < n_chunks; ++c) {
+    long line_idx = chunk_lines[c];
+    const char* ptr = bounds[c];
+    while(ptr < bounds[c + 1] && line_idx < n_lines && chunk_ok[c]) {
+      const char* eol = line_end(ptr, bounds[c + 1]);
+      const char* p = skip_blanks(ptr, eol);
+      if(line_idx < n_verts) {
+        float* v = verts.data() + 3 * line_idx;
+        for(int dim = 0; dim < 3 && p; ++dim) {
+          p = parse_float(skip_blanks(p, eol), eol, v[dim]);
+        }
+      }
+      else {
+        int* f = faces.data() + 3 * (line_idx - n_verts);
+        int n_pts = 0;
+        p = parse_int(p, eol, n_pts);
+        if(p && n_pts != 3) {
+          p = 0;
+        }
+        for(int dim = 0; dim < 3 && p; ++dim) {
+          p = parse_int(skip_blanks(p, eol), eol, f[dim]);
+          if(p && (f[dim] < 0 || f[dim] >= n_verts)) {
+            p = 0;
+          }
+        }
+      }
+      if(!p) {
+        chunk_ok[c] = 0;
+        printf("[ERROR] invalid %s on line %ld of %s\n", line_idx < n_verts ? "vertex" : "face", 
+            text_line_nb(m.begin(), ptr), path);
+      }
+      ptr = eol + 1;
+      line_idx++;
+    }
+  }
+  for(int c = 0; c < n_chunks; ++c) {
+    if(!chunk_ok[c]) {
+      exit(-1);
+    }
+  }
+  if(chunk_lines[n_chunks] + (m.end()[-1] != '\n') < n_lines) {
+    printf("[ERROR] %s has less vertices and faces than given in the header\n", path);
+    exit(-1);
+  }
+
+  rotate_verts(R, verts);
+}
+
+
+/// Vertices and faces of a chunk of an OBJ file.
+struct obj_chunk {
+  std::vector<float> verts;
+  std::vector<int> faces;
+  const char* error;
+};
+
+static void parse_obj_chunk(const char* begin, const char* end, obj_chunk& chunk) {
+  chunk.error = 0;
+  const char* ptr = begin;
+  while(ptr < end) {
+    const char* eol = line_end(ptr, end);
+    const char* p = skip_blanks(ptr, eol);
+    const char* tok = skip_token(p, eol);
+    int len = tok - p;
+
+    if(len == 1 && p[0] == 'v') {
+      float v[3];
+      p = tok;
+      for(int dim = 0; dim < 3 && p; ++dim) {
+        p = parse_float(skip_blanks(p, eol), eol, v[dim]);
+      }
+      if(!p || skip_blanks(p, eol) != eol) {
+        chunk.error = ptr;
+        return;
+      }
+      chunk.verts.insert(chunk.verts.end(), v, v + 3);
+    }
+    else if(len == 1 && p[0] == 'f') {
+      int f[3];
+      p = tok;
+      for(int dim = 0; dim < 3 && p; ++dim) {
+        p = parse_int(skip_blanks(p, eol), eol, f[dim]);
+        if(p) {
+          // skip /vt/vn
+          p = skip_token(p, eol);
+          f[dim] -= 1;
+        }
+      }
+      if(!p || skip_blanks(p, eol) != eol) {
+        chunk.error = ptr;
+        return;
+      }
+      chunk.faces.insert(chunk.faces.end(), f, f + 3);
+    }
+    else if(len == 0 || p[0] == '#' ||
+            (len == 1 && (p[0] == 'o' || p[0] == 's' || p[0] == 'g')) ||
+            (len == 2 && (strncmp(p, "vn", 2) == 0 || strncmp(p, "vt", 2) == 0)) ||
+            (len >= 6 && (strncmp(p, "usemtl", 6) == 0 || strncmp(p, "mtllib", 6) == 0))) {
+      // DO NOTHING
+    }
+    else {
+      chunk.error = ptr;
+      return;
+    }
+
+    ptr = eol + 1;
+  }
+}
+
+void mesh_read_obj_cpu(const char* path, const float R[9], int n_threads, std::vector<float>& verts, std::vector<int>& faces) {
+  file_mapping m;
+  text_map(path, "mesh_read_obj_cpu", m);
+
+#if defined(_OPENMP)
+  omp_set_num_threads(n_threads);
+#endif
+  std::vector<const char*> bounds = text_chunks(m.begin(), m.end(), n_threads);
+  int n_chunks = bounds.size() - 1;
+  std::vector<obj_chunk> chunks(n_chunks);
+  #pragma omp parallel for
+  for(int c = 0; c < n_chunks; ++c) {
+    parse_obj_chunk(bounds[c], bounds[c + 1], chunks[c]);
+  }
+
+  // concatenate the chunks, face indices are global in OBJ files
+  std::vector<long> verts_offsets(n_chunks + 1, 0);
+  std::vector<long> faces_offsets(n_chunks + 1, 0);
+  for(int c = 0; c < n_chunks; ++c) {
+    if(chunks[c].error) {
+      printf("[ERROR] invalid line %ld of %s\n", text_line_nb(m.begin(), chunks[c].error), path);
+      exit(-1);
+    }
+    verts_offsets[c + 1] = verts_offsets[c] + chunks[c].verts.size();
+    faces_offsets[c + 1] = faces_offsets[c] + chunks[c].faces.size();
+  }
+  verts.resize(verts_offsets[n_chunks]);
+  faces.resize(faces_offsets[n_chunks]);
+  #pragma omp parallel for
+  for(int c = 0; c < n_chunks; ++c) {
+    std::copy(chunks[c].verts.begin(), chunks[c].verts.end(), verts.begin() + verts_offsets[c]);
+    std::copy(chunks[c].faces.begin(), chunks[c].faces.end(), faces.begin() + faces_offsets[c]);
+  }
+
+  rotate_verts(R, verts);
+}
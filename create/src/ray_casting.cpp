@@ -0,0 +1,140 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "octnet/create/ray_casting.h"
+#include "octnet/cpu/cpu.h"
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+
+static float3 pixel_ray(const float* Pi, int u, int v) {
+  float3 ray;
+  ray.x = Pi[0] * u + Pi[1] * v + Pi[2];
+  ray.y = Pi[4] * u + Pi[5] * v + Pi[6];
+  ray.z = Pi[8] * u + Pi[9] * v + Pi[10];
+  float ray_norm = sqrt( ray.x*ray.x + ray.y*ray.y + ray.z*ray.z );
+  ray.x /= ray_norm;
+  ray.y /= ray_norm;
+  ray.z /= ray_norm;
+  return ray;
+}
+
+extern "C"
+void octree_ray_casting_depth_map_max_cpu(const octree* grid, float3 vx_offset, float3 vx_width, float3 C, const float* Pi, float* im, int im_height, int im_width, int n_threads) {
+#if defined(_OPENMP)
+  omp_set_num_threads(n_threads);
+#endif
+  const int n_pixels = im_height * im_width;
+  #pragma omp parallel for
+  for(int idx = 0; idx < grid->n * n_pixels; ++idx) {
+    const int gn = idx / n_pixels;
+    const int v = (idx % n_pixels) / im_width;
+    const int u = idx % im_width;
+    float3 ray = pixel_ray(Pi, u, v);
+
+    float max_prob = 0;
+    float max_t = -1;
+    octree_ray_casting_traverse_cpu(grid, gn, vx_offset, vx_width, C, ray, 
+        [&](const ot_data_t* data, int, int, int, int, float t) {
+          if(data[0] > max_prob) {
+            max_prob = data[0];
+            max_t = FMAX(t, 0);
+          }
+          return true;
+        });
+    im[idx] = max_t;
+  }
+}
+
+extern "C"
+void octree_ray_casting_depth_map_avg_cpu(const octree* grid, float3 vx_offset, float3 vx_width, float3 C, const float* Pi, float* im, int im_height, int im_width, int n_threads) {
+#if defined(_OPENMP)
+  omp_set_num_threads(n_threads);
+#endif
+  const int n_pixels = im_height * im_width;
+  #pragma omp parallel for
+  for(int idx = 0; idx < grid->n * n_pixels; ++idx) {
+    const int gn = idx / n_pixels;
+    const int v = (idx % n_pixels) / im_width;
+    const int u = idx % im_width;
+    float3 ray = pixel_ray(Pi, u, v);
+
+    float weight_sum = 0;
+    float t_sum = 0;
+    octree_ray_casting_traverse_cpu(grid, gn, vx_offset, vx_width, C, ray, 
+        [&](const ot_data_t* data, int d, int h, int w, int size, float t) {
+          if(data[0] <= 0) {
+            return true;
+          }
+          // length of the ray in the cell
+          const int cell[3] = {w, h, d};
+          float t_exit = 1e9;
+          for(int axis = 0; axis < 3; ++axis) {
+            if(fabs(ray[axis]) >= EPS) {
+              float t1 = (vx_offset[axis] + cell[axis] * vx_width[axis] - C[axis]) / ray[axis];
+              float t2 = (vx_offset[axis] + (cell[axis] + size) * vx_width[axis] - C[axis]) / ray[axis];
+              t_exit = FMIN(t_exit, FMAX(t1, t2));
+            }
+          }
+          float t_enter = FMAX(t, 0);
+          if(t_exit > t_enter) {
+            float weight = data[0] * (t_exit - t_enter);
+            weight_sum += weight;
+            t_sum += weight * 0.5f * (t_enter + t_exit);
+          }
+          return true;
+        });
+
+    im[idx] = weight_sum > 0 ? t_sum / weight_sum : -1;
+  }
+}
+
+extern "C"
+void octree_ray_casting_depth_map_first_cpu(const octree* grid, float3 vx_offset, float3 vx_width, float3 C, const float* Pi, ot_data_t threshold, float* im, int im_height, int im_width, int n_threads) {
+#if defined(_OPENMP)
+  omp_set_num_threads(n_threads);
+#endif
+  const int n_pixels = im_height * im_width;
+  #pragma omp parallel for
+  for(int idx = 0; idx < grid->n * n_pixels; ++idx) {
+    const int gn = idx / n_pixels;
+    const int v = (idx % n_pixels) / im_width;
+    const int u = idx % im_width;
+    float3 ray = pixel_ray(Pi, u, v);
+
+    float first_t = -1;
+    octree_ray_casting_traverse_cpu(grid, gn, vx_offset, vx_width, C, ray, 
+        [&](const ot_data_t* data, int, int, int, int, float t) {
+          if(data[0] >= threshold) {
+            first_t = FMAX(t, 0);
+            return false;
+          }
+          return true;
+        });
+    im[idx] = first_t;
+  }
+}
@@ -26,138 +26,137 @@
 #include "octnet/create/utils.h"
 #include "octnet/cpu/cpu.h"
 
-extern "C"
-void octree_scanline_fill(octree* grid, ot_data_t fill_value) {
-  int* votes = new int[grid->n_leafs];
-  for(int idx = 0; idx < grid->n_leafs; ++idx) {
-    votes[idx] = 0;
+#include <vector>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+/// Run of consecutive voxels of a dense column that lie in the same leaf.
+struct scanline_run {
+  int leaf_idx;
+  int start;
+  int length;
+  bool occupied;
+};
+
+/// Splits the dense column along axis (0: d, 1: h, 2: w) of sample gn at the
+/// fixed coordinates c0, c1 (in d,h,w order without axis) into leaf runs, 
+/// i.e., every leaf is looked up once instead of once per voxel.
+static void scanline_column_runs(const octree* grid, int gn, int axis, int c0, int c1, std::vector<scanline_run>& runs) {
+  int length = 8 * (axis == 0 ? grid->grid_depth : (axis == 1 ? grid->grid_height : grid->grid_width));
+  runs.clear();
+  for(int pos = 0; pos < length; ) {
+    int d = axis == 0 ? pos : c0;
+    int h = axis == 0 ? c0 : (axis == 1 ? pos : c1);
+    int w = axis == 2 ? pos : c1;
+    int grid_idx = octree_grid_idx(grid, gn, d / 8, h / 8, w / 8);
+    const ot_tree_t* tree = octree_get_tree(grid, grid_idx);
+    int bit_idx = tree_bit_idx(tree, d % 8, h % 8, w % 8);
+    int cell_width = width_from_depth(depth_from_bit_idx(bit_idx));
+
+    scanline_run run;
+    run.leaf_idx = grid->prefix_leafs[grid_idx] + tree_data_idx(tree, bit_idx, 1);
+    run.start = pos;
+    run.length = cell_width - (pos % 8) % cell_width;
+    run.occupied = grid->data[run.leaf_idx * grid->feature_size] != 0;
+    runs.push_back(run);
+    pos += run.length;
   }
+}
 
+extern "C"
+void octree_scanline_fill(octree* grid, ot_data_t fill_value) {
   int dense_depth = 8 * grid->grid_depth;
   int dense_height = 8 * grid->grid_height;
   int dense_width = 8 * grid->grid_width;
 
-  //collect votes
-  for(int gn = 0; gn < grid->n; ++gn) {
-    //along w
-    for(int idx = 0; idx < dense_depth * dense_height; ++idx) {
-      int d = idx / dense_height;
-      int h = idx % dense_height;
-      int gd = d / 8;
-      int bd = d % 8;
-      int gh = h / 8;
-      int bh = h % 8;
-      int min = dense_width; int max = 0;
-      for(int w = 0; w < dense_width; ++w) {
-        int gw = w / 8;
-        int bw = w % 8;
-        int grid_idx = octree_grid_idx(grid, gn, gd, gh, gw);
-        const ot_tree_t* tree = octree_get_tree(grid, grid_idx);
-        int bit_idx = tree_bit_idx(tree, bd, bh, bw);
-        int data_idx = grid->prefix_leafs[grid_idx] + tree_data_idx(tree, bit_idx, 1); 
-        ot_data_t* data = grid->data + data_idx * grid->feature_size;
-        if(data[0] != 0) {
-          min = IMIN(min, w);
-          max = IMAX(max, w);
-        }
-      }
-      for(int w = min; w <= max; ++w) {
-        int gw = w / 8;
-        int bw = w % 8;
-        int grid_idx = octree_grid_idx(grid, gn, gd, gh, gw);
-        const ot_tree_t* tree = octree_get_tree(grid, grid_idx);
-        int bit_idx = tree_bit_idx(tree, bd, bh, bw);
-        int data_idx = grid->prefix_leafs[grid_idx] + tree_data_idx(tree, bit_idx, 1); 
-        votes[data_idx] += 1;
+  // columns of all samples along w, h, and d
+  long n_cols_w = long(grid->n) * dense_depth * dense_height;
+  long n_cols_h = long(grid->n) * dense_depth * dense_width;
+  long n_cols_d = long(grid->n) * dense_height * dense_width;
+  long n_cols = n_cols_w + n_cols_h + n_cols_d;
+
+  //collect votes in thread-local arrays, every voxel between the first and
+  //the last occupied voxel of a column votes for its leaf
+  std::vector<std::vector<int> > thread_votes;
+  #pragma omp parallel
+  {
+#if defined(_OPENMP)
+    int n_threads = omp_get_num_threads();
+    int thread_idx = omp_get_thread_num();
+#else
+    int n_threads = 1;
+    int thread_idx = 0;
+#endif
+    #pragma omp single
+    thread_votes.resize(n_threads);
+    std::vector<int>& votes = thread_votes[thread_idx];
+    votes.assign(grid->n_leafs, 0);
+    std::vector<scanline_run> runs;
+
+    #pragma omp for schedule(dynamic, 64)
+    for(long col = 0; col < n_cols; ++col) {
+      int axis, c0, c1, gn;
+      if(col < n_cols_w) {
+        axis = 2;
+        gn = col / (dense_depth * dense_height);
+        c0 = (col / dense_height) % dense_depth;
+        c1 = col % dense_height;
       }
-    }
-
-    //along h
-    for(int idx = 0; idx < dense_depth * dense_width; ++idx) {
-      int d = idx / dense_width;
-      int w = idx % dense_width;
-      int gd = d / 8;
-      int bd = d % 8;
-      int gw = w / 8;
-      int bw = w % 8;
-      int min = dense_width; int max = 0;
-      for(int h = 0; h < dense_height; ++h) {
-        int gh = h / 8;
-        int bh = h % 8;
-        int grid_idx = octree_grid_idx(grid, gn, gd, gh, gw);
-        const ot_tree_t* tree = octree_get_tree(grid, grid_idx);
-        int bit_idx = tree_bit_idx(tree, bd, bh, bw);
-        int data_idx = grid->prefix_leafs[grid_idx] + tree_data_idx(tree, bit_idx, 1); 
-        ot_data_t* data = grid->data + data_idx * grid->feature_size;
-        if(data[0] != 0) {
-          min = IMIN(min, h);
-          max = IMAX(max, h);
-        }
+      else if(col < n_cols_w + n_cols_h) {
+        long idx = col - n_cols_w;
+        axis = 1;
+        gn = idx / (dense_depth * dense_width);
+        c0 = (idx / dense_width) % dense_depth;
+        c1 = idx % dense_width;
       }
-      for(int h = min; h <= max; ++h) {
-        int gh = h / 8;
-        int bh = h % 8;
-        int grid_idx = octree_grid_idx(grid, gn, gd, gh, gw);
-        const ot_tree_t* tree = octree_get_tree(grid, grid_idx);
-        int bit_idx = tree_bit_idx(tree, bd, bh, bw);
-        int data_idx = grid->prefix_leafs[grid_idx] + tree_data_idx(tree, bit_idx, 1); 
-        votes[data_idx] += 1;
+      else {
+        long idx = col - n_cols_w - n_cols_h;
+        axis = 0;
+        gn = idx / (dense_height * dense_width);
+        c0 = (idx / dense_width) % dense_height;
+        c1 = idx % dense_width;
       }
-    }
 
-    //along d
-    for(int idx = 0; idx < dense_height * dense_width; ++idx) {
-      int h = idx / dense_height;
-      int w = idx % dense_width;
-      int gh = h / 8;
-      int bh = h % 8;
-      int gw = w / 8;
-      int bw = w % 8;
-      int min = dense_width; int max = 0;
-      for(int d = 0; d < dense_depth; ++d) {
-        int gd = d / 8;
-        int bd = d % 8;
-        int grid_idx = octree_grid_idx(grid, gn, gd, gh, gw);
-        const ot_tree_t* tree = octree_get_tree(grid, grid_idx);
-        int bit_idx = tree_bit_idx(tree, bd, bh, bw);
-        int data_idx = grid->prefix_leafs[grid_idx] + tree_data_idx(tree, bit_idx, 1); 
-        ot_data_t* data = grid->data + data_idx * grid->feature_size;
-        if(data[0] != 0) {
-          min = IMIN(min, d);
-          max = IMAX(max, d);
+      scanline_column_runs(grid, gn, axis, c0, c1, runs);
+
+      int first = -1;
+      int last = -1;
+      for(size_t ridx = 0; ridx < runs.size(); ++ridx) {
+        if(runs[ridx].occupied) {
+          first = first < 0 ? ridx : first;
+          last = ridx;
         }
       }
-      for(int d = min; d <= max; ++d) {
-        int gd = d / 8;
-        int bd = d % 8;
-        int grid_idx = octree_grid_idx(grid, gn, gd, gh, gw);
-        const ot_tree_t* tree = octree_get_tree(grid, grid_idx);
-        int bit_idx = tree_bit_idx(tree, bd, bh, bw);
-        int data_idx = grid->prefix_leafs[grid_idx] + tree_data_idx(tree, bit_idx, 1); 
-        votes[data_idx] += 1;
+      for(int ridx = first; ridx >= 0 && ridx <= last; ++ridx) {
+        votes[runs[ridx].leaf_idx] += runs[ridx].length;
       }
-    } 
+    }
   }
 
   //apply majority vote
-  for(int leaf_idx = 0; leaf_idx < grid->n_leafs; ++leaf_idx) {
-    int grid_idx = leaf_idx_to_grid_idx(grid, leaf_idx);
+  int n_blocks = octree_num_blocks(grid);
+  #pragma omp parallel for
+  for(int grid_idx = 0; grid_idx < n_blocks; ++grid_idx) {
     const ot_tree_t* tree = octree_get_tree(grid, grid_idx);
-
-    int cum_n_leafs = grid->prefix_leafs[grid_idx];
-    int data_idx = leaf_idx - cum_n_leafs;
-    int bit_idx = data_idx_to_bit_idx(tree, data_idx);
-
-    int depth = depth_from_bit_idx(bit_idx);
-    int vol = depth == 0 ? 512 : (depth == 1 ? 64 : (depth == 2 ? 8 : 1));
-
-    float vote = votes[leaf_idx] / float(vol);
-    if(vote >= 2.0) {
-      grid->data[leaf_idx * grid->feature_size] = fill_value;
+    int n_leafs = tree_n_leafs(tree);
+    for(int data_idx = 0; data_idx < n_leafs; ++data_idx) {
+      int leaf_idx = grid->prefix_leafs[grid_idx] + data_idx;
+      int bit_idx = data_idx_to_bit_idx(tree, data_idx);
+      int cell_width = width_from_depth(depth_from_bit_idx(bit_idx));
+      int vol = cell_width * cell_width * cell_width;
+
+      int votes = 0;
+      for(size_t tidx = 0; tidx < thread_votes.size(); ++tidx) {
+        votes += thread_votes[tidx][leaf_idx];
+      }
+      float vote = votes / float(vol);
+      if(vote >= 2.0) {
+        grid->data[leaf_idx * grid->feature_size] = fill_value;
+      }
     }
-  } 
-
-  delete[] votes;
+  }
 }
 
 
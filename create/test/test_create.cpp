@@ -25,10 +25,27 @@
 
 #include "octnet/cpu/cpu.h"
 #include "octnet/cpu/io.h"
+#include "octnet/cpu/dense.h"
+#include "octnet/cpu/combine.h"
 #include "octnet/create/create.h"
+#include "octnet/create/cache.h"
+#include "octnet/create/create_static.h"
+#include "octnet/create/create_from_mesh.h"
+#include "octnet/create/mesh_io.h"
+#include "octnet/create/slab.h"
+#include "octnet/create/ray_casting.h"
+#include "octnet/create/utils.h"
+#include "octnet/geometry/geometry.h"
+#include "octnet/geometry/geometry_sse.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <iostream>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
 
 void test_dense_features() {
   const int depth = 2;
@@ -60,7 +77,1024 @@ void test_dense_features() {
   octree_print_cpu(o);
 }
 
+void test_dense_occupancy(bool pack) {
+  std::cout << "[INFO] test_dense_occupancy " << pack << std::endl;
+  const int depth = 19;
+  const int height = 24;
+  const int width = 32;
+  const int channels = 2;
+  const int n_vx = depth*height*width;
+  const ot_data_t tr_dist = 0.5;
+
+  // sdf like features with a few filled blobs
+  ot_data_t* data = new ot_data_t[n_vx*channels];
+  ot_data_t* occ = new ot_data_t[n_vx];
+  for(int d = 0; d < depth; ++d) {
+    for(int h = 0; h < height; ++h) {
+      for(int w = 0; w < width; ++w) {
+        int vx_idx = (d*height + h)*width + w;
+        bool oc = (d/4 + h/3 + w/5) % 4 == 0 || rand() % 20 == 0;
+        occ[vx_idx] = oc ? 1 : 0;
+        data[vx_idx*channels + 0] = oc ? 0.1 : 2;
+        data[vx_idx*channels + 1] = 1 + float(rand()) / RAND_MAX;
+      }
+    }
+  }
+
+  ot_data_t ranges[] = {0.5, 1.5};
+  octree* grid = octree_create_from_dense_cpu(occ, depth, height, width, 1, ranges, false, 0, pack, 4);
+  // the octree grid is padded to a multiple of 8 in depth
+  const int grid_depth = 24;
+  ot_data_t* dense = new ot_data_t[grid_depth*height*width*channels];
+  octree_to_dhwc_cpu(grid, grid_depth, height, width, dense);
+  for(int idx = 0; idx < n_vx; ++idx) {
+    if(dense[idx] != occ[idx]) {
+      printf("[ERROR] dense occupancy differs at %d: %f, %f\n", idx, dense[idx], occ[idx]);
+      exit(-1);
+    }
+  }
+  octree_free_cpu(grid);
+
+  grid = octree_create_from_dense_features_cpu(data, depth, height, width, channels, tr_dist, false, 0, pack, 4);
+  octree_to_dhwc_cpu(grid, grid_depth, height, width, dense);
+  for(int idx = 0; idx < n_vx*channels; ++idx) {
+    // a packed cell holds the features of its first voxel
+    int vx_idx = idx / channels;
+    int d = vx_idx / (height*width);
+    int h = (vx_idx / width) % height;
+    int w = vx_idx % width;
+    const ot_tree_t* tree = octree_get_tree(grid, octree_grid_idx(grid, 0, d/8, h/8, w/8));
+    int size = width_from_bit_idx(tree_bit_idx(tree, d%8, h%8, w%8));
+    int cell_vx_idx = ((d/size*size)*height + h/size*size)*width + w/size*size;
+    ot_data_t expected = occ[vx_idx] ? data[cell_vx_idx*channels + idx % channels] : 0;
+    if(dense[idx] != expected) {
+      printf("[ERROR] dense features differ at %d: %f, %f\n", idx, dense[idx], expected);
+      exit(-1);
+    }
+  }
+  octree_free_cpu(grid);
+
+  delete[] data;
+  delete[] occ;
+  delete[] dense;
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_pack_homogeneous() {
+  std::cout << "[INFO] test_pack_homogeneous" << std::endl;
+  const int depth = 16;
+  const int height = 16;
+  const int width = 8;
+  const int fs = 2;
+  const int n_vx = depth*height*width;
+
+  // partial occupancy splits the blocks, but the features are constant
+  ot_data_t* occ = new ot_data_t[n_vx];
+  ot_data_t* features = new ot_data_t[n_vx*fs];
+  for(int idx = 0; idx < n_vx; ++idx) {
+    occ[idx] = rand() % 3 == 0;
+    features[idx] = 0.5;
+    features[n_vx + idx] = -2;
+  }
+
+  octree* grid = octree_create_from_dense2_cpu(occ, features, fs, depth, height, width, false, 0, false, 4);
+  octree* packed = octree_create_from_dense2_cpu(occ, features, fs, depth, height, width, false, 0, true, 4);
+  if(grid->n_leafs == octree_num_blocks(grid)) {
+    printf("[ERROR] unpacked octree should be split\n");
+    exit(-1);
+  }
+  if(packed->n_leafs != octree_num_blocks(packed)) {
+    printf("[ERROR] pack did not merge homogeneous subtrees (%d leafs)\n", packed->n_leafs);
+    exit(-1);
+  }
+
+  ot_data_t* dense = new ot_data_t[n_vx*fs];
+  ot_data_t* dense_packed = new ot_data_t[n_vx*fs];
+  octree_to_cdhw_cpu(grid, depth, height, width, dense);
+  octree_to_cdhw_cpu(packed, depth, height, width, dense_packed);
+  for(int idx = 0; idx < n_vx*fs; ++idx) {
+    if(dense[idx] != dense_packed[idx]) {
+      printf("[ERROR] packed octree differs at %d: %f, %f\n", idx, dense[idx], dense_packed[idx]);
+      exit(-1);
+    }
+  }
+
+  octree_free_cpu(grid);
+  octree_free_cpu(packed);
+  delete[] occ;
+  delete[] features;
+  delete[] dense;
+  delete[] dense_packed;
+  std::cout << "[DONE]" << std::endl;
+}
+
+void remove_cache_dir(const char* dir) {
+  DIR* dp = opendir(dir);
+  if(dp == 0) {
+    return;
+  }
+  struct dirent* entry;
+  while((entry = readdir(dp)) != 0) {
+    if(strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+      std::string path = std::string(dir) + "/" + entry->d_name;
+      remove(path.c_str());
+    }
+  }
+  closedir(dp);
+  rmdir(dir);
+}
+
+void test_cache() {
+  std::cout << "[INFO] test_cache" << std::endl;
+  const int n = 3;
+  const int depth = 16;
+  const int height = 16;
+  const int width = 16;
+  const int channels = 2;
+  const int offset = depth*height*width*channels;
+  const ot_data_t tr_dist = 0.5;
+
+  ot_data_t* data = new ot_data_t[n * offset];
+  char** paths = new char*[n];
+  for(int idx = 0; idx < n * offset; ++idx) {
+    data[idx] = 4.f * rand() / RAND_MAX;
+  }
+  for(int idx = 0; idx < n; ++idx) {
+    paths[idx] = new char[32];
+    snprintf(paths[idx], 32, "test_cache_%d.dense", idx);
+    int dims[] = {1, depth, height, width, channels};
+    dense_write_cpu(paths[idx], 5, dims, data + idx * offset);
+  }
+
+  octree* gt = octree_create_from_dense_features_batch_cpu(data, n, depth, height, width, channels, tr_dist, false, 0, false, 4);
+
+  remove_cache_dir("test_cache_dir");
+  OctreeCacheCpu* cache = octree_cache_new_cpu(1 << 30, "test_cache_dir");
+  for(int epoch = 0; epoch < 2; ++epoch) {
+    octree* grid = octree_create_from_dense_features_batch_cached_cpu(cache, n, paths, epoch == 0 ? data : 0, depth, height, width, channels, tr_dist, false, 0, false, 4);
+    if(!octree_equal_cpu(gt, grid)) {
+      printf("[ERROR] cached octree differs in epoch %d\n", epoch);
+      exit(-1);
+    }
+    octree_free_cpu(grid);
+  }
+  long n_hits, n_misses, n_bytes;
+  octree_cache_stats_cpu(cache, &n_hits, &n_misses, &n_bytes);
+  if(n_hits != n || n_misses != n) {
+    printf("[ERROR] expected %d hits/misses, got %ld/%ld\n", n, n_hits, n_misses);
+    exit(-1);
+  }
+  octree_cache_free_cpu(cache);
+
+  // a new cache with no memory budget has to read the disk level
+  cache = octree_cache_new_cpu(0, "test_cache_dir");
+  octree* grid = octree_create_from_dense_features_batch_cached_cpu(cache, n, paths, 0, depth, height, width, channels, tr_dist, false, 0, false, 4);
+  octree_cache_stats_cpu(cache, &n_hits, &n_misses, &n_bytes);
+  if(!octree_equal_cpu(gt, grid) || n_hits != n || n_bytes != 0) {
+    printf("[ERROR] disk cache failed\n");
+    exit(-1);
+  }
+  octree_free_cpu(grid);
+  octree_cache_free_cpu(cache);
+  remove_cache_dir("test_cache_dir");
+
+  // a cache dir that can not be created falls back to the memory level
+  char bad_dir[64];
+  snprintf(bad_dir, sizeof(bad_dir), "%s/cache", paths[0]);
+  cache = octree_cache_new_cpu(1 << 30, bad_dir);
+  for(int epoch = 0; epoch < 2; ++epoch) {
+    grid = octree_create_from_dense_features_batch_cached_cpu(cache, n, paths, data, depth, height, width, channels, tr_dist, false, 0, false, 4);
+    if(!octree_equal_cpu(gt, grid)) {
+      printf("[ERROR] memory only cache failed\n");
+      exit(-1);
+    }
+    octree_free_cpu(grid);
+  }
+  octree_cache_stats_cpu(cache, &n_hits, &n_misses, &n_bytes);
+  if(n_hits != n || n_misses != n) {
+    printf("[ERROR] memory only cache expected %d hits/misses, got %ld/%ld\n", n, n_hits, n_misses);
+    exit(-1);
+  }
+  octree_cache_free_cpu(cache);
+
+  octree_free_cpu(gt);
+  for(int idx = 0; idx < n; ++idx) {
+    remove(paths[idx]);
+    delete[] paths[idx];
+  }
+  delete[] paths;
+  delete[] data;
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_mesh() {
+  std::cout << "[INFO] test_mesh" << std::endl;
+  const int depth = 24;
+  const int height = 32;
+  const int width = 40;
+  const int n_faces = 200;
+
+  // random small triangles, some of them outside of the grid and some with
+  // vertices on block boundaries
+  float* verts = new float[n_faces * 9];
+  int* faces = new int[n_faces * 3];
+  for(int fidx = 0; fidx < n_faces; ++fidx) {
+    float cx = (width + 8) * float(rand()) / RAND_MAX - 4;
+    float cy = (height + 8) * float(rand()) / RAND_MAX - 4;
+    float cz = (depth + 8) * float(rand()) / RAND_MAX - 4;
+    if(fidx % 10 == 0) {
+      cx = 8 * int(cx / 8); cy = 8 * int(cy / 8); cz = 8 * int(cz / 8);
+    }
+    for(int vidx = 0; vidx < 3; ++vidx) {
+      verts[(fidx * 3 + vidx) * 3 + 0] = cx + (vidx == 0 ? 0 : 6 * float(rand()) / RAND_MAX - 3);
+      verts[(fidx * 3 + vidx) * 3 + 1] = cy + (vidx == 0 ? 0 : 6 * float(rand()) / RAND_MAX - 3);
+      verts[(fidx * 3 + vidx) * 3 + 2] = cz + (vidx == 0 ? 0 : 6 * float(rand()) / RAND_MAX - 3);
+      faces[fidx * 3 + vidx] = fidx * 3 + vidx;
+    }
+  }
+
+  octree* grid = octree_create_from_mesh_cpu(n_faces * 3, verts, n_faces, faces, false, depth, height, width, false, 0, false, 0, 4);
+
+  // a block is split iff any triangle intersects it
+  for(int gd = 0; gd < depth / 8; ++gd) {
+    for(int gh = 0; gh < height / 8; ++gh) {
+      for(int gw = 0; gw < width / 8; ++gw) {
+        float3 vx_c; vx_c.x = gw * 8 + 4; vx_c.y = gh * 8 + 4; vx_c.z = gd * 8 + 4;
+        float3 vx_w; vx_w.x = 8; vx_w.y = 8; vx_w.z = 8;
+        bool inter = false;
+        for(int fidx = 0; fidx < n_faces && !inter; ++fidx) {
+          float3 v[3];
+          for(int vidx = 0; vidx < 3; ++vidx) {
+            v[vidx].x = verts[(fidx * 3 + vidx) * 3 + 0];
+            v[vidx].y = verts[(fidx * 3 + vidx) * 3 + 1];
+            v[vidx].z = verts[(fidx * 3 + vidx) * 3 + 2];
+          }
+          inter = intersection_triangle_voxel(vx_c, vx_w, v[0], v[1], v[2]);
+        }
+        int grid_idx = octree_grid_idx(grid, 0, gd, gh, gw);
+        if(inter != tree_isset_bit(octree_get_tree(grid, grid_idx), 0)) {
+          printf("[ERROR] block %d,%d,%d: intersection %d differs from octree\n", gd, gh, gw, int(inter));
+          exit(-1);
+        }
+      }
+    }
+  }
+
+  octree_free_cpu(grid);
+  delete[] verts;
+  delete[] faces;
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_triangle_voxel_sse() {
+  std::cout << "[INFO] test_triangle_voxel_sse" << std::endl;
+  int n_hits = 0;
+  for(int iter = 0; iter < 20000; ++iter) {
+    float3 vx_c;
+    vx_c.x = float(rand() % 8) + 0.5;
+    vx_c.y = float(rand() % 8) + 0.5;
+    vx_c.z = float(rand() % 8) + 0.5;
+    float3 vx_w;
+    vx_w.x = vx_w.y = vx_w.z = 1 << (rand() % 4);
+
+    float packet[TRIANGLE_PACKET_SIZE];
+    float3 tris[4][3];
+    for(int lane = 0; lane < 4; ++lane) {
+      for(int vidx = 0; vidx < 3; ++vidx) {
+        // mix of random and grid aligned vertices to hit the boundary cases
+        for(int dim = 0; dim < 3; ++dim) {
+          tris[lane][vidx][dim] = rand() % 2 ? 10.f * rand() / RAND_MAX - 1 : float(rand() % 10) - 1;
+        }
+      }
+      triangle_packet_set(packet, lane, &tris[lane][0].x, &tris[lane][1].x, &tris[lane][2].x);
+    }
+
+    int mask = intersection_triangles_voxel_sse(vx_c, vx_w, packet);
+    for(int lane = 0; lane < 4; ++lane) {
+      bool gt = intersection_triangle_voxel(vx_c, vx_w, tris[lane][0], tris[lane][1], tris[lane][2]);
+      if(gt != bool(mask & (1 << lane))) {
+        printf("[ERROR] sse triangle voxel intersection differs in iter %d, lane %d\n", iter, lane);
+        exit(-1);
+      }
+      n_hits += gt;
+    }
+  }
+  if(n_hits == 0) {
+    printf("[ERROR] no triangle voxel intersections in test\n");
+    exit(-1);
+  }
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_pc_morton(bool pack) {
+  std::cout << "[INFO] test_pc_morton " << pack << std::endl;
+  const int depth = 24;
+  const int height = 32;
+  const int width = 16;
+  const int n_pts = 3000;
+  const int feature_size = 2;
+
+  // clustered points, kept away from voxel boundaries where the Morton 
+  // variant assigns points to one voxel only
+  float* xyz = new float[n_pts * 3];
+  float* features = new float[n_pts * feature_size];
+  for(int idx = 0; idx < n_pts; ++idx) {
+    int cluster = idx / 500;
+    xyz[idx * 3 + 0] = (cluster * 5 + rand() % 6) % (width + 2) - 1 + 0.1 + 0.8 * float(rand()) / RAND_MAX;
+    xyz[idx * 3 + 1] = (cluster * 7 + rand() % 6) % height + 0.1 + 0.8 * float(rand()) / RAND_MAX;
+    xyz[idx * 3 + 2] = (cluster * 3 + rand() % 6) % depth + 0.1 + 0.8 * float(rand()) / RAND_MAX;
+    for(int f = 0; f < feature_size; ++f) {
+      features[idx * feature_size + f] = float(rand()) / RAND_MAX;
+    }
+  }
+
+  octree* gt = octree_create_from_pc_cpu(xyz, features, n_pts, feature_size, depth, height, width, false, false, false, 0, pack, 0, 4);
+  octree* grid = octree_create_from_pc_morton_cpu(xyz, features, n_pts, feature_size, depth, height, width, false, false, false, 0, pack, 0, 4);
+  if(!octree_equal_trees_cpu(gt, grid) || gt->n_leafs != grid->n_leafs) {
+    printf("[ERROR] morton octree structure differs\n");
+    exit(-1);
+  }
+  for(int idx = 0; idx < gt->n_leafs * feature_size; ++idx) {
+    if(fabs(gt->data[idx] - grid->data[idx]) > 1e-5) {
+      printf("[ERROR] morton octree data differs at %d: %f, %f\n", idx, gt->data[idx], grid->data[idx]);
+      exit(-1);
+    }
+  }
+  octree_free_cpu(grid);
+  octree_free_cpu(gt);
+
+  gt = octree_create_from_pc_simple_cpu(xyz, n_pts, 1, depth, height, width, false, false, false, 0, pack, 0, 4);
+  grid = octree_create_from_pc_morton_cpu(xyz, 0, n_pts, 1, depth, height, width, false, false, false, 0, pack, 0, 1);
+  if(!octree_equal_cpu(gt, grid)) {
+    printf("[ERROR] morton occupancy octree differs\n");
+    exit(-1);
+  }
+  octree_free_cpu(grid);
+  octree_free_cpu(gt);
+
+  delete[] xyz;
+  delete[] features;
+  std::cout << "[DONE]" << std::endl;
+}
+
+void check_bottom_up(const char* name, octree* gt, octree* grid) {
+  if(!octree_equal_cpu(gt, grid)) {
+    printf("[ERROR] bottom-up octree differs from top-down for %s\n", name);
+    exit(-1);
+  }
+  octree_free_cpu(gt);
+  octree_free_cpu(grid);
+}
+
+void test_bottom_up(bool fit, bool pack) {
+  std::cout << "[INFO] test_bottom_up " << fit << ", " << pack << std::endl;
+  const int depth = 32;
+  const int height = 24;
+  const int width = 40;
+  const int n_vx = depth*height*width;
+  const int channels = 2;
+
+  ot_data_t* data = new ot_data_t[n_vx*channels];
+  ot_data_t* occ = new ot_data_t[n_vx];
+  for(int d = 0; d < depth; ++d) {
+    for(int h = 0; h < height; ++h) {
+      for(int w = 0; w < width; ++w) {
+        int vx_idx = (d*height + h)*width + w;
+        bool oc = (d > 8 && d < 20 && h > 2 && h < 18 && w > 4 && w < 14) || (!fit && rand() % 50 == 0);
+        occ[vx_idx] = oc ? 1 : 0;
+        data[vx_idx*channels + 0] = oc ? 0.1 : 2;
+        data[vx_idx*channels + 1] = 1 + float(rand()) / RAND_MAX;
+      }
+    }
+  }
+  ot_data_t ranges[] = {0.5, 1.5};
+  check_bottom_up("dense", 
+      octree_create_from_dense_cpu(occ, depth, height, width, 1, ranges, fit, 1, pack, 4),
+      octree_create_from_dense_bottom_up_cpu(occ, depth, height, width, 1, ranges, fit, 1, pack, 4));
+  check_bottom_up("dense_features", 
+      octree_create_from_dense_features_cpu(data, depth, height, width, channels, 0.5, fit, 1, pack, 4),
+      octree_create_from_dense_features_bottom_up_cpu(data, depth, height, width, channels, 0.5, fit, 1, pack, 4));
+
+  const int n_pts = 2000;
+  float* xyz = new float[n_pts * 3];
+  for(int idx = 0; idx < n_pts; ++idx) {
+    xyz[idx * 3 + 0] = 10 + rand() % 8 + 0.1 + 0.8 * float(rand()) / RAND_MAX;
+    xyz[idx * 3 + 1] = 3 + rand() % 12 + 0.1 + 0.8 * float(rand()) / RAND_MAX;
+    xyz[idx * 3 + 2] = rand() % depth + 0.1 + 0.8 * float(rand()) / RAND_MAX;
+  }
+  check_bottom_up("pc", 
+      octree_create_from_pc_morton_cpu(xyz, data, n_pts, channels, depth, height, width, false, false, fit, 1, pack, 0, 4),
+      octree_create_from_pc_bottom_up_cpu(xyz, data, n_pts, channels, depth, height, width, false, false, fit, 1, pack, 0, 4));
+
+  // a box as triangle mesh
+  float verts[] = {10.5,4.5,6.5, 30.5,4.5,6.5, 10.5,20.5,6.5, 30.5,20.5,6.5, 
+                   10.5,4.5,26.5, 30.5,4.5,26.5, 10.5,20.5,26.5, 30.5,20.5,26.5};
+  int faces[] = {0,1,2, 1,3,2, 4,6,5, 5,6,7, 0,4,1, 1,4,5, 2,3,6, 3,7,6, 0,2,4, 2,6,4, 1,5,3, 3,5,7};
+  check_bottom_up("mesh", 
+      octree_create_from_mesh_cpu(8, verts, 12, faces, false, depth, height, width, fit, 1, pack, 0, 4),
+      octree_create_from_mesh_bottom_up_cpu(8, verts, 12, faces, false, depth, height, width, fit, 1, pack, 0, 4));
+
+  delete[] xyz;
+  delete[] data;
+  delete[] occ;
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_static(bool pack) {
+  std::cout << "[INFO] test_static " << pack << std::endl;
+  const int depth = 32;
+  const int height = 24;
+  const int width = 40;
+
+  float verts[] = {10.5,4.5,6.5, 30.5,4.5,6.5, 10.5,20.5,6.5, 30.5,20.5,6.5, 
+                   10.5,4.5,26.5, 30.5,4.5,26.5, 10.5,20.5,26.5, 30.5,20.5,26.5};
+  int faces[] = {0,1,2, 1,3,2, 4,6,5, 5,6,7, 0,4,1, 1,4,5, 2,3,6, 3,7,6, 0,2,4, 2,6,4, 1,5,3, 3,5,7};
+
+  // virtual dispatch through the OctreeCreateCpu interface
+  OctreeFromMesh create_virtual(8, verts, 12, faces, false, depth, height, width, 0);
+  OctreeCreateCpu& create_base = create_virtual;
+  octree* gt = create_base(false, 1, pack, 4);
+
+  OctreeCreateStaticCpu<OctreeFromMesh> create_static(8, verts, 12, faces, false, depth, height, width, 0);
+  octree* grid = create_static(false, 1, pack, 4);
+
+  if(!octree_equal_cpu(gt, grid)) {
+    printf("[ERROR] statically dispatched octree differs from virtual one\n");
+    exit(-1);
+  }
+  octree_free_cpu(gt);
+  octree_free_cpu(grid);
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_batch(bool fit, bool pack, int n_threads) {
+  std::cout << "[INFO] test_batch " << fit << ", " << pack << ", " << n_threads << std::endl;
+  const int batch_size = 3;
+  const int depth = 32;
+  const int height = 24;
+  const int width = 40;
+  const int n_vx = depth*height*width;
+  const int channels = 2;
+
+  ot_data_t* data = new ot_data_t[batch_size*n_vx*channels];
+  ot_data_t* occ = new ot_data_t[batch_size*n_vx];
+  for(int n = 0; n < batch_size; ++n) {
+    for(int d = 0; d < depth; ++d) {
+      for(int h = 0; h < height; ++h) {
+        for(int w = 0; w < width; ++w) {
+          int vx_idx = ((n*depth + d)*height + h)*width + w;
+          // fitted grids have to match, the blob is shifted within a block
+          bool oc = (d > 8+n && d < 20 && h > 2 && h < 18 && w > 4 && w < 14) || (!fit && rand() % 50 == 0);
+          occ[vx_idx] = oc ? 1 : 0;
+          data[vx_idx*channels + 0] = oc ? 0.1 : 2;
+          data[vx_idx*channels + 1] = 1 + float(rand()) / RAND_MAX;
+        }
+      }
+    }
+  }
+
+  ot_data_t ranges[] = {0.5, 1.5};
+  octree* octrees[batch_size];
+  for(int n = 0; n < batch_size; ++n) {
+    octrees[n] = octree_create_from_dense_cpu(occ + n*n_vx, depth, height, width, 1, ranges, fit, 1, pack, 4);
+  }
+  octree* gt = octree_new_cpu();
+  octree_combine_n_cpu(octrees, batch_size, gt);
+  octree* grid = octree_create_from_dense_batch_cpu(occ, batch_size, depth, height, width, 1, ranges, fit, 1, pack, n_threads);
+  if(!octree_equal_cpu(gt, grid)) {
+    printf("[ERROR] batch octree differs from combined octrees for dense\n");
+    exit(-1);
+  }
+  for(int n = 0; n < batch_size; ++n) {
+    octree_free_cpu(octrees[n]);
+  }
+  octree_free_cpu(gt);
+  octree_free_cpu(grid);
+
+  for(int n = 0; n < batch_size; ++n) {
+    octrees[n] = octree_create_from_dense_features_cpu(data + n*n_vx*channels, depth, height, width, channels, 0.5, fit, 1, pack, 4);
+  }
+  gt = octree_new_cpu();
+  octree_combine_n_cpu(octrees, batch_size, gt);
+  grid = octree_create_from_dense_features_batch_cpu(data, batch_size, depth, height, width, channels, 0.5, fit, 1, pack, n_threads);
+  if(!octree_equal_cpu(gt, grid)) {
+    printf("[ERROR] batch octree differs from combined octrees for dense_features\n");
+    exit(-1);
+  }
+  for(int n = 0; n < batch_size; ++n) {
+    octree_free_cpu(octrees[n]);
+  }
+  octree_free_cpu(gt);
+  octree_free_cpu(grid);
+
+  delete[] data;
+  delete[] occ;
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_mesh_io(int n_threads) {
+  std::cout << "[INFO] test_mesh_io " << n_threads << std::endl;
+  // enough lines for several chunks
+  const int n_verts = 30000;
+  const int n_faces = 20000;
+  std::vector<float> verts(3 * n_verts);
+  std::vector<int> faces(3 * n_faces);
+  for(int idx = 0; idx < 3 * n_verts; ++idx) {
+    verts[idx] = (rand() % 2000001 - 1000000) / 1000.f;
+  }
+  for(int idx = 0; idx < 3 * n_faces; ++idx) {
+    faces[idx] = rand() % n_verts;
+  }
+  const float R[] = {0,1,0, -1,0,0, 0,0,2};
+
+  FILE* f_off = fopen("test_mesh_io.off", "w");
+  FILE* f_obj = fopen("test_mesh_io.obj", "w");
+  fprintf(f_off, "OFF\n%d %d 0\n", n_verts, n_faces);
+  fprintf(f_obj, "# test mesh\r\no box\r\n");
+  for(int idx = 0; idx < n_verts; ++idx) {
+    fprintf(f_off, "%.3f %.3f %.3f\n", verts[idx*3+0], verts[idx*3+1], verts[idx*3+2]);
+    fprintf(f_obj, "v  %.3f %.3f %.3f\r\n", verts[idx*3+0], verts[idx*3+1], verts[idx*3+2]);
+  }
+  fprintf(f_obj, "vn 0 0 1\r\n");
+  for(int idx = 0; idx < n_faces; ++idx) {
+    fprintf(f_off, "3 %d %d %d\n", faces[idx*3+0], faces[idx*3+1], faces[idx*3+2]);
+    fprintf(f_obj, "f %d/1/1 %d//1 %d\r\n", faces[idx*3+0]+1, faces[idx*3+1]+1, faces[idx*3+2]+1);
+  }
+  fclose(f_off);
+  fclose(f_obj);
+
+  for(int fmt = 0; fmt < 2; ++fmt) {
+    std::vector<float> rverts;
+    std::vector<int> rfaces;
+    if(fmt == 0) {
+      mesh_read_off_cpu("test_mesh_io.off", R, n_threads, rverts, rfaces);
+    }
+    else {
+      mesh_read_obj_cpu("test_mesh_io.obj", R, n_threads, rverts, rfaces);
+    }
+    if(int(rverts.size()) != 3 * n_verts || rfaces != faces) {
+      printf("[ERROR] mesh_io %d: %d verts, %d faces\n", fmt, int(rverts.size()) / 3, int(rfaces.size()) / 3);
+      exit(-1);
+    }
+    for(int idx = 0; idx < n_verts; ++idx) {
+      float x = verts[idx*3+1];
+      float y = -verts[idx*3+0];
+      float z = 2 * verts[idx*3+2];
+      if(fabs(rverts[idx*3+0] - x) > 1e-6 * (1 + fabs(x)) || fabs(rverts[idx*3+1] - y) > 1e-6 * (1 + fabs(y)) || fabs(rverts[idx*3+2] - z) > 1e-6 * (1 + fabs(z))) {
+        printf("[ERROR] mesh_io %d: vertex %d is %f,%f,%f instead of %f,%f,%f\n", fmt, idx, rverts[idx*3+0], rverts[idx*3+1], rverts[idx*3+2], x, y, z);
+        exit(-1);
+      }
+    }
+  }
+
+  remove("test_mesh_io.off");
+  remove("test_mesh_io.obj");
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_scanline_fill(bool pack) {
+  std::cout << "[INFO] test_scanline_fill " << pack << std::endl;
+  const int depth = 32;
+  const int height = 24;
+  const int width = 40;
+
+  float verts[] = {10.5,4.5,6.5, 30.5,4.5,6.5, 10.5,20.5,6.5, 30.5,20.5,6.5, 
+                   10.5,4.5,26.5, 30.5,4.5,26.5, 10.5,20.5,26.5, 30.5,20.5,26.5};
+  int faces[] = {0,1,2, 1,3,2, 4,6,5, 5,6,7, 0,4,1, 1,4,5, 2,3,6, 3,7,6, 0,2,4, 2,6,4, 1,5,3, 3,5,7};
+  octree* grid = octree_create_from_mesh_cpu(8, verts, 12, faces, false, depth, height, width, false, 1, pack, 0, 4);
+
+  // reference: per voxel votes of the three axes on the dense grid
+  const int dd = 8 * grid->grid_depth;
+  const int dh = 8 * grid->grid_height;
+  const int dw = 8 * grid->grid_width;
+  std::vector<ot_data_t> dense(dd * dh * dw);
+  octree_to_cdhw_cpu(grid, dd, dh, dw, dense.data());
+  std::vector<int> votes(dd * dh * dw, 0);
+  for(int axis = 0; axis < 3; ++axis) {
+    int len = axis == 0 ? dd : (axis == 1 ? dh : dw);
+    int n0 = axis == 0 ? dh : dd;
+    int n1 = axis == 2 ? dh : dw;
+    for(int c0 = 0; c0 < n0; ++c0) {
+      for(int c1 = 0; c1 < n1; ++c1) {
+        int min = len, max = -1;
+        for(int pos = 0; pos < len; ++pos) {
+          int d = axis == 0 ? pos : c0;
+          int h = axis == 0 ? c0 : (axis == 1 ? pos : c1);
+          int w = axis == 2 ? pos : c1;
+          if(dense[(d * dh + h) * dw + w] != 0) {
+            min = std::min(min, pos);
+            max = std::max(max, pos);
+          }
+        }
+        for(int pos = min; pos <= max; ++pos) {
+          int d = axis == 0 ? pos : c0;
+          int h = axis == 0 ? c0 : (axis == 1 ? pos : c1);
+          int w = axis == 2 ? pos : c1;
+          votes[(d * dh + h) * dw + w]++;
+        }
+      }
+    }
+  }
+  std::vector<ot_data_t> expected(grid->data, grid->data + grid->n_leafs);
+  for(int grid_idx = 0; grid_idx < octree_num_blocks(grid); ++grid_idx) {
+    const ot_tree_t* tree = octree_get_tree(grid, grid_idx);
+    for(int data_idx = 0; data_idx < tree_n_leafs(tree); ++data_idx) {
+      int bit_idx = data_idx_to_bit_idx(tree, data_idx);
+      int n, d, h, w;
+      int cw = width_from_depth(octree_ind_to_dense_ind(grid, grid_idx, bit_idx, &n, &d, &h, &w));
+      int sum = 0;
+      for(int od = d; od < d + cw; ++od) {
+        for(int oh = h; oh < h + cw; ++oh) {
+          for(int ow = w; ow < w + cw; ++ow) {
+            sum += votes[(od * dh + oh) * dw + ow];
+          }
+        }
+      }
+      if(sum >= 2 * cw * cw * cw) {
+        expected[grid->prefix_leafs[grid_idx] + data_idx] = 5;
+      }
+    }
+  }
+
+  octree_scanline_fill(grid, 5);
+  int n_filled = 0;
+  for(int leaf_idx = 0; leaf_idx < grid->n_leafs; ++leaf_idx) {
+    if(grid->data[leaf_idx] != expected[leaf_idx]) {
+      printf("[ERROR] scanline_fill differs at leaf %d: %f vs %f\n", leaf_idx, grid->data[leaf_idx], expected[leaf_idx]);
+      exit(-1);
+    }
+    n_filled += grid->data[leaf_idx] == 5;
+  }
+  if(n_filled == 0) {
+    printf("[ERROR] scanline_fill did not fill the box\n");
+    exit(-1);
+  }
+
+  octree_free_cpu(grid);
+  std::cout << "[DONE]" << std::endl;
+}
+
+void check_slabs(const char* name, octree* gt, const char* shard_prefix, int n_slabs) {
+  octree* grid = octree_new_cpu();
+  octree_read_slabs_cpu(shard_prefix, 0, n_slabs, grid);
+  if(!octree_equal_cpu(gt, grid)) {
+    printf("[ERROR] octree from %s slabs differs\n", name);
+    exit(-1);
+  }
+  for(int slab_idx = 0; slab_idx < n_slabs; ++slab_idx) {
+    remove(octree_slab_path(shard_prefix, slab_idx).c_str());
+  }
+  octree_free_cpu(grid);
+  octree_free_cpu(gt);
+}
+
+void test_slabs(bool pack) {
+  std::cout << "[INFO] test_slabs " << pack << std::endl;
+  const int depth = 36;
+  const int height = 24;
+  const int width = 40;
+  const int n_pts = 2000;
+  const int feature_size = 2;
+
+  float* xyz = new float[n_pts * 3];
+  float* features = new float[n_pts * feature_size];
+  for(int idx = 0; idx < n_pts; ++idx) {
+    xyz[idx * 3 + 0] = (rand() % (width + 2)) - 1 + 0.1 + 0.8 * float(rand()) / RAND_MAX;
+    xyz[idx * 3 + 1] = (rand() % height) + 0.1 + 0.8 * float(rand()) / RAND_MAX;
+    xyz[idx * 3 + 2] = (idx % 3 == 0 ? 12 : 0) + (rand() % (depth - 8)) + 0.1 + 0.8 * float(rand()) / RAND_MAX;
+    for(int f = 0; f < feature_size; ++f) {
+      features[idx * feature_size + f] = float(rand()) / RAND_MAX;
+    }
+  }
+
+  float verts[] = {10.5,4.5,6.5, 30.5,4.5,6.5, 10.5,20.5,6.5, 30.5,20.5,6.5, 
+                   10.5,4.5,30.5, 30.5,4.5,30.5, 10.5,20.5,30.5, 30.5,20.5,30.5};
+  int faces[] = {0,1,2, 1,3,2, 4,6,5, 5,6,7, 0,4,1, 1,4,5, 2,3,6, 3,7,6, 0,2,4, 2,6,4, 1,5,3, 3,5,7};
+
+  const int slab_blocks[] = {1, 3};
+  for(int sidx = 0; sidx < 2; ++sidx) {
+    int n_slabs = octree_create_from_pc_slabs_cpu(xyz, features, n_pts, feature_size, depth, height, width, slab_blocks[sidx], pack, "test_slab_pc", 4);
+    octree* gt = octree_create_from_pc_morton_cpu(xyz, features, n_pts, feature_size, depth, height, width, false, false, false, 1, pack, 0, 4);
+    check_slabs("pc", gt, "test_slab_pc", n_slabs);
+
+    n_slabs = octree_create_from_mesh_slabs_cpu(8, verts, 12, faces, depth, height, width, slab_blocks[sidx], pack, "test_slab_mesh", 4);
+    gt = octree_create_from_mesh_cpu(8, verts, 12, faces, false, depth, height, width, false, 1, pack, 0, 4);
+    check_slabs("mesh", gt, "test_slab_mesh", n_slabs);
+  }
+
+  delete[] xyz;
+  delete[] features;
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_ray_casting_dda() {
+  std::cout << "[INFO] test_ray_casting_dda" << std::endl;
+  const int depth = 6;
+  const int height = 5;
+  const int width = 7;
+  float3 vx_offset = {-1.3f, 0.4f, 2.1f};
+  float3 vx_width = {0.5f, 0.7f, 0.4f};
+
+  // from inside and outside the volume, axis aligned and degenerate rays
+  float3 Cs[] = {{0.13f, 2.07f, 3.31f}, {-4.21f, -1.73f, 0.57f}, {3.37f, 5.11f, 6.03f}};
+  float3 rays[] = {{1,0,0}, {0,-1,0}, {0,0,0}, {0.6f,0.48f,0.64f}, {-0.3f,0.9f,0.1f}};
+  for(int cidx = 0; cidx < 3; ++cidx) {
+    for(int ridx = 0; ridx < 5 + 20; ++ridx) {
+      float3 C = Cs[cidx];
+      float3 ray;
+      if(ridx < 5) {
+        ray = rays[ridx];
+      }
+      else {
+        ray.x = 2 * float(rand()) / RAND_MAX - 1;
+        ray.y = 2 * float(rand()) / RAND_MAX - 1;
+        ray.z = 2 * float(rand()) / RAND_MAX - 1;
+      }
+
+      int* pos = 0;
+      float* ts = 0;
+      int n = ray_casting_cpu(vx_offset, vx_width, depth, height, width, C, ray, &pos, &ts);
+
+      // brute-force, every voxel that intersects the line
+      std::vector<float> tmins(depth * height * width, 0);
+      std::vector<char> hits(depth * height * width, 0);
+      for(int d = 0; d < depth; ++d) {
+        for(int h = 0; h < height; ++h) {
+          for(int w = 0; w < width; ++w) {
+            float3 vx;
+            vx.x = w * vx_width.x + vx_width.x/2.f + vx_offset.x;
+            vx.y = h * vx_width.y + vx_width.y/2.f + vx_offset.y;
+            vx.z = d * vx_width.z + vx_width.z/2.f + vx_offset.z;
+            int vx_idx = (d * height + h) * width + w;
+            hits[vx_idx] = intersection_ray_voxel(C, ray, vx, vx_width, tmins[vx_idx]);
+          }
+        }
+      }
+
+      std::vector<char> visited(depth * height * width, 0);
+      for(int idx = 0; idx < n; ++idx) {
+        int vx_idx = (pos[idx * 3 + 2] * height + pos[idx * 3 + 1]) * width + pos[idx * 3 + 0];
+        if(!hits[vx_idx] || visited[vx_idx] || fabs(ts[idx] - tmins[vx_idx]) > 1e-3 * (1 + fabs(tmins[vx_idx]))) {
+          printf("[ERROR] ray %d,%d visits voxel %d at %f, brute-force hit %d at %f\n", cidx, ridx, vx_idx, ts[idx], hits[vx_idx], tmins[vx_idx]);
+          exit(-1);
+        }
+        if(idx > 0 && ts[idx] < ts[idx - 1]) {
+          printf("[ERROR] ray %d,%d visits are not ordered by t\n", cidx, ridx);
+          exit(-1);
+        }
+        visited[vx_idx] = 1;
+      }
+      // voxels behind C are hit by the line, but not visited
+      for(int vx_idx = 0; vx_idx < depth * height * width; ++vx_idx) {
+        if(hits[vx_idx] && tmins[vx_idx] >= 0 && !visited[vx_idx]) {
+          printf("[ERROR] ray %d,%d misses voxel %d at %f\n", cidx, ridx, vx_idx, tmins[vx_idx]);
+          exit(-1);
+        }
+      }
+
+      if(n > 0) {
+        delete[] pos;
+        delete[] ts;
+      }
+    }
+  }
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_ray_casting_views() {
+  std::cout << "[INFO] test_ray_casting_views" << std::endl;
+  const int depth = 12;
+  const int height = 10;
+  const int width = 14;
+  // not a multiple of the packet size
+  const int im_height = 9;
+  const int im_width = 23;
+  const int n_views = 3;
+
+  std::vector<float> vxs(depth * height * width);
+  for(size_t idx = 0; idx < vxs.size(); ++idx) {
+    vxs[idx] = rand() % 3 == 0 ? float(rand()) / RAND_MAX : 0;
+  }
+  float3 vx_offset = {-1.f, 0.5f, 0.25f};
+  float3 vx_width = {0.5f, 0.6f, 0.5f};
+  const float Cs[] = {-6.13f, -4.37f, -7.29f,  1.11f, 3.23f, 2.07f,  9.3f, 8.1f, 10.7f};
+  const float Pis[] = {0.0613f,0.0011f,-0.4037f,0, 0.0007f,0.0591f,-0.1913f,0, 0.0103f,0.0197f,1.f,0, 
+                       0.0813f,0.f,-0.9f,0, 0.f,0.0813f,-0.4f,0, 0.01f,-0.02f,0.3f,0, 
+                       -0.0513f,0.0021f,0.2037f,0, 0.0017f,-0.0491f,0.1113f,0, -0.0203f,0.0097f,-1.f,0};
+
+  std::vector<float> ims_max(n_views * im_height * im_width);
+  std::vector<float> ims_avg(n_views * im_height * im_width);
+  ray_casting_depth_map_max_views_cpu(&vxs[0], vx_offset, vx_width, depth, height, width, n_views, Cs, Pis, &ims_max[0], im_height, im_width);
+  ray_casting_depth_map_avg_views_cpu(&vxs[0], vx_offset, vx_width, depth, height, width, n_views, Cs, Pis, &ims_avg[0], im_height, im_width);
+
+  int n_hits = 0;
+  for(int view = 0; view < n_views; ++view) {
+    const float* Pi = Pis + view * 12;
+    float3 C = {Cs[view * 3 + 0], Cs[view * 3 + 1], Cs[view * 3 + 2]};
+
+    std::vector<float> im_max(im_height * im_width);
+    std::vector<float> im_avg(im_height * im_width);
+    ray_casting_depth_map_max_cpu(&vxs[0], vx_offset, vx_width, depth, height, width, C, Pi, &im_max[0], im_height, im_width);
+    ray_casting_depth_map_avg_cpu(&vxs[0], vx_offset, vx_width, depth, height, width, C, Pi, &im_avg[0], im_height, im_width);
+
+    // scalar reference, one ray at a time
+    for(int v = 0; v < im_height; ++v) {
+      for(int u = 0; u < im_width; ++u) {
+        float3 ray;
+        ray.x = Pi[0] * u + Pi[1] * v + Pi[2];
+        ray.y = Pi[4] * u + Pi[5] * v + Pi[6];
+        ray.z = Pi[8] * u + Pi[9] * v + Pi[10];
+        float ray_norm = sqrt(ray.x*ray.x + ray.y*ray.y + ray.z*ray.z);
+        ray.x /= ray_norm;
+        ray.y /= ray_norm;
+        ray.z /= ray_norm;
+
+        float max_prob = 0;
+        float max_t = -1;
+        float prob_sum = 0;
+        float t_sum = 0;
+        ray_casting_traverse_cpu(vx_offset, vx_width, depth, height, width, C, ray, 
+            [&](int w, int h, int d, float t) {
+              float prob = vxs[(d * height + h) * width + w];
+              if(prob > max_prob) {
+                max_prob = prob;
+                max_t = t;
+              }
+              if(prob > 0) {
+                prob_sum += prob;
+                t_sum += t;
+              }
+              return true;
+            });
+        float avg_t = prob_sum > 0 ? t_sum / prob_sum : -1;
+
+        int idx = v * im_width + u;
+        int views_idx = view * im_height * im_width + idx;
+        n_hits += max_t >= 0;
+        if(fabs(max_t - ims_max[views_idx]) > 1e-4 * (1 + fabs(max_t)) || fabs(avg_t - ims_avg[views_idx]) > 1e-4 * (1 + fabs(avg_t))) {
+          printf("[ERROR] view %d ray casting differs at %d,%d: max %f/%f, avg %f/%f\n", 
+              view, u, v, max_t, ims_max[views_idx], avg_t, ims_avg[views_idx]);
+          exit(-1);
+        }
+        if(im_max[idx] != ims_max[views_idx] || im_avg[idx] != ims_avg[views_idx]) {
+          printf("[ERROR] single view %d differs at %d,%d\n", view, u, v);
+          exit(-1);
+        }
+      }
+    }
+  }
+  if(n_hits == 0) {
+    printf("[ERROR] no ray hits the volume\n");
+    exit(-1);
+  }
+  std::cout << "[DONE]" << std::endl;
+}
+
+void test_ray_casting(bool pack) {
+  std::cout << "[INFO] test_ray_casting " << pack << std::endl;
+  const int depth = 32;
+  const int height = 24;
+  const int width = 40;
+  const int im_height = 20;
+  const int im_width = 30;
+
+  float verts[] = {10.5,4.5,6.5, 30.5,4.5,6.5, 10.5,20.5,6.5, 30.5,20.5,6.5, 
+                   10.5,4.5,26.5, 30.5,4.5,26.5, 10.5,20.5,26.5, 30.5,20.5,26.5};
+  int faces[] = {0,1,2, 1,3,2, 4,6,5, 5,6,7, 0,4,1, 1,4,5, 2,3,6, 3,7,6, 0,2,4, 2,6,4, 1,5,3, 3,5,7};
+  octree* grid = octree_create_from_mesh_cpu(8, verts, 12, faces, false, depth, height, width, false, 1, pack, 0, 4);
+  for(int idx = 0; idx < grid->n_leafs; ++idx) {
+    grid->data[idx] = rand() % 4 == 0 ? 0 : float(rand()) / RAND_MAX;
+  }
+  std::vector<ot_data_t> vxs(depth * height * width);
+  octree_to_cdhw_cpu(grid, depth, height, width, &vxs[0]);
+
+  float3 vx_offset = {-2.f, 1.f, 0.5f};
+  float3 vx_width = {0.5f, 0.75f, 0.5f};
+  float3 Cs[] = {{-10.13f, -5.37f, -12.29f}, {8.11f, 10.23f, 8.07f}};
+  const float Pi[] = {0.0513f,0.0011f,-0.3037f,0, 0.0007f,0.0491f,-0.2113f,0, 0.0103f,0.0197f,1.f,0};
+
+  std::vector<float> im_max(im_height * im_width);
+  std::vector<float> im_avg(im_height * im_width);
+  std::vector<float> im_first(im_height * im_width);
+  std::vector<float> im_avg_dense(im_height * im_width);
+  int n_avg_differ = 0;
+  for(int cidx = 0; cidx < 2; ++cidx) {
+    float3 C = Cs[cidx];
+    ray_casting_depth_map_avg_cpu(&vxs[0], vx_offset, vx_width, depth, height, width, C, Pi, &im_avg_dense[0], im_height, im_width);
+    octree_ray_casting_depth_map_max_cpu(grid, vx_offset, vx_width, C, Pi, &im_max[0], im_height, im_width, 4);
+    octree_ray_casting_depth_map_avg_cpu(grid, vx_offset, vx_width, C, Pi, &im_avg[0], im_height, im_width, 4);
+    octree_ray_casting_depth_map_first_cpu(grid, vx_offset, vx_width, C, Pi, 0.5, &im_first[0], im_height, im_width, 4);
+
+    // reference on the dense volume
+    int n_hits = 0;
+    for(int v = 0; v < im_height; ++v) {
+      for(int u = 0; u < im_width; ++u) {
+        float3 ray;
+        ray.x = Pi[0] * u + Pi[1] * v + Pi[2];
+        ray.y = Pi[4] * u + Pi[5] * v + Pi[6];
+        ray.z = Pi[8] * u + Pi[9] * v + Pi[10];
+        float ray_norm = sqrt(ray.x*ray.x + ray.y*ray.y + ray.z*ray.z);
+        ray.x /= ray_norm;
+        ray.y /= ray_norm;
+        ray.z /= ray_norm;
+
+        float max_prob = 0;
+        float max_t = -1;
+        float first_t = -1;
+        float weight_sum = 0;
+        float t_sum = 0;
+        float prob_sum = 0;
+        float t_sum_dense = 0;
+        ray_casting_traverse_cpu(vx_offset, vx_width, depth, height, width, C, ray, 
+            [&](int w, int h, int d, float t) {
+              float prob = vxs[(d * height + h) * width + w];
+              if(prob > max_prob) {
+                max_prob = prob;
+                max_t = FMAX(t, 0);
+              }
+              if(prob > 0) {
+                prob_sum += prob;
+                t_sum_dense += t;
+              }
+              if(prob >= 0.5 && first_t < 0) {
+                first_t = FMAX(t, 0);
+              }
+              float t_exit = 1e9;
+              const int vx[3] = {w, h, d};
+              for(int axis = 0; axis < 3; ++axis) {
+                float t1 = (vx_offset[axis] + vx[axis] * vx_width[axis] - C[axis]) / ray[axis];
+                float t2 = (vx_offset[axis] + (vx[axis] + 1) * vx_width[axis] - C[axis]) / ray[axis];
+                t_exit = FMIN(t_exit, FMAX(t1, t2));
+              }
+              float t_enter = FMAX(t, 0);
+              if(prob > 0 && t_exit > t_enter) {
+                weight_sum += prob * (t_exit - t_enter);
+                t_sum += prob * (t_exit - t_enter) * 0.5f * (t_enter + t_exit);
+              }
+              return true;
+            });
+        float avg_t = weight_sum > 0 ? t_sum / weight_sum : -1;
+
+        int idx = v * im_width + u;
+        n_hits += max_t >= 0;
+        if(fabs(max_t - im_max[idx]) > 1e-3 || fabs(first_t - im_first[idx]) > 1e-3 || fabs(avg_t - im_avg[idx]) > 1e-3) {
+          printf("[ERROR] octree ray casting differs at %d,%d: max %f/%f, first %f/%f, avg %f/%f\n", 
+              u, v, max_t, im_max[idx], first_t, im_first[idx], avg_t, im_avg[idx]);
+          exit(-1);
+        }
+
+        // the dense avg keeps its semantics, t sum over probability sum
+        float avg_t_dense = prob_sum > 0 ? t_sum_dense / prob_sum : -1;
+        if(fabs(avg_t_dense - im_avg_dense[idx]) > 1e-4 * (1 + fabs(avg_t_dense))) {
+          printf("[ERROR] dense avg ray casting differs at %d,%d: %f/%f\n", 
+              u, v, avg_t_dense, im_avg_dense[idx]);
+          exit(-1);
+        }
+        n_avg_differ += fabs(im_avg[idx] - im_avg_dense[idx]) > 1e-3;
+      }
+    }
+    if(n_hits == 0) {
+      printf("[ERROR] no ray hits the octree\n");
+      exit(-1);
+    }
+  }
+
+  if(n_avg_differ == 0) {
+    printf("[ERROR] octree and dense avg ray casting do not differ\n");
+    exit(-1);
+  }
+
+  octree_free_cpu(grid);
+  std::cout << "[DONE]" << std::endl;
+}
+
 int main(int argc, char** argv) {    
   test_dense_features();
+  test_dense_occupancy(false);
+  test_dense_occupancy(true);
+  test_pack_homogeneous();
+  test_cache();
+  test_mesh();
+  test_triangle_voxel_sse();
+  test_pc_morton(false);
+  test_pc_morton(true);
+  test_bottom_up(false, false);
+  test_bottom_up(false, true);
+  test_bottom_up(true, true);
+  test_static(false);
+  test_static(true);
+  test_batch(false, false, 2);
+  test_batch(false, true, 8);
+  test_batch(true, true, 2);
+  test_mesh_io(1);
+  test_mesh_io(4);
+  test_scanline_fill(false);
+  test_scanline_fill(true);
+  test_slabs(false);
+  test_slabs(true);
+  test_ray_casting_dda();
+  test_ray_casting_views();
+  test_ray_casting(false);
+  test_ray_casting(true);
   return 0;
 }
\ No newline at end of file
@@ -16,6 +16,8 @@ torch.setdefaulttensortype('torch.FloatTensor')
 
 local opt = {}
 opt.batch_size = 8
+-- bound of the input plus target n_leafs per batch, half of the dense voxels
+opt.max_leafs = opt.batch_size * 32 * 32 * 32
 opt.data_paths = { 
     "/root/vol/octnet-completion/benchmark/sdf",
     "/root/vol/octnet-completion/benchmark/df" 
@@ -44,6 +46,12 @@ opt.net = completion_model.create_model(opt)
 -- create data loader
 local train_data_loader = dataloader.DataLoader(opt.data_paths, opt.batch_size, opt.full_batches, "overfit")
 local test_data_loader = dataloader.DataLoader(opt.data_paths, opt.batch_size, opt.full_batches, "overfit")
+-- octrees of the training samples are created once and then served from memory
+train_data_loader:setCache(oc.OctreeCache(4 * 1024 * 1024 * 1024))
+-- batches of bounded n_leafs, read in the background
+train_data_loader:setSampler(dataloader.LeafBalancedSampler.from_data_loader(
+    train_data_loader, opt.max_leafs, opt.batch_size, opt.tr_dist))
+train_data_loader:setPrefetch(4)
 
 
 local input, _target = train_data_loader:getBatch()
@@ -46,9 +46,9 @@ function train_epoch(opt, data_loader)
       if x ~= parameters then parameters:copy(x) end
       grad_parameters:zero()
 
-      local _input, _target = data_loader:getBatch()
-      local input = oc.FloatOctree():octree_create_from_dense_features_batch(_input, opt.tr_dist):cuda()
-      local target = oc.FloatOctree():octree_create_from_dense_features_batch(_target, opt.tr_dist):cuda()
+      local input, target = data_loader:getOctreeBatch(opt.tr_dist)
+      input = input:cuda()
+      target = target:cuda()
 
       local output = net:forward(input)
 
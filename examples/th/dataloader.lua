@@ -14,57 +14,273 @@ function BuildArray(...)
 end
 
 
+--- Forms batches of sample indices with a bounded total cost per batch, e.g.,
+-- the number of octree leafs that dominates the iteration time. Batches are
+-- packed first-fit decreasing (samples with a cost above max_cost get their
+-- own batch) and their order is shuffled every epoch.
+local LeafBalancedSampler = torch.class('dataloader.LeafBalancedSampler')
+
+function LeafBalancedSampler:__init(costs, max_cost, max_batch_size)
+  self.costs = costs or error('LeafBalancedSampler: costs are required')
+  self.max_cost = max_cost or error('LeafBalancedSampler: max_cost is required')
+  self.max_batch_size = max_batch_size or math.huge
+  self:plan()
+end
+
+--- Creates a sampler with the n_leafs read from the headers of octree_paths.
+-- Only meaningful if the loader reads exactly these octree files, in this
+-- order; use from_data_loader for the dense DataLoader below.
+function LeafBalancedSampler.from_octree_files(octree_paths, max_leafs, max_batch_size, n_threads)
+  local oc = require('oc')
+  local n_leafs = oc.read_n_leafs_from_bin_batch(octree_paths, n_threads or 4)
+  return dataloader.LeafBalancedSampler(n_leafs, max_leafs, max_batch_size)
+end
+
+--- Creates a sampler with the n_leafs of the octrees that loader creates
+-- from its samples with tr_dist, see DataLoader:sampleCosts.
+function LeafBalancedSampler.from_data_loader(loader, max_leafs, max_batch_size, tr_dist)
+  return dataloader.LeafBalancedSampler(loader:sampleCosts(tr_dist), max_leafs, max_batch_size)
+end
+
+function LeafBalancedSampler:plan()
+  -- shuffle first, such that samples with equal cost are mixed across epochs
+  local order = torch.randperm(#self.costs):totable()
+  local rank = {}
+  for pos, idx in ipairs(order) do rank[idx] = pos end
+  table.sort(order, function(a, b)
+    if self.costs[a] ~= self.costs[b] then return self.costs[a] > self.costs[b] end
+    return rank[a] < rank[b]
+  end)
+
+  local batches, batch_costs = {}, {}
+  for _, idx in ipairs(order) do
+    local cost = self.costs[idx]
+    local target = nil
+    for bidx = 1, #batches do
+      if #batches[bidx] < self.max_batch_size and batch_costs[bidx] + cost <= self.max_cost then
+        target = bidx
+        break
+      end
+    end
+    if not target then
+      table.insert(batches, {})
+      table.insert(batch_costs, 0)
+      target = #batches
+    end
+    table.insert(batches[target], idx)
+    batch_costs[target] = batch_costs[target] + cost
+  end
+
+  self.batches = {}
+  for _, bidx in ipairs(torch.randperm(#batches):totable()) do
+    table.insert(self.batches, batches[bidx])
+  end
+  self.batch_idx = 0
+end
+
+--- @return table of sample indices of the next batch, replans after an epoch.
+function LeafBalancedSampler:next()
+  if self.batch_idx >= #self.batches then
+    self:plan()
+  end
+  self.batch_idx = self.batch_idx + 1
+  return self.batches[self.batch_idx]
+end
+
+function LeafBalancedSampler:n_batches()
+  return #self.batches
+end
+
+
 local DataLoader = torch.class('dataloader.DataLoader')
 
 function DataLoader:__init(data_paths, batch_size, full_batches, split)
   assert(split == "val" or split == "overfit" or split == "train")
-  self.split = split or error('')
-  self.data_paths = data_paths or error('')
+  self.split = split or error('DataLoader: split is required')
+  self.data_paths = data_paths or error('DataLoader: data_paths ({sdf_path, df_path}) are required')
 
-  self.batch_size = batch_size or error('')
+  self.batch_size = batch_size or error('DataLoader: batch_size is required')
   self.full_batches = full_batches or false
   self.items = BuildArray(io.open(string.format("/root/vol/octnet-completion/benchmark/%s.txt", self.split)):lines())
   self.n_samples = #self.items
   self.idx = 1
   assert(self.idx < self.n_samples, "idx should be smaller than the number of samples")
   assert(self.batch_size < self.n_samples, "Batch size should be smaller than the number of samples")
-  
+
 end
 
-function DataLoader:getBatch()
-    local bs = math.min(self.batch_size, self.n_samples - self.idx)
+--- Draw batches from sampler (e.g., dataloader.LeafBalancedSampler) instead
+-- of fixed size batches in file order. The sampler indices refer to the
+-- lines of the split file.
+function DataLoader:setSampler(sampler)
+  self.sampler = sampler
+end
 
+--- Reads the dense .sdf and .df files of a batch. Only depends on its
+-- arguments, such that it can run in the prefetch threads.
+function dataloader.read_samples(sdf_paths, df_paths)
+    local bs = #sdf_paths
     local sdf_batch = torch.Tensor(bs, 32, 32, 32, 2):zero()
     local df_batch = torch.Tensor(bs, 32, 32, 32, 1)
 
     for batch_idx = 1, bs do
-      local sdf_df_ids = {}
-      self.idx = self.idx + 1
-      local line = self.items[self.idx]
-      for str in line:gmatch('[^%s]+') do
-        table.insert(sdf_df_ids, str)
-      end
-
-      local sdf = f_ops.parse_sdf(f_ops.read_file(self.data_paths[1] .. "/" .. sdf_df_ids[1] .. ".sdf"))
-      local df = f_ops.parse_df(f_ops.read_file(self.data_paths[2] .. "/" .. sdf_df_ids[2] .. ".df"))
+      local sdf = f_ops.parse_sdf(f_ops.read_file(sdf_paths[batch_idx]))
+      local df = f_ops.parse_df(f_ops.read_file(df_paths[batch_idx]))
       sdf_batch[batch_idx] = sdf
       df_batch[batch_idx] = df:view(32, 32, 32, 1)
     end
 
     collectgarbage(); collectgarbage()
+    return sdf_batch, df_batch
+end
+
+--- @return the .sdf and .df paths of the sample in line idx of the split file.
+function DataLoader:samplePaths(idx)
+  local sdf_df_ids = {}
+  for str in self.items[idx]:gmatch('[^%s]+') do
+    table.insert(sdf_df_ids, str)
+  end
+  return self.data_paths[1] .. "/" .. sdf_df_ids[1] .. ".sdf",
+         self.data_paths[2] .. "/" .. sdf_df_ids[2] .. ".df"
+end
+
+--- @return tables of the .sdf and .df paths of the samples in indices.
+function DataLoader:batchPaths(indices)
+  local sdf_paths, df_paths = {}, {}
+  for batch_idx, idx in ipairs(indices) do
+    sdf_paths[batch_idx], df_paths[batch_idx] = self:samplePaths(idx)
+  end
+  return sdf_paths, df_paths
+end
+
+--- @return table with the n_leafs of the input plus the target octree of
+-- every sample, created with tr_dist. The dense headers are all 32^3, the
+-- octrees are what the iteration time scales with. Set the cache before, then
+-- this pass also creates the octrees of the first epoch.
+function DataLoader:sampleCosts(tr_dist)
+  local costs = {}
+  for first = 1, self.n_samples, self.batch_size do
+    local indices = {}
+    for idx = first, math.min(first + self.batch_size - 1, self.n_samples) do
+      table.insert(indices, idx)
+    end
+    local sdf_batch, df_batch = self:readSamples(indices)
+    for batch_idx, idx in ipairs(indices) do
+      local input, target = self:createOctrees({idx},
+          sdf_batch:narrow(1, batch_idx, 1), df_batch:narrow(1, batch_idx, 1), tr_dist)
+      costs[idx] = input:n_leafs() + target:n_leafs()
+    end
+  end
+  return costs
+end
+
+function DataLoader:readSamples(indices)
+    return dataloader.read_samples(self:batchPaths(indices))
+end
+
+--- @return table of the sample indices of the next batch.
+function DataLoader:nextIndices()
+    if self.sampler then
+      return self.sampler:next()
+    end
+
+    local bs = math.min(self.batch_size, self.n_samples - self.idx)
+
+    local indices = {}
+    for batch_idx = 1, bs do
+      self.idx = self.idx + 1
+      indices[batch_idx] = self.idx
+    end
+
     if self.n_samples - self.idx <= 0 then
       self.idx = 0
     end
+    return indices
+end
+
+--- Reads the next n_prefetch batches in n_threads background threads (torch
+-- threads package), getBatch and getOctreeBatch then only wait for the batch
+-- in front of the queue. The indices are still drawn in order from
+-- nextIndices, hence, call setSampler first.
+function DataLoader:setPrefetch(n_threads, n_prefetch)
+  local threads = require('threads')
+  local package_path, package_cpath = package.path, package.cpath
+  self.pool = threads.Threads(n_threads, function()
+    package.path, package.cpath = package_path, package_cpath
+    require('torch')
+    require('dataloader')
+  end)
+  self.n_prefetch = n_prefetch or 2 * n_threads
+  self.queue = {}
+end
+
+function DataLoader:prefetch()
+  local slot = {indices = self:nextIndices()}
+  local sdf_paths, df_paths = self:batchPaths(slot.indices)
+  table.insert(self.queue, slot)
+  self.pool:addjob(
+    function() return dataloader.read_samples(sdf_paths, df_paths) end,
+    function(sdf_batch, df_batch) slot.sdf_batch, slot.df_batch = sdf_batch, df_batch end)
+end
+
+--- @return the indices and the dense .sdf and .df tensors of the next batch.
+function DataLoader:nextSamples()
+    if not self.pool then
+      local indices = self:nextIndices()
+      return indices, self:readSamples(indices)
+    end
+
+    while #self.queue < self.n_prefetch do
+      self:prefetch()
+    end
+    local slot = table.remove(self.queue, 1)
+    while not slot.sdf_batch do
+      self.pool:dojob()
+    end
+    self:prefetch()
+    return slot.indices, slot.sdf_batch, slot.df_batch
+end
+
+function DataLoader:getBatch()
+    local _, sdf_batch, df_batch = self:nextSamples()
     return sdf_batch, df_batch
 end
 
+--- Creates the octrees of getOctreeBatch through cache (oc.OctreeCache),
+-- keyed by the .sdf and .df paths, such that only the first epoch converts
+-- the dense samples.
+function DataLoader:setCache(cache)
+  self.cache = cache
+end
+
+--- @return input and target octrees of the next batch, created from the
+-- dense samples with tr_dist (through the cache, if set).
+function DataLoader:getOctreeBatch(tr_dist)
+    local indices, sdf_batch, df_batch = self:nextSamples()
+    return self:createOctrees(indices, sdf_batch, df_batch, tr_dist)
+end
+
+function DataLoader:createOctrees(indices, sdf_batch, df_batch, tr_dist)
+    local oc = require('oc')
+    if not self.cache then
+      return oc.FloatOctree():octree_create_from_dense_features_batch(sdf_batch, tr_dist),
+             oc.FloatOctree():octree_create_from_dense_features_batch(df_batch, tr_dist)
+    end
+
+    local sdf_paths, df_paths = self:batchPaths(indices)
+    return oc.FloatOctree():octree_create_from_dense_features_batch_cached(self.cache, sdf_paths, sdf_batch, tr_dist),
+           oc.FloatOctree():octree_create_from_dense_features_batch_cached(self.cache, df_paths, df_batch, tr_dist)
+end
+
 
 function DataLoader:size()
   return self.n_samples
 end
 
 function DataLoader:n_batches()
-  if self.full_batches then
+  if self.sampler then
+    return self.sampler:n_batches()
+  elseif self.full_batches then
     return math.floor(self.n_samples / self.batch_size)
   else
     return math.ceil(self.n_samples / self.batch_size)
@@ -35,6 +35,24 @@ local function read_file(file_name)
     return tensor_file
 end
 
+-- Reads only the header of file_name, i.e., the dims of the stored grid.
+local function read_header(file_name)
+    local fd, err = io.open(file_name, "rb")
+    if err then error(err) end
+
+    local header_size = 3
+    local header_bsize = header_size * ffi.sizeof('uint64_t')
+    local header_str = fd:read(header_bsize)
+    fd:close()
+    if not header_str or #header_str < header_bsize then
+        error(string.format("truncated header in %s", file_name))
+    end
+
+    local header = ffi.new("uint64_t[?]", header_size)
+    ffi.copy(header, header_str, header_bsize)
+    return {tonumber(header[0]), tonumber(header[1]), tonumber(header[2])}
+end
+
 local function parse_sdf(input_sdf)
     return torch.cat(torch.abs(input_sdf), torch.sign(input_sdf), 4)
     -- return input_sdf
@@ -46,6 +64,7 @@ end
 
 return {
     read_file = read_file,
+    read_header = read_header,
     parse_sdf = parse_sdf,
     parse_df = parse_df,
 }
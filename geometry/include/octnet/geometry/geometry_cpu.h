@@ -28,15 +28,115 @@
 
 #include "geometry.h"
 
-void int_array_delete(int* array) {
+inline void int_array_delete(int* array) {
   delete[] array;
 }
-void float_array_delete(float* array) {
+inline void float_array_delete(float* array) {
   delete[] array;
 }
 
+// sets up the 3D-DDA (Amanatides and Woo) of the viewing ray C + t * ray, 
+// t >= 0: idx is the first voxel (w, h, d) that is hit, t the distance where 
+// the line enters it, step the direction (-1, 0, 1) per axis, t_next the 
+// distance to the next voxel boundary per axis and t_delta the distance 
+// between two voxel boundaries per axis.
+// return value is false if the ray misses the volume
+inline bool ray_casting_dda_init_cpu(float3 vx_offset, float3 vx_width, int depth, int height, int width, float3 C, float3 ray, int* idx, int* step, float* t_next, float* t_delta, float* t) {
+  // the ray in grid coordinates, voxel i spans [i, i+1] along each axis
+  const int n[3] = {width, height, depth};
+  float p[3], dir[3];
+  for(int axis = 0; axis < 3; ++axis) {
+    p[axis] = (C[axis] - vx_offset[axis]) / vx_width[axis];
+    dir[axis] = fabs(ray[axis]) < EPS ? 0 : ray[axis] / vx_width[axis];
+  }
+
+  // clip the ray against the volume
+  float t_enter = 0;
+  float t_exit = 1e9;
+  for(int axis = 0; axis < 3; ++axis) {
+    if(dir[axis] == 0) {
+      if(p[axis] < 0 || p[axis] > n[axis]) {
+        return false;
+      }
+    }
+    else {
+      float t1 = (0 - p[axis]) / dir[axis];
+      float t2 = (n[axis] - p[axis]) / dir[axis];
+      t_enter = FMAX(t_enter, FMIN(t1, t2));
+      t_exit = FMIN(t_exit, FMAX(t1, t2));
+    }
+  }
+  if(t_enter > t_exit) {
+    return false;
+  }
+
+  *t = -1e9;
+  for(int axis = 0; axis < 3; ++axis) {
+    idx[axis] = floor(p[axis] + t_enter * dir[axis]);
+    idx[axis] = IMAX(0, IMIN(n[axis] - 1, idx[axis]));
+    if(dir[axis] > 0) {
+      step[axis] = 1;
+      t_next[axis] = (idx[axis] + 1 - p[axis]) / dir[axis];
+      t_delta[axis] = 1.f / dir[axis];
+      *t = FMAX(*t, (idx[axis] - p[axis]) / dir[axis]);
+    }
+    else if(dir[axis] < 0) {
+      step[axis] = -1;
+      t_next[axis] = (idx[axis] - p[axis]) / dir[axis];
+      t_delta[axis] = -1.f / dir[axis];
+      *t = FMAX(*t, (idx[axis] + 1 - p[axis]) / dir[axis]);
+    }
+    else {
+      step[axis] = 0;
+      t_next[axis] = 1e30;
+      t_delta[axis] = 0;
+    }
+  }
+  return true;
+}
+
+// traverses the voxels of the volume that are hit by the viewing ray 
+// C + t * ray, t >= 0, in the order of t with a 3D-DDA, 
+// @see ray_casting_dda_init_cpu. for each voxel visit(w, h, d, t) is called, 
+// where t is the distance where the line enters the voxel, which is negative 
+// for the voxel that contains C. the traversal is stopped if visit returns 
+// false.
+// return value is the number of visited voxels
+template <typename Visitor>
+inline int ray_casting_traverse_cpu(float3 vx_offset, float3 vx_width, int depth, int height, int width, float3 C, float3 ray, Visitor visit) {
+  const int n[3] = {width, height, depth};
+  int idx[3], step[3];
+  float t_next[3], t_delta[3];
+  float t;
+  if(!ray_casting_dda_init_cpu(vx_offset, vx_width, depth, height, width, C, ray, idx, step, t_next, t_delta, &t)) {
+    return 0;
+  }
+
+  int n_visited = 0;
+  while(true) {
+    n_visited++;
+    if(!visit(idx[0], idx[1], idx[2], t)) {
+      break;
+    }
+
+    int axis = t_next[0] < t_next[1] ? (t_next[0] < t_next[2] ? 0 : 2) : (t_next[1] < t_next[2] ? 1 : 2);
+    // all steps are 0 for a degenerate ray, it never leaves its voxel
+    if(step[axis] == 0) {
+      break;
+    }
+    idx[axis] += step[axis];
+    if(idx[axis] < 0 || idx[axis] >= n[axis]) {
+      break;
+    }
+    t = t_next[axis];
+    t_next[axis] += t_delta[axis];
+  }
+  return n_visited;
+}
+
 // general ray casting method that returns as parameters the positions pos of the 
-// voxels that are hit by the viewing rays along with the distances ts.
+// voxels that are hit by the viewing rays along with the distances ts, ordered
+// by ts, @see ray_casting_traverse_cpu. the arrays are allocated by this method.
 // return value is the number of voxels hit by the viewing ray
 int ray_casting_cpu(float3 vx_offset, float3 vx_width, int depth, int height, int width, float3 C, float3 ray, int** pos, float** ts);
 
@@ -50,6 +150,15 @@ void ray_casting_depth_map_max_cpu(const float* vxs, float3 vx_offset, float3 vx
 // in the voxel along the viewing ray.
 void ray_casting_depth_map_avg_cpu(const float* vxs, float3 vx_offset, float3 vx_width, int depth, int height, int width, float3 C, const float* Pi, float* im, int im_height, int im_width);
 
+// multi-view variants of the methods above that render the depth maps ims 
+// (n_views x im_height x im_width) of the cameras Cs (n_views x 3) and Pis 
+// (n_views x 3 x 4) in one call. the viewing rays are generated, clipped 
+// against the volume and traversed in SSE packets of 4 neighbouring rays, 
+// the 3D-DDAs of a packet step in lockstep until all of its rays left the 
+// volume.
+void ray_casting_depth_map_max_views_cpu(const float* vxs, float3 vx_offset, float3 vx_width, int depth, int height, int width, int n_views, const float* Cs, const float* Pis, float* ims, int im_height, int im_width);
+void ray_casting_depth_map_avg_views_cpu(const float* vxs, float3 vx_offset, float3 vx_width, int depth, int height, int width, int n_views, const float* Cs, const float* Pis, float* ims, int im_height, int im_width);
+
 
 
 #endif
@@ -0,0 +1,155 @@
+// Copyright (c) 2017, The OctNet authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the <organization> nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef GEOMETRY_SSE_H
+#define GEOMETRY_SSE_H
+
+#include "geometry.h"
+
+#include <smmintrin.h>
+
+// packet of 4 triangles for intersection_triangles_voxel_sse in SoA layout, 
+// i.e., the coordinate dim of vertex vidx of triangle lane is stored at 
+// ((vidx * 3) + dim) * 4 + lane.
+#define TRIANGLE_PACKET_SIZE 36
+
+inline void triangle_packet_set(float* packet, int lane, const float* v0, const float* v1, const float* v2) {
+  for(int dim = 0; dim < 3; ++dim) {
+    packet[(0 * 3 + dim) * 4 + lane] = v0[dim];
+    packet[(1 * 3 + dim) * 4 + lane] = v1[dim];
+    packet[(2 * 3 + dim) * 4 + lane] = v2[dim];
+  }
+}
+
+// SSE variant of intersection_triangle_voxel that tests the 4 triangles of 
+// packet against the voxel. the separating axis tests are the ones of 
+// triBoxOverlap in the same order and with the same arithmetic, hence, the
+// results are identical to the scalar test. the test stops as soon as all 4
+// triangles are separated.
+// return value is the mask of the triangles that intersect the voxel
+inline int intersection_triangles_voxel_sse(float3 vx_c, float3 vx_w, const float* packet) {
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 half[3] = {_mm_set1_ps(vx_w.x/2.f), _mm_set1_ps(vx_w.y/2.f), _mm_set1_ps(vx_w.z/2.f)};
+  const __m128 c[3] = {_mm_set1_ps(vx_c.x), _mm_set1_ps(vx_c.y), _mm_set1_ps(vx_c.z)};
+
+  // move everything so that the boxcenter is in (0,0,0)
+  __m128 v[3][3];
+  for(int vidx = 0; vidx < 3; ++vidx) {
+    for(int dim = 0; dim < 3; ++dim) {
+      v[vidx][dim] = _mm_sub_ps(_mm_loadu_ps(packet + (vidx * 3 + dim) * 4), c[dim]);
+    }
+  }
+  __m128 e[3][3];
+  for(int dim = 0; dim < 3; ++dim) {
+    e[0][dim] = _mm_sub_ps(v[1][dim], v[0][dim]);
+    e[1][dim] = _mm_sub_ps(v[2][dim], v[1][dim]);
+    e[2][dim] = _mm_sub_ps(v[0][dim], v[2][dim]);
+  }
+
+  // lanes that are not separated yet
+  __m128 alive = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+  // separating axis test with the projections p and q of two vertices and 
+  // the projected box radius rad
+#define SSE_AXIS_TEST(p, q, rad) { \
+    __m128 min_ = _mm_min_ps(p, q); \
+    __m128 max_ = _mm_max_ps(q, p); \
+    __m128 rad_ = rad; \
+    __m128 sep_ = _mm_or_ps(_mm_cmpgt_ps(min_, rad_), _mm_cmplt_ps(max_, _mm_sub_ps(zero, rad_))); \
+    alive = _mm_andnot_ps(sep_, alive); \
+    if(_mm_movemask_ps(alive) == 0) return 0; \
+  }
+
+  // 9 tests with the cross products of the edges and the axes, the vertex 
+  // pairs per edge are the ones of the AXISTEST macros
+  const int x_pairs[3][2] = {{0, 2}, {0, 2}, {0, 1}};
+  const int y_pairs[3][2] = {{0, 2}, {0, 2}, {0, 1}};
+  const int z_pairs[3][2] = {{1, 2}, {0, 1}, {1, 2}};
+  for(int eidx = 0; eidx < 3; ++eidx) {
+    const __m128 ex = e[eidx][0];
+    const __m128 ey = e[eidx][1];
+    const __m128 ez = e[eidx][2];
+    const __m128 fex = _mm_and_ps(ex, abs_mask);
+    const __m128 fey = _mm_and_ps(ey, abs_mask);
+    const __m128 fez = _mm_and_ps(ez, abs_mask);
+
+    // X: p = a*v[Y] - b*v[Z] with a = ez, b = ey
+    {
+      const __m128* va = v[x_pairs[eidx][0]];
+      const __m128* vb = v[x_pairs[eidx][1]];
+      __m128 p = _mm_sub_ps(_mm_mul_ps(ez, va[1]), _mm_mul_ps(ey, va[2]));
+      __m128 q = _mm_sub_ps(_mm_mul_ps(ez, vb[1]), _mm_mul_ps(ey, vb[2]));
+      SSE_AXIS_TEST(p, q, _mm_add_ps(_mm_mul_ps(fez, half[1]), _mm_mul_ps(fey, half[2])));
+    }
+    // Y: p = -a*v[X] + b*v[Z] with a = ez, b = ex
+    {
+      const __m128* va = v[y_pairs[eidx][0]];
+      const __m128* vb = v[y_pairs[eidx][1]];
+      const __m128 nez = _mm_xor_ps(ez, _mm_set1_ps(-0.f));
+      __m128 p = _mm_add_ps(_mm_mul_ps(nez, va[0]), _mm_mul_ps(ex, va[2]));
+      __m128 q = _mm_add_ps(_mm_mul_ps(nez, vb[0]), _mm_mul_ps(ex, vb[2]));
+      SSE_AXIS_TEST(p, q, _mm_add_ps(_mm_mul_ps(fez, half[0]), _mm_mul_ps(fex, half[2])));
+    }
+    // Z: p = a*v[X] - b*v[Y] with a = ey, b = ex
+    {
+      const __m128* va = v[z_pairs[eidx][0]];
+      const __m128* vb = v[z_pairs[eidx][1]];
+      __m128 p = _mm_sub_ps(_mm_mul_ps(ey, va[0]), _mm_mul_ps(ex, va[1]));
+      __m128 q = _mm_sub_ps(_mm_mul_ps(ey, vb[0]), _mm_mul_ps(ex, vb[1]));
+      SSE_AXIS_TEST(p, q, _mm_add_ps(_mm_mul_ps(fey, half[0]), _mm_mul_ps(fex, half[1])));
+    }
+  }
+
+  // overlap of the AABB of the triangles with the box
+  for(int dim = 0; dim < 3; ++dim) {
+    __m128 min_v = _mm_min_ps(_mm_min_ps(v[0][dim], v[1][dim]), v[2][dim]);
+    __m128 max_v = _mm_max_ps(_mm_max_ps(v[0][dim], v[1][dim]), v[2][dim]);
+    SSE_AXIS_TEST(min_v, max_v, half[dim]);
+  }
+#undef SSE_AXIS_TEST
+
+  // plane of the triangles against the box
+  __m128 normal[3];
+  normal[0] = _mm_sub_ps(_mm_mul_ps(e[0][1], e[1][2]), _mm_mul_ps(e[0][2], e[1][1]));
+  normal[1] = _mm_sub_ps(_mm_mul_ps(e[0][2], e[1][0]), _mm_mul_ps(e[0][0], e[1][2]));
+  normal[2] = _mm_sub_ps(_mm_mul_ps(e[0][0], e[1][1]), _mm_mul_ps(e[0][1], e[1][0]));
+  __m128 vmin[3], vmax[3];
+  for(int dim = 0; dim < 3; ++dim) {
+    __m128 pos = _mm_cmpgt_ps(normal[dim], zero);
+    __m128 lo = _mm_sub_ps(_mm_sub_ps(zero, half[dim]), v[0][dim]);
+    __m128 hi = _mm_sub_ps(half[dim], v[0][dim]);
+    vmin[dim] = _mm_blendv_ps(hi, lo, pos);
+    vmax[dim] = _mm_blendv_ps(lo, hi, pos);
+  }
+  __m128 dot_min = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normal[0], vmin[0]), _mm_mul_ps(normal[1], vmin[1])), _mm_mul_ps(normal[2], vmin[2]));
+  __m128 dot_max = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normal[0], vmax[0]), _mm_mul_ps(normal[1], vmax[1])), _mm_mul_ps(normal[2], vmax[2]));
+  alive = _mm_andnot_ps(_mm_cmpgt_ps(dot_min, zero), alive);
+  alive = _mm_and_ps(_mm_cmpge_ps(dot_max, zero), alive);
+
+  return _mm_movemask_ps(alive);
+}
+
+#endif
@@ -27,72 +27,36 @@
 #include <vector>
 #include <cstdio>
 
+#include <smmintrin.h>
+
 #if defined(_OPENMP)
 #include <omp.h>
 #endif
 
-#include "geometry_cpu.h"
+#include "octnet/geometry/geometry_cpu.h"
 
 
 int ray_casting_cpu(float3 vx_offset, float3 vx_width, int depth, int height, int width, float3 C, float3 ray, int** pos, float** ts) {
-  // // test if ray hits volume in general and where
-  // float3 vol_c;
-  // vol_c.x = vx_offset.x + width/2.f;
-  // vol_c.y = vx_offset.y + height/2.f;
-  // vol_c.z = vx_offset.z + depth/2.f;
-  // float3 vol_w;
-  // vol_w.x = width;
-  // vol_w.y = height;
-  // vol_w.z = depth;
-
-  // float thit;
-  // bool intersection = intersection_ray_voxel(C, ray, vol_c, vol_w, thit);
-  // if(!intersection) {
-  //   return 0;
-  // }
-
-  // //get first voxel
-  // float3 fst_vx;
-  // for(int idx = 0; idx < 3; ++idx) {
-  //   fst_vx[idx] = C[idx] + thit * ray[idx];
-  // }
-  // std::cout << fst_vx.x << ", " << fst_vx.y << ", " << fst_vx.z << std::endl;
-  
-  // this is the brute-force approach, but hey...
-  std::vector<int> ws;
-  std::vector<int> hs;
-  std::vector<int> ds;
+  std::vector<int> whds;
   std::vector<float> thits;
-  for(int d = 0; d < depth; ++d) {
-    for(int h = 0; h < height; ++h) {
-      for(int w = 0; w < width; ++w) {
-        float3 vx;
-        vx.x = w * vx_width.x + vx_width.x/2.f + vx_offset.x;
-        vx.y = h * vx_width.y + vx_width.y/2.f + vx_offset.y;
-        vx.z = d * vx_width.z + vx_width.z/2.f + vx_offset.z;
-
-        float thit;
-        bool intersection = intersection_ray_voxel(C, ray, vx, vx_width, thit);
-        // std::cout << "hit=" << intersection << " at " << vx.x << ", " << vx.y << ", " << vx.z << " | " << vx_width.x << ", " << vx_width.y << ", " << vx_width.z << std::endl;
-        if(intersection) {
-          ws.push_back(w);
-          hs.push_back(h);
-          ds.push_back(d);
-          thits.push_back(thit);
-        }
-      }
-    }
-  }
+  ray_casting_traverse_cpu(vx_offset, vx_width, depth, height, width, C, ray, 
+      [&](int w, int h, int d, float t) {
+        whds.push_back(w);
+        whds.push_back(h);
+        whds.push_back(d);
+        thits.push_back(t);
+        return true;
+      });
   
   //copy to parameter arrays
-  int n = ws.size();
+  int n = thits.size();
   if(n > 0) {
     (*pos) = new int[n * 3];
     (*ts) = new float[n];
     for(int idx = 0; idx < n; ++idx) {
-      (*pos)[idx * 3 + 0] = ws[idx];
-      (*pos)[idx * 3 + 1] = hs[idx];
-      (*pos)[idx * 3 + 2] = ds[idx];
+      (*pos)[idx * 3 + 0] = whds[idx * 3 + 0];
+      (*pos)[idx * 3 + 1] = whds[idx * 3 + 1];
+      (*pos)[idx * 3 + 2] = whds[idx * 3 + 2];
       (*ts)[idx] = thits[idx];
     }
     return n;
@@ -102,83 +66,206 @@ int ray_casting_cpu(float3 vx_offset, float3 vx_width, int depth, int height, in
 }
 
 
-void ray_casting_depth_map_max_cpu(const float* vxs, float3 vx_offset, float3 vx_width, int depth, int height, int width, float3 C, const float* Pi, float* im, int im_height, int im_width) {
-  #pragma omp parallel for
-  for(int v = 0; v < im_height; ++v) {
-    for(int u = 0; u < im_width; ++u) {
-      float3 ray;
-      ray.x = Pi[0] * u + Pi[1] * v + Pi[2];
-      ray.y = Pi[4] * u + Pi[5] * v + Pi[6];
-      ray.z = Pi[8] * u + Pi[9] * v + Pi[10];
-      float ray_norm = sqrt( ray.x*ray.x + ray.y*ray.y + ray.z*ray.z );
-      ray.x /= ray_norm;
-      ray.y /= ray_norm;
-      ray.z /= ray_norm;
-
-      int* vx_pos = 0;
-      float* ts = 0;
-      int vx_n = ray_casting_cpu(vx_offset, vx_width, depth, height, width, C, ray, &vx_pos, &ts);
-
-      float max_prob = 0;
-      float max_t = -1;
-      for(int vx_idx = 0; vx_idx < vx_n; ++vx_idx) {
-        int vx_x = vx_pos[vx_idx * 3 + 0];
-        int vx_y = vx_pos[vx_idx * 3 + 1];
-        int vx_z = vx_pos[vx_idx * 3 + 2];
-        float vx_prob = vxs[(vx_z * height + vx_y) * width + vx_x];
-        if(vx_prob > max_prob) {
-          max_prob = vx_prob;
-          max_t = ts[vx_idx];
-        }
-      }
+// computes the normalized viewing rays of the 4 pixels (u..u+3, v) of the 
+// camera C, Pi with SSE and clips them against the volume [vol_lo, vol_hi].
+// return value is the mask of the rays that hit the volume
+static int ray_packet_cpu(const float* C, const float* Pi, int u, int v, const float* vol_lo, const float* vol_hi, float3* rays) {
+  const __m128 us = _mm_add_ps(_mm_set1_ps(u), _mm_set_ps(3, 2, 1, 0));
+  const __m128 vs = _mm_set1_ps(v);
+  __m128 dirs[3];
+  for(int axis = 0; axis < 3; ++axis) {
+    dirs[axis] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(Pi[axis * 4 + 0]), us), 
+        _mm_mul_ps(_mm_set1_ps(Pi[axis * 4 + 1]), vs)), _mm_set1_ps(Pi[axis * 4 + 2]));
+  }
+  __m128 norm = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dirs[0], dirs[0]), 
+      _mm_mul_ps(dirs[1], dirs[1])), _mm_mul_ps(dirs[2], dirs[2])));
 
-      im[v * im_width + u] = max_t;
+  // slab test, rays parallel to an axis either miss or are not constrained
+  const __m128 eps = _mm_set1_ps(EPS);
+  const __m128 sign_mask = _mm_set1_ps(-0.f);
+  __m128 t_near = _mm_set1_ps(0);
+  __m128 t_far = _mm_set1_ps(1e30);
+  float lanes[3][4];
+  for(int axis = 0; axis < 3; ++axis) {
+    dirs[axis] = _mm_div_ps(dirs[axis], norm);
+    _mm_storeu_ps(lanes[axis], dirs[axis]);
+
+    __m128 c = _mm_set1_ps(C[axis]);
+    __m128 lo = _mm_sub_ps(_mm_set1_ps(vol_lo[axis]), c);
+    __m128 hi = _mm_sub_ps(_mm_set1_ps(vol_hi[axis]), c);
+    __m128 parallel = _mm_cmplt_ps(_mm_andnot_ps(sign_mask, dirs[axis]), eps);
+    __m128 t1 = _mm_div_ps(lo, dirs[axis]);
+    __m128 t2 = _mm_div_ps(hi, dirs[axis]);
+    __m128 inside = _mm_and_ps(_mm_cmple_ps(lo, _mm_set1_ps(0)), _mm_cmpge_ps(hi, _mm_set1_ps(0)));
+    __m128 near = _mm_blendv_ps(_mm_min_ps(t1, t2), _mm_blendv_ps(_mm_set1_ps(1e30), _mm_set1_ps(-1e30), inside), parallel);
+    __m128 far = _mm_blendv_ps(_mm_max_ps(t1, t2), _mm_set1_ps(1e30), parallel);
+    t_near = _mm_max_ps(t_near, near);
+    t_far = _mm_min_ps(t_far, far);
+  }
 
-      delete[] vx_pos;
-      delete[] ts;
+  for(int lane = 0; lane < 4; ++lane) {
+    rays[lane].x = lanes[0][lane];
+    rays[lane].y = lanes[1][lane];
+    rays[lane].z = lanes[2][lane];
+  }
+  return _mm_movemask_ps(_mm_cmple_ps(t_near, t_far));
+}
+
+// traverses the voxels of the rays in mask of a packet in lockstep, each 
+// lane steps as in ray_casting_traverse_cpu. for each step visit(vx_idx, t, 
+// active) is called with the linear voxel indices (d * height + h) * width + w,
+// the distances t where the rays enter the voxels and the mask of the lanes 
+// that are still inside the volume. only the active lanes of vx_idx are valid.
+template <typename Visitor>
+static void ray_packet_traverse_cpu(float3 vx_offset, float3 vx_width, int depth, int height, int width, float3 C, const float3* rays, int mask, Visitor visit) {
+  int idx[3][4], step[3][4];
+  float t_next[3][4], t_delta[3][4], t[4];
+  int active_lanes[4];
+  for(int lane = 0; lane < 4; ++lane) {
+    int lane_idx[3], lane_step[3];
+    float lane_t_next[3], lane_t_delta[3];
+    bool hit = (mask & (1 << lane)) && ray_casting_dda_init_cpu(vx_offset, vx_width, depth, height, width, C, rays[lane], lane_idx, lane_step, lane_t_next, lane_t_delta, &t[lane]);
+    active_lanes[lane] = hit ? -1 : 0;
+    for(int axis = 0; axis < 3; ++axis) {
+      idx[axis][lane] = hit ? lane_idx[axis] : 0;
+      step[axis][lane] = hit ? lane_step[axis] : 0;
+      t_next[axis][lane] = hit ? lane_t_next[axis] : 1e30;
+      t_delta[axis][lane] = hit ? lane_t_delta[axis] : 0;
     }
+    if(!hit) {
+      t[lane] = 0;
+    }
+  }
+
+  const int n[3] = {width, height, depth};
+  __m128i idxs[3], steps[3], n_max[3];
+  __m128 t_nexts[3], t_deltas[3];
+  for(int axis = 0; axis < 3; ++axis) {
+    idxs[axis] = _mm_loadu_si128((const __m128i*) idx[axis]);
+    steps[axis] = _mm_loadu_si128((const __m128i*) step[axis]);
+    n_max[axis] = _mm_set1_epi32(n[axis] - 1);
+    t_nexts[axis] = _mm_loadu_ps(t_next[axis]);
+    t_deltas[axis] = _mm_loadu_ps(t_delta[axis]);
+  }
+  __m128 ts = _mm_loadu_ps(t);
+  __m128i active = _mm_loadu_si128((const __m128i*) active_lanes);
+
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i heights = _mm_set1_epi32(height);
+  const __m128i widths = _mm_set1_epi32(width);
+  while(_mm_movemask_ps(_mm_castsi128_ps(active))) {
+    __m128i vx_idx = _mm_add_epi32(_mm_mullo_epi32(_mm_add_epi32(_mm_mullo_epi32(idxs[2], heights), idxs[1]), widths), idxs[0]);
+    visit(vx_idx, ts, _mm_castsi128_ps(active));
+
+    // per lane the axis of the nearest voxel boundary, as in the scalar DDA
+    __m128 lt01 = _mm_cmplt_ps(t_nexts[0], t_nexts[1]);
+    __m128 sel[3];
+    sel[0] = _mm_and_ps(lt01, _mm_cmplt_ps(t_nexts[0], t_nexts[2]));
+    sel[1] = _mm_andnot_ps(lt01, _mm_cmplt_ps(t_nexts[1], t_nexts[2]));
+    sel[2] = _mm_andnot_ps(_mm_or_ps(sel[0], sel[1]), _mm_castsi128_ps(_mm_cmpeq_epi32(zero, zero)));
+
+    __m128i leave = zero;
+    for(int axis = 0; axis < 3; ++axis) {
+      __m128i sel_axis = _mm_castps_si128(sel[axis]);
+      idxs[axis] = _mm_add_epi32(idxs[axis], _mm_and_si128(steps[axis], sel_axis));
+      // degenerate rays (step 0) and rays that leave the volume are done
+      __m128i out = _mm_or_si128(_mm_cmpeq_epi32(steps[axis], zero), 
+          _mm_or_si128(_mm_cmplt_epi32(idxs[axis], zero), _mm_cmpgt_epi32(idxs[axis], n_max[axis])));
+      leave = _mm_or_si128(leave, _mm_and_si128(out, sel_axis));
+      ts = _mm_blendv_ps(ts, t_nexts[axis], sel[axis]);
+      t_nexts[axis] = _mm_add_ps(t_nexts[axis], _mm_and_ps(t_deltas[axis], sel[axis]));
+    }
+    active = _mm_andnot_si128(leave, active);
   }
 }
 
-void ray_casting_depth_map_avg_cpu(const float* vxs, float3 vx_offset, float3 vx_width, int depth, int height, int width, float3 C, const float* Pi, float* im, int im_height, int im_width) {
+// loads vxs at the active lanes of vx_idx, the other lanes are 0
+static inline __m128 ray_packet_gather_cpu(const float* vxs, __m128i vx_idx, __m128 active) {
+  int idx[4];
+  _mm_storeu_si128((__m128i*) idx, vx_idx);
+  int mask = _mm_movemask_ps(active);
+  return _mm_set_ps((mask & 8) ? vxs[idx[3]] : 0, (mask & 4) ? vxs[idx[2]] : 0, 
+                    (mask & 2) ? vxs[idx[1]] : 0, (mask & 1) ? vxs[idx[0]] : 0);
+}
+
+// renders the depth maps of n_views cameras, the rays of each row are 
+// generated and clipped in packets of 4, depth_fcn(C, rays, mask, depths) 
+// computes the 4 depths of a packet, -1 for the rays that are not in mask
+template <typename DepthFcn>
+static void ray_casting_views_cpu(float3 vx_offset, float3 vx_width, int depth, int height, int width, int n_views, const float* Cs, const float* Pis, float* ims, int im_height, int im_width, DepthFcn depth_fcn) {
+  const int n[3] = {width, height, depth};
+  float vol_lo[3], vol_hi[3];
+  for(int axis = 0; axis < 3; ++axis) {
+    vol_lo[axis] = FMIN(vx_offset[axis], vx_offset[axis] + n[axis] * vx_width[axis]);
+    vol_hi[axis] = FMAX(vx_offset[axis], vx_offset[axis] + n[axis] * vx_width[axis]);
+  }
+
+  const int n_packets = (im_width + 3) / 4;
   #pragma omp parallel for
-  for(int v = 0; v < im_height; ++v) {
-    for(int u = 0; u < im_width; ++u) {
-      float3 ray;
-      ray.x = Pi[0] * u + Pi[1] * v + Pi[2];
-      ray.y = Pi[4] * u + Pi[5] * v + Pi[6];
-      ray.z = Pi[8] * u + Pi[9] * v + Pi[10];
-      float ray_norm = sqrt( ray.x*ray.x + ray.y*ray.y + ray.z*ray.z );
-      ray.x /= ray_norm;
-      ray.y /= ray_norm;
-      ray.z /= ray_norm;
-
-      int* vx_pos = 0;
-      float* ts = 0;
-      int vx_n = ray_casting_cpu(vx_offset, vx_width, depth, height, width, C, ray, &vx_pos, &ts);
-
-      float prob_sum = 0;
-      float t_sum = 0;
-      for(int vx_idx = 0; vx_idx < vx_n; ++vx_idx) {
-        int vx_x = vx_pos[vx_idx * 3 + 0];
-        int vx_y = vx_pos[vx_idx * 3 + 1];
-        int vx_z = vx_pos[vx_idx * 3 + 2];
-        float vx_prob = vxs[(vx_z * height + vx_y) * width + vx_x];
-        if(vx_prob > 0) {
-          prob_sum += vx_prob;
-          t_sum += ts[vx_idx];
-        }
-      }
+  for(int row = 0; row < n_views * im_height; ++row) {
+    const int view = row / im_height;
+    const int v = row % im_height;
+    const float* C = Cs + view * 3;
+    const float* Pi = Pis + view * 12;
+    float* im = ims + long(row) * im_width;
+    float3 c;
+    c.x = C[0];
+    c.y = C[1];
+    c.z = C[2];
 
-      if(prob_sum > 0) {
-        im[v * im_width + u] = t_sum / prob_sum;
-      }
-      else {
-        im[v * im_width + u] = -1;
+    float3 rays[4];
+    float depths[4];
+    for(int packet = 0; packet < n_packets; ++packet) {
+      int n_lanes = IMIN(4, im_width - packet * 4);
+      int mask = ray_packet_cpu(C, Pi, packet * 4, v, vol_lo, vol_hi, rays) & ((1 << n_lanes) - 1);
+      depth_fcn(c, rays, mask, depths);
+      for(int lane = 0; lane < n_lanes; ++lane) {
+        im[packet * 4 + lane] = depths[lane];
       }
-
-      delete[] vx_pos;
-      delete[] ts;
     }
   }
 }
+
+
+void ray_casting_depth_map_max_views_cpu(const float* vxs, float3 vx_offset, float3 vx_width, int depth, int height, int width, int n_views, const float* Cs, const float* Pis, float* ims, int im_height, int im_width) {
+  ray_casting_views_cpu(vx_offset, vx_width, depth, height, width, n_views, Cs, Pis, ims, im_height, im_width, 
+      [&](float3 C, const float3* rays, int mask, float* depths) {
+        __m128 max_prob = _mm_setzero_ps();
+        __m128 max_t = _mm_set1_ps(-1);
+        ray_packet_traverse_cpu(vx_offset, vx_width, depth, height, width, C, rays, mask, 
+            [&](__m128i vx_idx, __m128 t, __m128 active) {
+              __m128 vx_prob = ray_packet_gather_cpu(vxs, vx_idx, active);
+              __m128 upd = _mm_and_ps(active, _mm_cmpgt_ps(vx_prob, max_prob));
+              max_prob = _mm_blendv_ps(max_prob, vx_prob, upd);
+              max_t = _mm_blendv_ps(max_t, t, upd);
+            });
+        _mm_storeu_ps(depths, max_t);
+      });
+}
+
+void ray_casting_depth_map_avg_views_cpu(const float* vxs, float3 vx_offset, float3 vx_width, int depth, int height, int width, int n_views, const float* Cs, const float* Pis, float* ims, int im_height, int im_width) {
+  ray_casting_views_cpu(vx_offset, vx_width, depth, height, width, n_views, Cs, Pis, ims, im_height, im_width, 
+      [&](float3 C, const float3* rays, int mask, float* depths) {
+        __m128 prob_sum = _mm_setzero_ps();
+        __m128 t_sum = _mm_setzero_ps();
+        ray_packet_traverse_cpu(vx_offset, vx_width, depth, height, width, C, rays, mask, 
+            [&](__m128i vx_idx, __m128 t, __m128 active) {
+              __m128 vx_prob = ray_packet_gather_cpu(vxs, vx_idx, active);
+              __m128 pos = _mm_and_ps(active, _mm_cmpgt_ps(vx_prob, _mm_setzero_ps()));
+              prob_sum = _mm_add_ps(prob_sum, _mm_and_ps(vx_prob, pos));
+              t_sum = _mm_add_ps(t_sum, _mm_and_ps(t, pos));
+            });
+        __m128 hit = _mm_cmpgt_ps(prob_sum, _mm_setzero_ps());
+        _mm_storeu_ps(depths, _mm_blendv_ps(_mm_set1_ps(-1), _mm_div_ps(t_sum, prob_sum), hit));
+      });
+}
+
+void ray_casting_depth_map_max_cpu(const float* vxs, float3 vx_offset, float3 vx_width, int depth, int height, int width, float3 C, const float* Pi, float* im, int im_height, int im_width) {
+  const float Cs[] = {C.x, C.y, C.z};
+  ray_casting_depth_map_max_views_cpu(vxs, vx_offset, vx_width, depth, height, width, 1, Cs, Pi, im, im_height, im_width);
+}
+
+void ray_casting_depth_map_avg_cpu(const float* vxs, float3 vx_offset, float3 vx_width, int depth, int height, int width, float3 C, const float* Pi, float* im, int im_height, int im_width) {
+  const float Cs[] = {C.x, C.y, C.z};
+  ray_casting_depth_map_avg_views_cpu(vxs, vx_offset, vx_width, depth, height, width, 1, Cs, Pi, im, im_height, im_width);
+}
@@ -131,16 +131,20 @@ cdef extern from "../core/include/octnet/cpu/io.h":
   
   void octree_read_cpu(const char* path, octree* grid_h);
   void octree_write_cpu(const char* path, const octree* grid_h);
+  void octree_write_typed_cpu(const char* path, const octree* grid_h, int storage_type);
+  void octree_write_columnar_cpu(const char* path, const octree* grid_h, int storage_type);
   void octree_dhwc_write_cpu(const char* path, const octree* grid_h);
   void octree_cdhw_write_cpu(const char* path, const octree* grid_h);
 
   ot_data_t* dense_read_cpu(const char* path, int n_dim);
   void dense_read_prealloc_cpu(const char* path, int n_dim, const int* dims, ot_data_t* data);
   void dense_write_cpu(const char* path, int n_dim, const int* dims, const ot_data_t* data);
+  void dense_write_typed_cpu(const char* path, int n_dim, const int* dims, const ot_data_t* data, int storage_type);
 
 
 cdef extern from "../core/include/octnet/cpu/misc.h":
   void octree_determine_gt_split_cpu(const octree* struc, const ot_data_t* gt, octree* out);
+  void octree_merge_homogeneous_cpu(const octree* in_, ot_data_t eps, int n_threads, octree* out);
 
 cdef extern from "../core/include/octnet/cpu/pool.h":
   void octree_gridpool2x2x2_max_cpu(const octree* in_oc, octree* out);
@@ -163,6 +167,7 @@ cdef extern from "../create/include/octnet/create/create.h":
   octree* octree_create_from_obj_cpu(const char* path, ot_size_t depth, ot_size_t height, ot_size_t width, const float R[9], bool fit, int fit_multiply, bool pack, int pad, int n_threads);
   octree* octree_create_from_pc_simple_cpu(float* xyz, int n_pts, int feature_size, ot_size_t depth, ot_size_t height, ot_size_t width, bool normalize, bool normalize_inplace, bool fit, int fit_multiply, bool pack, int pad, int n_threads);
   octree* octree_create_from_pc_cpu(float* xyz, const float* features, int n_pts, int feature_size, ot_size_t depth, ot_size_t height, ot_size_t width, bool normalize, bool normalize_inplace, bool fit, int fit_multiply, bool pack, int pad, int n_threads);
+  octree* octree_create_from_pc_morton_cpu(float* xyz, const float* features, int n_pts, int feature_size, ot_size_t depth, ot_size_t height, ot_size_t width, bool normalize, bool normalize_inplace, bool fit, int fit_multiply, bool pack, int pad, int n_threads);
 
 cdef extern from "../create/include/octnet/create/utils.h":
   void octree_scanline_fill(octree* grid, ot_data_t fill_value);
@@ -199,10 +204,15 @@ def read_dense(char* path, float[:,:,:,:,::1] data):
 Writes a dense tensor to a binary file.
 @param path output path.
 @param data data tensor.
+@param storage_type optional storage type of the data section, 0=float32, 
+       1=float16, 2=uint8, 3=int8 (quantized per channel of the last dim).
 """
-def write_dense(char* path, float[:,:,:,:,::1] data):
+def write_dense(char* path, float[:,:,:,:,::1] data, storage_type=None):
   cdef int* dims = npy_shape_to_int_array(data.shape)
-  dense_write_cpu(path, 5, dims, &(data[0,0,0,0,0]))
+  if storage_type is None:
+    dense_write_cpu(path, 5, dims, &(data[0,0,0,0,0]))
+  else:
+    dense_write_typed_cpu(path, 5, dims, &(data[0,0,0,0,0]), storage_type)
   free(dims)
 
 """
@@ -541,9 +551,23 @@ cdef class Octree:
   """
   Serializes the octree to a binary file.
   @param path
+  @param storage_type optional storage type of the data section, 0=float32, 
+         1=float16, 2=uint8, 3=int8 (quantized per feature channel).
   """
-  def write_bin(self, char* path):
-    octree_write_cpu(path, self.grid)
+  def write_bin(self, char* path, storage_type=None):
+    if storage_type is None:
+      octree_write_cpu(path, self.grid)
+    else:
+      octree_write_typed_cpu(path, self.grid, storage_type)
+
+  """
+  Serializes the octree to a binary file in the channel-major layout, which
+  allows to read the structure, or a subset of the channels only.
+  @param path
+  @param storage_type storage type of the data sections, @see write_bin.
+  """
+  def write_bin_columnar(self, char* path, storage_type=0):
+    octree_write_columnar_cpu(path, self.grid, storage_type)
 
   """
   First converts the octree to a tensor and then serializes the tensor to a 
@@ -568,6 +592,17 @@ cdef class Octree:
       raise Exception('n does not match')
     octree_determine_gt_split_cpu(self.grid, &(gt[0,0,0,0]), out.grid)
 
+  """
+  Merges all subtrees of this instance, whose leafs have features that differ
+  by at most eps, and stores the result in out.
+  @see octree_merge_homogeneous_cpu for more details.
+  @param eps
+  @param out
+  @param n_threads
+  """
+  def merge_homogeneous(self, float eps, Octree out, int n_threads=1):
+    octree_merge_homogeneous_cpu(self.grid, eps, n_threads, out.grid)
+
   """ 
   Applies 2x2x2 grid pooling (max) on this instance and stores the result in the
   provided out octree. out is resized as needed in this function.
@@ -772,6 +807,33 @@ cdef class Octree:
     grid.set_grid(ret)
     return grid
 
+  """
+  Class method to create an octree structure from point cloud like 
+  create_from_pc, but the points are quantized to voxels and sorted by their
+  Morton code, which is considerably faster for large point clouds. A point
+  on a voxel boundary is assigned to a single voxel.
+  @param xyz Nx3 contiguous float array for the xyz coordinates of the pointcloud.
+  @param features Nxfs contiguous float array that represents a feature vector
+                  for each 3D point.
+  @param depth number of voxel in depth dimension the octree should comprise.
+  @param height number of voxel in height dimension the octree should comprise.
+  @param width number of voxel in width dimension the octree should comprise.
+  @param normalize if True, the point cloud gets scaled and shifted to fit
+                   within the bounding volume.
+  @param normalize_inplace if True, the normalization is done inplace (xyz).
+  @param n_threads number of CPU threads that should be used for this function.
+  """
+  @classmethod
+  def create_from_pc_morton(cls, float[:,::1] xyz, float[:,::1] features, ot_size_t depth, ot_size_t height, ot_size_t width, bool normalize, bool normalize_inplace=True, bool fit=False, int fit_multiply=1, bool pack=False, int pad=0, int n_threads=1):
+    if xyz.shape[0] != features.shape[0]:
+      raise Exception('rows of xyz and features differ')
+    if xyz.shape[1] != 3:
+      raise Exception('xyz must have 3 columns (xyz)')
+    cdef octree* ret = octree_create_from_pc_morton_cpu(&(xyz[0,0]), &(features[0,0]), xyz.shape[0], features.shape[1], depth, height, width, normalize, normalize_inplace, fit, fit_multiply, pack, pad, n_threads)
+    cdef Octree grid = Octree()
+    grid.set_grid(ret)
+    return grid
+
   """
   Given a voxelized octree uses parity count from the three orthogonal views
   to fill the occupancy grid. For example, create_from_mesh and others only
@@ -58,6 +58,7 @@ setup(
        '../create/src/create_obj.cpp',
        '../create/src/create_off.cpp',
        '../create/src/create_pc.cpp',
+       '../create/src/mesh_io.cpp',
        '../create/src/utils.cpp',
        '../create/src/dense.cpp',
         ],
@@ -25,30 +25,67 @@
 
 local OctreeBatchNormalization, parent = torch.class('oc.OctreeBatchNormalization', 'oc.OctreeModule')
 
-function OctreeBatchNormalization:__init(nInputPlane)
+-- avgs and vars are the statistics of the last training batch, running_mean
+-- and running_var their exponential moving averages with the given momentum.
+-- In evaluate mode the input is normalized with the running statistics. 
+-- Modules saved before the running statistics existed have none, they keep 
+-- normalizing with the statistics of the current batch in evaluate mode, and
+-- the running statistics are created from the first batch they are trained on.
+function OctreeBatchNormalization:__init(nInputPlane, momentum)
   parent.__init(self)
   
   self.nInputPlane = nInputPlane or error('need to specify nInputPlane')
+  self.momentum = momentum or 0.1
 
   self.avgs = torch.Tensor(nInputPlane)
   self.vars = torch.Tensor(nInputPlane)
+  self.running_mean = torch.Tensor(nInputPlane)
+  self.running_var = torch.Tensor(nInputPlane)
   self:reset()
 end
 
 function OctreeBatchNormalization:reset(stdv)
   self.avgs:fill(0)
   self.vars:fill(0)
+  if self.running_mean then
+    self.running_mean:fill(0)
+    self.running_var:fill(1)
+  end
 end
 
 function OctreeBatchNormalization:updateOutput(input)
   if input:feature_size() ~= self.nInputPlane then error('invalid input size') end
   
   -- print('[INFO] OctreeBatchNormalization updateOutput Start')
+  if self.train == false and self.running_mean then
+    -- (x - mean) / sqrt(var + eps) as scale and shift, eps as in bn.cpp
+    local scale = self.running_var:clone():add(1e-12):pow(-0.5)
+    local shift = torch.cmul(self.running_mean, scale):mul(-1)
+    if input._type == 'oc_float' then
+      oc.cpu.octree_bn_ss_cpu(input.grid, scale:data(), shift:data(), false, self.output.grid)
+    elseif input._type == 'oc_cuda' then
+      oc.gpu.octree_bn_ss_gpu(input.grid, scale:data(), shift:data(), false, self.output.grid)
+    end
+    return self.output
+  end
+
   if input._type == 'oc_float' then
     oc.cpu.octree_bn_norm_cpu(input.grid, self.avgs:data(), self.vars:data(), self.output.grid)
   elseif input._type == 'oc_cuda' then
     oc.gpu.octree_bn_norm_gpu(input.grid, self.avgs:data(), self.vars:data(), self.output.grid)
   end
+  if self.train == false then
+    return self.output
+  end
+
+  if not self.running_mean then
+    self.momentum = self.momentum or 0.1
+    self.running_mean = self.avgs:clone()
+    self.running_var = self.vars:clone()
+  else
+    self.running_mean:mul(1 - self.momentum):add(self.momentum, self.avgs)
+    self.running_var:mul(1 - self.momentum):add(self.momentum, self.vars)
+  end
   -- print('[INFO] OctreeBatchNormalization updateOutput End')
 
   return self.output
@@ -0,0 +1,127 @@
+-- Copyright (c) 2017, The OctNet authors
+-- All rights reserved.
+--
+-- Redistribution and use in source and binary forms, with or without
+-- modification, are permitted provided that the following conditions are met:
+--     * Redistributions of source code must retain the above copyright
+--       notice, this list of conditions and the following disclaimer.
+--     * Redistributions in binary form must reproduce the above copyright
+--       notice, this list of conditions and the following disclaimer in the
+--       documentation and/or other materials provided with the distribution.
+--     * Neither the name of the <organization> nor the
+--       names of its contributors may be used to endorse or promote products
+--       derived from this software without specific prior written permission.
+--
+-- THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+-- ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+-- WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+-- DISCLAIMED. IN NO EVENT SHALL OCTNET AUTHORS BE LIABLE FOR ANY
+-- DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+-- (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+-- LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+-- ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+-- (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+-- SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+local OctreeBatchNormalizationAffine, parent = torch.class('oc.OctreeBatchNormalizationAffine', 'oc.OctreeModule')
+
+-- Batch normalization followed by scale and shift in one module, i.e. 
+-- OctreeBatchNormalization and OctreeBatchNormalizationSS. On the cpu the 
+-- forward pass (statistics, normalize, scale and shift) and the backward pass 
+-- (gradInput, gradGamma and gradBeta) run the fused kernels octree_bn_cpu and
+-- octree_bn_bwd_cpu with two sweeps over the data each, on the gpu the 
+-- separate kernels are chained.
+function OctreeBatchNormalizationAffine:__init(nInputPlane, momentum)
+  parent.__init(self)
+  
+  self.nInputPlane = nInputPlane or error('need to specify nInputPlane')
+  self.momentum = momentum or 0.1
+
+  self.avgs = torch.Tensor(nInputPlane)
+  self.vars = torch.Tensor(nInputPlane)
+  self.running_mean = torch.Tensor(nInputPlane)
+  self.running_var = torch.Tensor(nInputPlane)
+  self.gamma = torch.Tensor(nInputPlane)
+  self.beta = torch.Tensor(nInputPlane)
+  self.gradGamma = torch.Tensor(nInputPlane)
+  self.gradBeta = torch.Tensor(nInputPlane)
+  -- parameter gradients of the last updateGradInput, the fused backward 
+  -- computes them together with gradInput
+  self.bufGradGamma = torch.Tensor(nInputPlane)
+  self.bufGradBeta = torch.Tensor(nInputPlane)
+  self:reset()
+end
+
+function OctreeBatchNormalizationAffine:reset(stdv)
+  stdv = stdv or 1.0/self.nInputPlane
+
+  self.avgs:fill(0)
+  self.vars:fill(0)
+  self.running_mean:fill(0)
+  self.running_var:fill(1)
+  self.gamma:uniform(-stdv, stdv)
+  self.beta:uniform(-stdv, stdv)
+end
+
+function OctreeBatchNormalizationAffine:parameters()
+  return {self.gamma, self.beta}, {self.gradGamma, self.gradBeta}
+end
+
+-- octree that holds the normalized input for the chained gpu kernels
+function OctreeBatchNormalizationAffine:normalizedBuffer(input)
+  if not self.normalized or self.normalized._type ~= input._type then
+    self.normalized = input:new()
+  end
+  return self.normalized
+end
+
+function OctreeBatchNormalizationAffine:updateOutput(input)
+  if input:feature_size() ~= self.nInputPlane then error('invalid input size') end
+  
+  if self.train == false then
+    -- gamma * (x - mean) / sqrt(var + eps) + beta as one scale and shift
+    local scale = self.running_var:clone():add(1e-12):pow(-0.5):cmul(self.gamma)
+    local shift = torch.cmul(self.running_mean, scale):mul(-1):add(self.beta)
+    if input._type == 'oc_float' then
+      oc.cpu.octree_bn_ss_cpu(input.grid, scale:data(), shift:data(), false, self.output.grid)
+    elseif input._type == 'oc_cuda' then
+      oc.gpu.octree_bn_ss_gpu(input.grid, scale:data(), shift:data(), false, self.output.grid)
+    end
+    return self.output
+  end
+
+  if input._type == 'oc_float' then
+    oc.cpu.octree_bn_cpu(input.grid, self.avgs:data(), self.vars:data(), self.gamma:data(), self.beta:data(), self.output.grid)
+  elseif input._type == 'oc_cuda' then
+    local normalized = self:normalizedBuffer(input)
+    oc.gpu.octree_bn_norm_gpu(input.grid, self.avgs:data(), self.vars:data(), normalized.grid)
+    oc.gpu.octree_bn_ss_gpu(normalized.grid, self.gamma:data(), self.beta:data(), false, self.output.grid)
+  end
+  self.running_mean:mul(1 - self.momentum):add(self.momentum, self.avgs)
+  self.running_var:mul(1 - self.momentum):add(self.momentum, self.vars)
+
+  return self.output
+end 
+
+function OctreeBatchNormalizationAffine:updateGradInput(input, gradOutput)
+  self.bufGradGamma:zero()
+  self.bufGradBeta:zero()
+
+  if input._type == 'oc_float' then
+    oc.cpu.octree_bn_bwd_cpu(input.grid, gradOutput.grid, self.avgs:data(), self.vars:data(), self.gamma:data(), 
+        self.gradInput.grid, self.bufGradGamma:data(), self.bufGradBeta:data())
+  elseif input._type == 'oc_cuda' then
+    local normalized = self:normalizedBuffer(input)
+    oc.gpu.octree_bn_ss_wbwd_gpu(normalized.grid, gradOutput.grid, self.bufGradGamma:data(), self.bufGradBeta:data())
+    oc.gpu.octree_bn_ss_bwd_gpu(gradOutput.grid, self.gamma:data(), false, normalized.grid)
+    oc.gpu.octree_bn_norm_bwd_gpu(input.grid, normalized.grid, self.avgs:data(), self.vars:data(), self.gradInput.grid)
+  end
+  
+  return self.gradInput
+end
+
+function OctreeBatchNormalizationAffine:accGradParameters(input, gradOutput, scale)
+  scale = scale or 1
+  self.gradGamma:add(scale, self.bufGradGamma)
+  self.gradBeta:add(scale, self.bufGradBeta)
+end
@@ -110,3 +110,29 @@ function OctreeConvolution3x3x3:accGradParameters(input, gradOutput, scale)
     error('unknown reduce function: '..self.rdc_fcn)
   end
 end
+
+-- Folds the running statistics of the following OctreeBatchNormalization bn 
+-- and the optional OctreeBatchNormalizationSS ss into weight and bias of this
+-- layer, both can then be removed from the network for inference. bn can also
+-- be an OctreeBatchNormalizationAffine, which brings its own scale and shift.
+-- A bn saved before the running statistics existed is folded with the 
+-- statistics of its last training batch. Only rdc_fcn 'avg' is supported, 
+-- 'sum' scales the bias with the leaf size.
+function OctreeConvolution3x3x3:foldBatchNormalization(bn, ss)
+  if self.rdc_fcn ~= 'avg' then
+    error('foldBatchNormalization requires rdc_fcn avg, got: '..self.rdc_fcn)
+  end
+  ss = ss or (bn.gamma and bn or nil)
+  local weight = self.weight:float()
+  local bias = self.bias:float()
+  local avgs = (bn.running_mean or bn.avgs):float()
+  local vars = (bn.running_var or bn.vars):float()
+  local gamma = ss and ss.gamma:float() or nil
+  local beta = ss and ss.beta:float() or nil
+  oc.cpu.octree_bn_fold_conv3x3x3_cpu(weight:data(), bias:data(), self.nInputPlane, self.nOutputPlane, 
+      avgs:data(), vars:data(), gamma and gamma:data() or nil, beta and beta:data() or nil, 
+      weight:data(), bias:data())
+  self.weight:copy(weight)
+  self.bias:copy(bias)
+  return self
+end
@@ -35,6 +35,16 @@ function OctreePool2x2x2:__init(pool_fcn, level_0, level_1, level_2)
 end
 
 
+-- offsets of the maxima recorded by the cpu forward pass for the backward pass,
+-- kept as IntTensor independent of the module type
+function OctreePool2x2x2:argmaxBuffer(input)
+  if torch.type(self.argmax) ~= 'torch.IntTensor' then
+    self.argmax = torch.IntTensor()
+  end
+  self.argmax:resize(math.max(1, input:n_leafs() * input:feature_size()))
+  return self.argmax
+end
+
 function OctreePool2x2x2:updateOutput(input)
   if self.pool_fcn == 'avg' then
     if input._type == 'oc_float' then
@@ -44,7 +54,7 @@ function OctreePool2x2x2:updateOutput(input)
     end
   elseif self.pool_fcn == 'max' then
     if input._type == 'oc_float' then
-      oc.cpu.octree_pool2x2x2_max_cpu(input.grid, self.level_0, self.level_1, self.level_2, self.output.grid)
+      oc.cpu.octree_pool2x2x2_max_argmax_cpu(input.grid, self.level_0, self.level_1, self.level_2, self.output.grid, self:argmaxBuffer(input):data())
     elseif input._type == 'oc_cuda' then
       oc.gpu.octree_pool2x2x2_max_gpu(input.grid, self.level_0, self.level_1, self.level_2, self.output.grid)
     end
@@ -65,7 +75,7 @@ function OctreePool2x2x2:updateGradInput(input, gradOutput)
     end
   elseif self.pool_fcn == 'max' then
     if input._type == 'oc_float' then
-      oc.cpu.octree_pool2x2x2_max_bwd_cpu(input.grid, gradOutput.grid, self.gradInput.grid)
+      oc.cpu.octree_pool2x2x2_max_argmax_bwd_cpu(input.grid, gradOutput.grid, self.argmax:data(), self.gradInput.grid)
     elseif input._type == 'oc_cuda' then
       oc.gpu.octree_pool2x2x2_max_bwd_gpu(input.grid, gradOutput.grid, self.gradInput.grid)
     end
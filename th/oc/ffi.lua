@@ -119,10 +119,16 @@ void octree_resize_as_cpu(const octree* src, octree* dst);
 
 void octree_read_cpu(const char* path, octree* grid_h);
 void octree_write_cpu(const char* path, const octree* grid_h);
+void octree_write_typed_cpu(const char* path, const octree* grid_h, int storage_type);
 void octree_read_batch_cpu(int n_paths, const char** paths, int n_threads, octree* grid_h);
+void octree_read_n_leafs_batch_cpu(int n_paths, const char** paths, int n_threads, ot_size_t* n_leafs);
+void octree_write_columnar_cpu(const char* path, const octree* grid_h, int storage_type);
+void octree_read_structure_cpu(const char* path, octree* grid_h);
+void octree_read_channels_cpu(const char* path, int n_channels, const int* channels, int n_threads, octree* grid_h);
 void octree_dhwc_write_cpu(const char* path, const octree* grid_h);
 void octree_cdhw_write_cpu(const char* path, const octree* grid_h);
 void dense_write_cpu(const char* path, int n_dim, const int* dims, const ot_data_t* data);
+void dense_write_typed_cpu(const char* path, int n_dim, const int* dims, const ot_data_t* data, int storage_type);
 ot_data_t* dense_read_cpu(const char* path, int n_dim);
 void dense_read_prealloc_cpu(const char* path, int n_dim, const int* dims, ot_data_t* data);
 void dense_read_prealloc_batch_cpu(int n_paths, const char** paths, int n_threads, int n_dim, const int* dims, ot_data_t* data); 
@@ -155,16 +161,23 @@ void octree_bn_ss_cpu(const octree* grid_in, ot_data_t *gamma, ot_data_t *beta,
 void octree_bn_norm_bwd_cpu(const octree* grid_in, const octree* grad_out, ot_data_t* avgs, ot_data_t* vars, octree* grad_in);
 void octree_bn_ss_bwd_cpu(const octree* grad_out, ot_data_t* gamma, bool inplace, octree* grad_in);
 void octree_bn_ss_wbwd_cpu(const octree* grid_in, const octree* grad_out, ot_data_t* grad_gamma, ot_data_t* grad_beta);
+void octree_bn_cpu(const octree* grid_in, ot_data_t* avgs, ot_data_t* vars, const ot_data_t* gamma, const ot_data_t* beta, octree* grid_out);
+void octree_bn_bwd_cpu(const octree* grid_in, const octree* grad_out, const ot_data_t* avgs, const ot_data_t* vars, const ot_data_t* gamma, octree* grad_in, ot_data_t* grad_gamma, ot_data_t* grad_beta);
+void octree_bn_fold_conv3x3x3_cpu(const ot_data_t* weights, const ot_data_t* bias, int channels_in, int channels_out, const ot_data_t* avgs, const ot_data_t* vars, const ot_data_t* gamma, const ot_data_t* beta, ot_data_t* weights_folded, ot_data_t* bias_folded);
 
 void octree_pool2x2x2_avg_cpu(const octree* in, bool level_0, bool level_1, bool level_2, octree* out);
 void octree_pool2x2x2_max_cpu(const octree* in, bool level_0, bool level_1, bool level_2, octree* out);
 void octree_pool2x2x2_avg_bwd_cpu(const octree* grid_in, const octree* grid_grad_out, octree* grid_grad_in);
 void octree_pool2x2x2_max_bwd_cpu(const octree* grid_in, const octree* grid_grad_out, octree* grid_grad_in);
+void octree_pool2x2x2_max_argmax_cpu(const octree* in, bool level_0, bool level_1, bool level_2, octree* out, int* argmax);
+void octree_pool2x2x2_max_argmax_bwd_cpu(const octree* in, const octree* grad_out, const int* argmax, octree* grad_in);
 
 void octree_gridpool2x2x2_avg_cpu(const octree* in, octree* out);
 void octree_gridpool2x2x2_max_cpu(const octree* in, octree* out);
 void octree_gridpool2x2x2_avg_bwd_cpu(const octree* in, const octree* grad_out, octree* grad_in);
 void octree_gridpool2x2x2_max_bwd_cpu(const octree* in, const octree* grad_out, octree* grad_in);
+void octree_gridpool2x2x2_max_argmax_cpu(const octree* in, octree* out, int* argmax);
+void octree_gridpool2x2x2_max_argmax_bwd_cpu(const octree* in, const octree* grad_out, const int* argmax, octree* grad_in);
 
 void octree_gridunpool2x2x2_cpu(const octree* in, octree* out);
 void octree_gridunpool2x2x2_bwd_cpu(const octree* in, const octree* grad_out, octree* grad_in);
@@ -198,6 +211,7 @@ void octree_combine_n_cpu(const octree** in, const int n, octree* out);
 void octree_extract_n_cpu(const octree* in, int from, int to, octree* out);
 void octree_mask_by_label_cpu(const octree* labels, int mask_label, bool check, octree* values);
 void octree_determine_gt_split_cpu(const octree* struc, const ot_data_t* gt, octree* out);
+void octree_merge_homogeneous_cpu(const octree* in, ot_data_t eps, int n_threads, octree* out);
 
 ot_data_t octree_mse_loss_cpu(const octree* input, const octree* target, bool size_average, bool check);
 void octree_mse_loss_bwd_cpu(const octree* input, const octree* target, bool size_average, bool check, octree* grad);
@@ -234,6 +248,13 @@ octree* octree_create_from_dense_features_cpu(const ot_data_t* data, int depth,
 
 octree* octree_create_from_dense_features_batch_inverted_cpu(const ot_data_t* data, int batch_size, int depth, int height, int width, int feature_size, ot_data_t tr_dist, bool fit, int fit_mulitply, bool pack, int n_threads);
 octree* octree_create_from_dense_features_inverted_cpu(const ot_data_t* data, int depth, int height, int width, int feature_size, ot_data_t tr_dist, bool fit, int fit_multiply, bool pack, int n_threads);
+
+typedef struct OctreeCacheCpu OctreeCacheCpu;
+OctreeCacheCpu* octree_cache_new_cpu(long max_bytes, const char* cache_dir);
+void octree_cache_free_cpu(OctreeCacheCpu* cache);
+void octree_cache_stats_cpu(const OctreeCacheCpu* cache, long* n_hits, long* n_misses, long* n_bytes);
+octree* octree_create_from_dense_features_batch_cached_cpu(OctreeCacheCpu* cache, int n_paths, char** paths, const ot_data_t* data, int depth, int height, int width, int feature_size, ot_data_t tr_dist, bool fit, int fit_multiply, bool pack, int n_threads);
+octree* octree_create_from_dense_batch_cached_cpu(OctreeCacheCpu* cache, int n_paths, char** paths, const ot_data_t* data, int depth, int height, int width, int n_ranges, const ot_data_t* ranges, bool fit, int fit_multiply, bool pack, int n_threads);
 ]]
 
 --------------------------------------------------------------------------------
@@ -64,6 +64,7 @@ include('OctreeSplitCriterion.lua')
 include('OctreeDummyCriterion.lua')
 include('OctreeBatchNormalization.lua')
 include('OctreeBatchNormalizationSS.lua')
+include('OctreeBatchNormalizationAffine.lua')
 include('VolumetricNNUpsampling.lua')
 
 
@@ -30,11 +30,21 @@ function oc.isOctree(t)
   return t == 'oc.FloatOctree' or t == 'oc.CudaOctree' or t == 'oc.Octree'
 end
 
-function oc.write_dense_to_bin(path, dense)
+-- storage types for the data section of written .oc and dense files
+oc.STORAGE_FLOAT32 = 0
+oc.STORAGE_FLOAT16 = 1
+oc.STORAGE_UINT8 = 2
+oc.STORAGE_INT8 = 3
+
+function oc.write_dense_to_bin(path, dense, storage_type)
   local sz = {}
   for idx = 1, dense:nDimension() do table.insert(sz, dense:size(idx)) end
   local dims = ffi.new("int[?]", dense:nDimension(), sz)
-  oc.cpu.dense_write_cpu(path, dense:nDimension(), dims, dense:data())
+  if storage_type then
+    oc.cpu.dense_write_typed_cpu(path, dense:nDimension(), dims, dense:data(), storage_type)
+  else
+    oc.cpu.dense_write_cpu(path, dense:nDimension(), dims, dense:data())
+  end
 end 
 
 function oc.read_dense_from_bin(path, dense)
@@ -54,6 +64,19 @@ function oc.read_dense_from_bin_batch(paths, dense, n_threads)
   paths_c[#paths] = nil
   oc.cpu.dense_read_prealloc_batch_cpu(#paths, paths_c, n_threads, dense:nDimension(), dims, dense:data())
   return dense
+end
+
+--- Reads n_leafs from the headers of the given octree files.
+-- @return table of n_leafs per path
+function oc.read_n_leafs_from_bin_batch(paths, n_threads)
+  local n_threads = n_threads or 1
+  local paths_c = ffi.new("const char*[?]", #paths+1, paths)
+  paths_c[#paths] = nil
+  local n_leafs_c = ffi.new("ot_size_t[?]", #paths)
+  oc.cpu.octree_read_n_leafs_batch_cpu(#paths, paths_c, n_threads, n_leafs_c)
+  local n_leafs = {}
+  for idx = 1, #paths do n_leafs[idx] = tonumber(n_leafs_c[idx-1]) end
+  return n_leafs
 end 
 
 
@@ -81,6 +104,21 @@ local function oc_float_gc_wrapper(obj)
   return obj
 end
 
+--- Two-level cache (memory LRU and optional directory) of created octrees.
+-- @param max_bytes maximum number of bytes held in memory
+-- @param cache_dir optional directory for the on-disk cache
+local OctreeCache = torch.class('oc.OctreeCache')
+function OctreeCache:__init(max_bytes, cache_dir)
+  self.cache = ffi.gc(oc.cpu.octree_cache_new_cpu(max_bytes, cache_dir), oc.cpu.octree_cache_free_cpu)
+end
+
+--- @return number of hits, misses and bytes held in memory
+function OctreeCache:stats()
+  local stats = ffi.new('long[3]')
+  oc.cpu.octree_cache_stats_cpu(self.cache, stats, stats + 1, stats + 2)
+  return tonumber(stats[0]), tonumber(stats[1]), tonumber(stats[2])
+end
+
 local Octree = torch.class('oc.Octree')
 function Octree:__init(oc_type)
   self._type = oc_type
@@ -183,6 +221,28 @@ function FloatOctree:octree_create_from_dense_features_batch(array, tr_dist)
   return grid
 end
 
+--- Create a octree batch from a dense array, reusing octrees created in
+-- earlier epochs from the cache.
+-- @param cache oc.OctreeCache
+-- @param paths table of the sample paths, identifies the samples in the cache
+-- @param array Torch tensor with dimensions (batch, depth, height, width, feature_size) 
+function FloatOctree:octree_create_from_dense_features_batch_cached(cache, paths, array, tr_dist)
+  if array:nDimension() ~= 5 or array:size(1) ~= #paths then
+    error('invalid tensor in create_from_dense_features_batch_cached')
+  end
+
+  local c_paths = ffi.new('char*[?]', #paths)
+  local c_strs = {}
+  for idx = 1, #paths do
+    c_strs[idx] = ffi.new('char[?]', #paths[idx] + 1, paths[idx])
+    c_paths[idx-1] = c_strs[idx]
+  end
+
+  local grid = oc.FloatOctree()
+  grid.grid = oc_float_gc_wrapper( oc.cpu.octree_create_from_dense_features_batch_cached_cpu(cache.cache, #paths, c_paths, array:data(), array:size(2), array:size(3), array:size(4), array:size(5), tr_dist, false, 0, false, 4) )
+  return grid
+end
+
 function FloatOctree:octree_create_from_dense_features_batch_inverted(array, tr_dist)
   if array:nDimension() ~= 5 then
     error('invalid tensor in create_from_dense_batch')
@@ -458,12 +518,44 @@ function Octree:read_from_bin_batch(paths, n_threads)
   return self
 end
 
-function Octree:write_to_bin(path)
+function Octree:read_structure_from_bin(path)
+  oc.cpu.octree_read_structure_cpu(path, self.grid)
+  if self._type == 'oc_cuda' then
+    self.grid = oc_cuda_gc_wrapper( oc.gpu.octree_to_gpu(self.grid) )
+  end
+  return self
+end
+
+-- channels is a table of 1-based feature channel indices
+function Octree:read_channels_from_bin(path, channels, n_threads)
+  local n_threads = n_threads or 1
+  local channels_c = ffi.new("int[?]", #channels)
+  for idx = 1, #channels do channels_c[idx-1] = channels[idx] - 1 end
+  oc.cpu.octree_read_channels_cpu(path, #channels, channels_c, n_threads, self.grid)
+  if self._type == 'oc_cuda' then
+    self.grid = oc_cuda_gc_wrapper( oc.gpu.octree_to_gpu(self.grid) )
+  end
+  return self
+end
+
+function Octree:write_to_bin_columnar(path, storage_type)
+  local grid = self
+  if self._type == 'oc_cuda' then
+    grid = grid:float()
+  end
+  oc.cpu.octree_write_columnar_cpu(path, grid.grid, storage_type or oc.STORAGE_FLOAT32)
+end
+
+function Octree:write_to_bin(path, storage_type)
   local grid = self
   if self._type == 'oc_cuda' then
     grid = grid:float()
   end
-  oc.cpu.octree_write_cpu(path, grid.grid)
+  if storage_type then
+    oc.cpu.octree_write_typed_cpu(path, grid.grid, storage_type)
+  else
+    oc.cpu.octree_write_cpu(path, grid.grid)
+  end
 end
 
 function Octree:tree_child_bit_idx(bit_idx) 
@@ -752,4 +844,19 @@ function Octree:determine_gt_split(gt, out)
   return out
 end
 
+-- merges subtrees whose leafs differ by at most eps, see octree_merge_homogeneous_cpu
+function Octree:merge_homogeneous(eps, out, n_threads)
+  local eps = eps or 0
+  local out = out or self:new()
+  local n_threads = n_threads or 1
+
+  if self._type == 'oc_float' then
+    oc.cpu.octree_merge_homogeneous_cpu(self.grid, eps, n_threads, out.grid)
+  elseif self._type == 'oc_cuda' then
+    error('not implemented')
+  end
+
+  return out
+end
+
 
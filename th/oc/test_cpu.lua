@@ -1145,6 +1145,129 @@ function octest.OctreeSplit()
 end
 
 
+function octest.OctreeBatchNormalization()
+  local function test(grid_a, grid_b)
+    local fs = grid_a:feature_size()
+
+    -- with momentum 1 the running statistics are the ones of the last batch
+    local bn = oc.OctreeBatchNormalization(fs, 1):float()
+    local out_train = bn:forward(grid_a):clone()
+    local mean = bn.running_mean:clone()
+    local var = bn.running_var:clone()
+    mytester:assert(torch.abs(mean - bn.avgs):max() < 1e-6, 'error in OctreeBatchNormalization running_mean')
+
+    bn:evaluate()
+    mytester:assert(bn:forward(grid_a):equals(out_train, 1e-4), 'error in OctreeBatchNormalization evaluate')
+
+    -- evaluate normalizes another input with the running statistics
+    local in_d = oc.OctreeToCDHW():forward(grid_b)
+    local out_d = oc.OctreeToCDHW():forward(bn:forward(grid_b))
+    for c = 1, fs do
+      local ref = in_d:select(2, c):clone():add(-mean[c]):div(math.sqrt(var[c] + 1e-12))
+      local err = torch.abs(out_d:select(2, c) - ref):max()
+      mytester:assert(err < 1e-4, 'error in OctreeBatchNormalization evaluate err='..err)
+    end
+
+    -- modules without running statistics normalize with the batch statistics
+    bn.running_mean = nil
+    bn.running_var = nil
+    bn.momentum = nil
+    local out_b = oc.OctreeBatchNormalization(fs):float():forward(grid_b)
+    mytester:assert(bn:forward(grid_b):equals(out_b, 1e-5), 'error in OctreeBatchNormalization evaluate without running statistics')
+    mytester:assert(bn.running_mean == nil, 'error in OctreeBatchNormalization evaluate without running statistics')
+    bn:training()
+    bn:forward(grid_a)
+    mytester:assert(torch.abs(bn.running_mean - mean):max() < 1e-6, 'error in OctreeBatchNormalization lazy running_mean')
+    mytester:assert(torch.abs(bn.running_var - var):max() < 1e-6, 'error in OctreeBatchNormalization lazy running_var')
+  end
+
+  for _, n in ipairs{1, 4} do
+    test(test_utils.octree_rand(n, 2,3,4, 3, 0.5,0.5,0.5, -1,1), test_utils.octree_rand(n, 2,3,4, 3, 0.5,0.5,0.5, -1,1))
+    test(test_utils.octree_rand(n, 2,3,4, 3, 1,1,1, -1,1), test_utils.octree_rand(n, 2,2,2, 3, 0,0,0, -1,1))
+  end
+end
+
+function octest.OctreeConvolution3x3x3FoldBatchNormalization()
+  local function test(grid_in, out_channels)
+    local in_channels = grid_in:feature_size()
+    local conv = oc.OctreeConvolution3x3x3(in_channels, out_channels, 'avg'):float()
+    local conv_out = conv:forward(grid_in)
+
+    local bn = oc.OctreeBatchNormalization(out_channels, 1):float()
+    local ss = oc.OctreeBatchNormalizationSS(out_channels):float()
+    local af = oc.OctreeBatchNormalizationAffine(out_channels, 1):float()
+    af.gamma:copy(ss.gamma)
+    af.beta:copy(ss.beta)
+    bn:forward(conv_out)
+    af:forward(conv_out)
+    bn:evaluate()
+    af:evaluate()
+    local out_bn = bn:forward(conv_out):clone()
+    local out_ss = ss:forward(out_bn):clone()
+
+    mytester:assert(conv:clone():foldBatchNormalization(bn):forward(grid_in):equals(out_bn, 1e-3), 
+        'error in foldBatchNormalization without ss')
+    mytester:assert(conv:clone():foldBatchNormalization(bn, ss):forward(grid_in):equals(out_ss, 1e-3), 
+        'error in foldBatchNormalization with ss')
+    mytester:assert(conv:clone():foldBatchNormalization(af):forward(grid_in):equals(out_ss, 1e-3), 
+        'error in foldBatchNormalization with OctreeBatchNormalizationAffine')
+
+    -- without running statistics the statistics of the last batch are folded
+    bn.running_mean = nil
+    bn.running_var = nil
+    mytester:assert(conv:clone():foldBatchNormalization(bn):forward(grid_in):equals(out_bn, 1e-3), 
+        'error in foldBatchNormalization without running statistics')
+  end
+
+  for _, n in ipairs{1, 4} do
+    test(test_utils.octree_rand(n, 2,3,4, 2, 0.5,0.5,0.5, -1,1), 3)
+    test(test_utils.octree_rand(n, 2,3,4, 3, 1,1,1, -1,1), 2)
+  end
+end
+
+function octest.OctreeBatchNormalizationAffine()
+  local function test(grid_in)
+    local fs = grid_in:feature_size()
+    local mod_af = oc.OctreeBatchNormalizationAffine(fs):float()
+    local mod_bn = oc.OctreeBatchNormalization(fs):float()
+    local mod_ss = oc.OctreeBatchNormalizationSS(fs):float()
+    mod_ss.gamma:copy(mod_af.gamma)
+    mod_ss.beta:copy(mod_af.beta)
+
+    -- the fused kernels have to match the chained normalization and scale/shift
+    local out_af = mod_af:forward(grid_in)
+    local out_ch = mod_ss:forward(mod_bn:forward(grid_in))
+    mytester:assert(out_af:equals(out_ch, 1e-5), 'error in OctreeBatchNormalizationAffine forward')
+    local err = torch.abs(mod_af.running_var - mod_bn.running_var):max()
+    mytester:assert(err < 1e-6, 'error in OctreeBatchNormalizationAffine running_var err='..err)
+
+    local grad_out = grid_in:clone():apply(function() return torch.uniform(-1,1) end)
+    mod_af:zeroGradParameters()
+    mod_ss.gradGamma:zero()
+    mod_ss.gradBeta:zero()
+    local grad_af = mod_af:backward(grid_in, grad_out)
+    local grad_ch = mod_bn:backward(grid_in, mod_ss:backward(mod_bn.output, grad_out))
+    mytester:assert(grad_af:equals(grad_ch, 1e-4), 'error in OctreeBatchNormalizationAffine backward')
+    local err = torch.abs(mod_af.gradGamma - mod_ss.gradGamma):max()
+    mytester:assert(err < 1e-4, 'error in OctreeBatchNormalizationAffine gradGamma err='..err)
+    local err = torch.abs(mod_af.gradBeta - mod_ss.gradBeta):max()
+    mytester:assert(err < 1e-4, 'error in OctreeBatchNormalizationAffine gradBeta err='..err)
+
+    mod_af:evaluate()
+    mod_bn:evaluate()
+    local out_af = mod_af:forward(grid_in)
+    local out_ch = mod_ss:forward(mod_bn:forward(grid_in))
+    mytester:assert(out_af:equals(out_ch, 1e-5), 'error in OctreeBatchNormalizationAffine evaluate')
+  end
+
+  for _, n in ipairs{1, 4} do
+    test(test_utils.octree_rand(n, 2,3,4, 3, 0,0,0, -1,1))
+    test(test_utils.octree_rand(n, 2,3,4, 3, 1,1,1, -1,1))
+    test(test_utils.octree_rand(n, 2,3,4, 3, 0.5,0.5,0.5, -1,1))
+  end
+end
+
+
 function octest.OctreeMaskByLabel()
   local function test(input)
     local labels = input:clone()